@@ -0,0 +1,183 @@
+#include "bots.h"
+
+#define MAILBOX_FRESH 4             // Flag of the slot in between of a mailbox that has not been taken
+
+// Sets an atomic integer and gets its previous value.
+static gint exchange(gint *atomic, gint value)
+{
+    gint old;
+
+    do
+        old = g_atomic_int_get(atomic);
+    while (!g_atomic_int_compare_and_exchange(atomic, old, value));
+
+    return old;
+}
+
+void mailbox_init(Mailbox *mailbox, gsize size)
+{
+    for (guint i = 0; i < MAILBOX_SLOTS; i++)
+        mailbox->slots[i] = g_malloc0(size);
+
+    mailbox->writing = 0;
+    mailbox->middle = 1;
+    mailbox->reading = 2;
+}
+
+void mailbox_free(Mailbox *mailbox)
+{
+    for (guint i = 0; i < MAILBOX_SLOTS; i++)
+        g_free(mailbox->slots[i]);
+}
+
+gpointer mailbox_slot(Mailbox *mailbox)
+{
+    return mailbox->slots[mailbox->writing];
+}
+
+void mailbox_post(Mailbox *mailbox)
+{
+    mailbox->writing = exchange(&mailbox->middle, mailbox->writing | MAILBOX_FRESH) & ~MAILBOX_FRESH;
+}
+
+gpointer mailbox_take(Mailbox *mailbox)
+{
+    // Only the reader clears the flag: a message posted meanwhile is taken by the exchange.
+    if ((g_atomic_int_get(&mailbox->middle) & MAILBOX_FRESH) == 0)
+        return NULL;
+
+    mailbox->reading = exchange(&mailbox->middle, mailbox->reading) & ~MAILBOX_FRESH;
+    return mailbox->slots[mailbox->reading];
+}
+
+// Decides the moves of the paddles of the remote keys of a state.
+static void decide(const BotRequest *request, BotReply *reply)
+{
+    const Sim *sim = &request->sim;
+
+    reply->tick = sim->tick;
+    reply->keys = sim->remote_keys;
+    for (guint i = 0; i < MIN(sim->paddle_count, KEY_PADDLES); i++)
+    {
+        if ((sim->remote_keys & KEY_UP(i)) == 0)
+            continue;
+
+        reply->directions[i] = sim_decide(sim, &sim->paddles[i]);
+        reply->latencies[i] = g_get_monotonic_time() - request->time;
+    }
+}
+
+// Worker thread of the bots: decides on each new state until it is stopped.
+static gpointer run_worker(gpointer user_data)
+{
+    Bots *bots = user_data;
+
+    while (TRUE)
+    {
+        g_mutex_lock(&bots->mutex);
+        while (!bots->pending && !bots->stop)
+            g_cond_wait(&bots->wake, &bots->mutex);
+        gboolean stop = bots->stop;
+        bots->pending = FALSE;
+        g_mutex_unlock(&bots->mutex);
+
+        if (stop)
+            return NULL;
+
+        // Only the last state counts: the ones sent meanwhile are already late.
+        const BotRequest *request = mailbox_take(&bots->requests);
+        if (request == NULL)
+            continue;
+
+        decide(request, mailbox_slot(&bots->replies));
+        mailbox_post(&bots->replies);
+    }
+}
+
+void bots_start(Bots *bots)
+{
+    *bots = (Bots) { 0 };
+    mailbox_init(&bots->requests, sizeof(BotRequest));
+    mailbox_init(&bots->replies, sizeof(BotReply));
+    g_mutex_init(&bots->mutex);
+    g_cond_init(&bots->wake);
+    bots->worker = g_thread_new("bots", run_worker, bots);
+}
+
+void bots_stop(Bots *bots)
+{
+    g_mutex_lock(&bots->mutex);
+    bots->stop = TRUE;
+    g_cond_signal(&bots->wake);
+    g_mutex_unlock(&bots->mutex);
+    g_thread_join(bots->worker);
+
+    g_cond_clear(&bots->wake);
+    g_mutex_clear(&bots->mutex);
+    mailbox_free(&bots->replies);
+    mailbox_free(&bots->requests);
+}
+
+guint bots_collect(Bots *bots, Sim *sim, gboolean fallback)
+{
+    // Hands the predicting paddles over to the bots.
+    // (The controllers may have changed since the last tick.)
+    guint count = MIN(sim->paddle_count, KEY_PADDLES);
+    bots->keys = 0;
+    for (guint i = 0; i < count; i++)
+    {
+        if (sim->paddles[i].control == CONTROL_PREDICT)
+            bots->keys |= KEY_UP(i) | KEY_DOWN(i);
+    }
+    sim->remote_keys = bots->keys;
+
+    // The decisions are in time if they are about the state of this tick.
+    const BotReply *reply = mailbox_take(&bots->replies);
+    gboolean in_time = reply != NULL && reply->tick == sim->tick;
+
+    guint keys = 0;
+    for (guint i = 0; i < count; i++)
+    {
+        if ((bots->keys & KEY_UP(i)) == 0)
+            continue;
+
+        // A late decision still replaces the last one.
+        Bot *bot = &bots->bots[i];
+        gboolean decided = reply != NULL && (reply->keys & KEY_UP(i)) != 0;
+        if (decided)
+        {
+            bot->direction = reply->directions[i];
+            stats_add(&bot->latency, reply->latencies[i]);
+        }
+
+        gint direction = bot->direction;
+        if (decided && in_time)
+            bot->decisions++;
+        else
+        {
+            bot->misses++;
+            if (fallback)
+                direction = sim_chase(sim, &sim->paddles[i]);
+        }
+
+        keys |= direction < 0 ? KEY_UP(i) : direction > 0 ? KEY_DOWN(i) : 0;
+    }
+
+    return keys;
+}
+
+void bots_send(Bots *bots, const Sim *sim)
+{
+    if (bots->keys == 0)
+        return;
+
+    BotRequest *request = mailbox_slot(&bots->requests);
+    request->sim = *sim;
+    request->time = g_get_monotonic_time();
+    mailbox_post(&bots->requests);
+
+    g_mutex_lock(&bots->mutex);
+    bots->pending = TRUE;
+    g_cond_signal(&bots->wake);
+    g_mutex_unlock(&bots->mutex);
+}
@@ -0,0 +1,97 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include <glib.h>
+
+#include "sim.h"
+#include "stats.h"
+
+#define MAILBOX_SLOTS 3             // Number of slots of a mailbox (the writer's, the reader's and one in between)
+
+// Mailbox that passes the latest of a series of messages from one thread to another.
+// (Triple buffer: the writer and the reader each own a slot and swap it with the one
+// in between by an atomic exchange, so that neither of them ever waits for the other.
+// A message that has not been taken when the next one is posted is lost.)
+typedef struct Mailbox
+{
+    gpointer slots[MAILBOX_SLOTS];  // Messages
+    guint writing;                  // Slot of the writer
+    guint reading;                  // Slot of the reader
+    gint middle;                    // Slot in between, with MAILBOX_FRESH if it has not been taken (atomic)
+} Mailbox;
+
+// State of the game sent to the bots.
+typedef struct BotRequest
+{
+    Sim sim;                        // Copy of the simulation (the bricks are shared: the bots do not read them)
+    gint64 time;                    // Time the state was sent in microseconds
+} BotRequest;
+
+// Moves decided by the bots for a state of the game.
+typedef struct BotReply
+{
+    guint tick;                     // Tick of the state
+    guint keys;                     // Remote keys of the state (the paddles decided)
+    gint directions[KEY_PADDLES];   // Move of each paddle (-1, 0 or 1)
+    gint64 latencies[KEY_PADDLES];  // Time from the request to each decision in microseconds
+} BotReply;
+
+// Bot of a paddle.
+typedef struct Bot
+{
+    gint direction;                 // Last move decided
+    guint64 decisions;              // Number of ticks whose decision came in time
+    guint64 misses;                 // Number of ticks whose decision was late
+    Stats latency;                  // Decision latencies in microseconds
+} Bot;
+
+// Bots that decide the moves of the predicting paddles on a worker thread.
+// (The game tick sends them each new state and applies their decisions as key presses
+// on the next tick: a bot has one tick period to decide. The paddles after the first
+// KEY_PADDLES cannot be moved by the keys: the simulation decides them itself.)
+typedef struct Bots
+{
+    guint keys;                     // Keys of the paddles decided by the bots (set by 'bots_collect')
+    Bot bots[KEY_PADDLES];          // Bot of each paddle
+    Mailbox requests;               // States sent to the worker ('BotRequest')
+    Mailbox replies;                // Decisions sent back by the worker ('BotReply')
+    GThread *worker;                // Worker thread
+    GMutex mutex;                   // Lock of the wake-up of the worker (never held during a decision)
+    GCond wake;                     // Signaled when a request is sent or the worker has to stop
+    gboolean pending;               // A request has been sent since the worker last woke up
+    gboolean stop;                  // The worker has to stop
+} Bots;
+
+// Allocates the slots of a mailbox.
+void mailbox_init(Mailbox *mailbox, gsize size);
+
+// Frees the slots of a mailbox.
+void mailbox_free(Mailbox *mailbox);
+
+// Gets the slot where the writer prepares its next message.
+gpointer mailbox_slot(Mailbox *mailbox);
+
+// Posts the message prepared in the slot of the writer.
+void mailbox_post(Mailbox *mailbox);
+
+// Takes the last message posted.
+// (Returns NULL if it has already been taken; the message stays valid until the next call.)
+gpointer mailbox_take(Mailbox *mailbox);
+
+// Starts the worker thread of the bots.
+void bots_start(Bots *bots);
+
+// Stops the worker thread of the bots.
+void bots_stop(Bots *bots);
+
+// Gets the keys of the moves decided by the bots for the next tick.
+// (Hands the predicting paddles over to the bots: their keys become the remote keys of
+// the simulation. A bot whose decision is late keeps its last move, or chases the disc
+// with the fallback.)
+guint bots_collect(Bots *bots, Sim *sim, gboolean fallback);
+
+// Sends the state after a tick to the bots.
+// (Nothing is sent if no paddle is decided by them.)
+void bots_send(Bots *bots, const Sim *sim);
+
+#endif
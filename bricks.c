@@ -0,0 +1,350 @@
+#include "bricks.h"
+
+#define SWEEP_ONE 65536             // Whole move in the fixed-point times of a swept query
+#define SWEEP_STACK 64              // Largest depth of the traversal of the tree
+
+// Axis and rectangles of a sort of the bricks.
+typedef struct SortData
+{
+    const Rect *rects;              // Bricks (by id)
+    gboolean vertical;              // Sorts along the y axis (along the x axis otherwise)
+} SortData;
+
+Bricks *bricks_new(const Config *config)
+{
+    guint count = config->brick_columns * config->brick_rows;
+    if (count == 0)
+        return NULL;
+
+    Bricks *bricks = g_new0(Bricks, 1);
+    *bricks = (Bricks)
+            {
+                    .count = count,
+                    .columns = config->brick_columns,
+                    .gap = config->brick_gap,
+                    .destructible = !config->static_bricks,
+                    .width = -1,
+                    .height = -1,
+                    .rects = g_new(Rect, count),
+                    .standing = g_new(gboolean, count),
+                    .ids = g_new(guint, count),
+                    .slots = g_new(guint, count),
+                    .leaves = g_new(guint, count),
+                    .nodes = g_new(BrickNode, 2 * count),
+                    .destroyed = g_new(guint, count),
+            };
+
+    for (guint i = 0; i < count; i++)
+    {
+        bricks->standing[i] = TRUE;
+        bricks->ids[i] = i;
+        bricks->slots[i] = i;
+    }
+
+    return bricks;
+}
+
+void bricks_free(Bricks *bricks)
+{
+    if (bricks == NULL)
+        return;
+
+    g_free(bricks->rects);
+    g_free(bricks->standing);
+    g_free(bricks->ids);
+    g_free(bricks->slots);
+    g_free(bricks->leaves);
+    g_free(bricks->nodes);
+    g_free(bricks->destroyed);
+    g_free(bricks);
+}
+
+// Gets the union of two bounds, either of which may be empty.
+static Rect bounds_union(const Rect *a, const Rect *b)
+{
+    if (a->width == 0)
+        return *b;
+    if (b->width == 0)
+        return *a;
+    return rect_union(a, b);
+}
+
+// Works out the bounds of a node from its standing bricks or from its children.
+static void refit_node(Bricks *bricks, guint index)
+{
+    BrickNode *node = &bricks->nodes[index];
+    Rect bounds = { 0, 0, 0, 0 };
+
+    if (node->count != 0)
+    {
+        for (guint slot = node->start; slot < node->start + node->count; slot++)
+        {
+            if (bricks->standing[slot])
+                bounds = bounds_union(&bounds, &bricks->rects[slot]);
+        }
+    }
+    else
+        bounds = bounds_union(&bricks->nodes[index + 1].bounds, &bricks->nodes[node->start].bounds);
+
+    node->bounds = bounds;
+}
+
+// Works out the bounds of all the nodes.
+// (The children come after their parent.)
+static void refit_all(Bricks *bricks)
+{
+    for (guint i = bricks->node_count; i-- > 0; )
+        refit_node(bricks, i);
+}
+
+// Works out the bounds of the nodes above a slot.
+static void refit_slot(Bricks *bricks, guint slot)
+{
+    guint index = bricks->leaves[slot];
+
+    while (TRUE)
+    {
+        Rect old = bricks->nodes[index].bounds;
+        refit_node(bricks, index);
+
+        // The nodes above keep their bounds if this one does.
+        const Rect *new = &bricks->nodes[index].bounds;
+        if (index == 0 || (old.x == new->x && old.y == new->y && old.width == new->width && old.height == new->height))
+            break;
+        index = bricks->nodes[index].parent;
+    }
+}
+
+// Compares two bricks by their centres along an axis (then by their ids, for a total order).
+static gint compare_bricks(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const SortData *data = user_data;
+    const Rect *rect_a = &data->rects[*(const guint*) a];
+    const Rect *rect_b = &data->rects[*(const guint*) b];
+    gint centre_a = data->vertical ? 2 * rect_a->y + rect_a->height : 2 * rect_a->x + rect_a->width;
+    gint centre_b = data->vertical ? 2 * rect_b->y + rect_b->height : 2 * rect_b->x + rect_b->width;
+
+    if (centre_a != centre_b)
+        return centre_a < centre_b ? -1 : 1;
+    return *(const guint*) a < *(const guint*) b ? -1 : *(const guint*) a > *(const guint*) b;
+}
+
+// Builds the node of the slots from 'start' to 'end' (excluded) and its children.
+// (Splits the bricks in two halves along the longer side of their bounds; returns the index of the node.)
+static guint build_node(Bricks *bricks, const Rect *rects, guint start, guint end, guint parent)
+{
+    guint index = bricks->node_count++;
+    BrickNode *node = &bricks->nodes[index];
+    *node = (BrickNode) { .start = start, .count = end - start, .parent = parent };
+
+    if (end - start <= BRICK_LEAF)
+    {
+        for (guint slot = start; slot < end; slot++)
+            bricks->leaves[slot] = index;
+        return index;
+    }
+
+    Rect bounds = rects[bricks->ids[start]];
+    for (guint slot = start + 1; slot < end; slot++)
+        bounds = rect_union(&bounds, &rects[bricks->ids[slot]]);
+
+    SortData data = { rects, bounds.height > bounds.width };
+    g_qsort_with_data(&bricks->ids[start], end - start, sizeof(guint), compare_bricks, &data);
+
+    guint middle = start + (end - start) / 2;
+    build_node(bricks, rects, start, middle, index);
+    node->start = build_node(bricks, rects, middle, end, index);
+    node->count = 0;
+    return index;
+}
+
+void bricks_layout(Bricks *bricks, gint width, gint height)
+{
+    if (bricks->width == width && bricks->height == height)
+        return;
+
+    bricks->width = width;
+    bricks->height = height;
+
+    // Keeps the standing bricks by their ids.
+    gboolean *standing = g_new(gboolean, bricks->count);
+    Rect *rects = g_new(Rect, bricks->count);
+    for (guint id = 0; id < bricks->count; id++)
+        standing[id] = bricks->standing[bricks->slots[id]];
+
+    // Divides the middle half of the arena into cells, a brick in each.
+    // (Destructible bricks fill the whole height, since the disc opens its way through them;
+    // static ones only the middle half, so that the disc can still go around them.)
+    guint rows = bricks->count / bricks->columns;
+    gint top = bricks->destructible ? 0 : height / 4;
+    gint span = bricks->destructible ? height : height / 2;
+    for (guint id = 0; id < bricks->count; id++)
+    {
+        guint column = id % bricks->columns;
+        guint row = id / bricks->columns;
+        gint x0 = width / 4 + (gint) ((gint64) column * (width / 2) / bricks->columns);
+        gint x1 = width / 4 + (gint) ((gint64) (column + 1) * (width / 2) / bricks->columns);
+        gint y0 = top + (gint) ((gint64) row * span / rows);
+        gint y1 = top + (gint) ((gint64) (row + 1) * span / rows);
+
+        rects[id] = (Rect) { x0 + bricks->gap / 2, y0 + bricks->gap / 2,
+                             MAX(x1 - x0 - bricks->gap, 1), MAX(y1 - y0 - bricks->gap, 1) };
+        bricks->ids[id] = id;
+    }
+
+    bricks->node_count = 0;
+    build_node(bricks, rects, 0, bricks->count, 0);
+
+    // Stores the bricks in the order of the leaves.
+    for (guint slot = 0; slot < bricks->count; slot++)
+    {
+        guint id = bricks->ids[slot];
+        bricks->rects[slot] = rects[id];
+        bricks->standing[slot] = standing[id];
+        bricks->slots[id] = slot;
+    }
+
+    refit_all(bricks);
+    g_free(rects);
+    g_free(standing);
+}
+
+void bricks_reset(Bricks *bricks)
+{
+    for (guint slot = 0; slot < bricks->count; slot++)
+        bricks->standing[slot] = TRUE;
+    bricks->destroyed_count = 0;
+
+    refit_all(bricks);
+}
+
+// Gets the times when a moving interval enters and leaves a still one along an axis.
+// (In fractions of the move: SWEEP_ONE when the move ends.)
+static void sweep_axis(gint from, gint to, gint size, gint start, gint length, gint64 *enter, gint64 *leave)
+{
+    gint64 move = to - from;
+
+    if (move > 0)
+    {
+        *enter = (start - (gint64) from - size) * SWEEP_ONE / move;
+        *leave = (start + (gint64) length - from) * SWEEP_ONE / move;
+    }
+    else if (move < 0)
+    {
+        *enter = (from - (gint64) start - length) * SWEEP_ONE / -move;
+        *leave = (from + (gint64) size - start) * SWEEP_ONE / -move;
+    }
+
+    // Still along the axis: inside the interval for the whole move, or never.
+    else if (from < start + length && start < from + size)
+    {
+        *enter = G_MININT64;
+        *leave = G_MAXINT64;
+    }
+    else
+    {
+        *enter = G_MAXINT64;
+        *leave = G_MININT64;
+    }
+}
+
+gboolean bricks_sweep(const Bricks *bricks, const Rect *from, const Rect *to, BrickHit *hit)
+{
+    Rect swept = rect_union(from, to);
+    gint64 first = SWEEP_ONE;
+    guint stack[SWEEP_STACK];
+    guint depth = 0;
+
+    stack[depth++] = 0;
+    while (depth != 0)
+    {
+        const BrickNode *node = &bricks->nodes[stack[--depth]];
+        if (node->bounds.width == 0 || !rect_intersect(&node->bounds, &swept))
+            continue;
+
+        if (node->count == 0)
+        {
+            stack[depth++] = node->start;
+            stack[depth++] = node - bricks->nodes + 1;
+            continue;
+        }
+
+        for (guint slot = node->start; slot < node->start + node->count; slot++)
+        {
+            const Rect *rect = &bricks->rects[slot];
+            if (!bricks->standing[slot] || !rect_intersect(rect, &swept) || rect_intersect(rect, from))
+                continue;
+
+            gint64 enter_x, leave_x, enter_y, leave_y;
+            sweep_axis(from->x, to->x, from->width, rect->x, rect->width, &enter_x, &leave_x);
+            sweep_axis(from->y, to->y, from->height, rect->y, rect->height, &enter_y, &leave_y);
+            gint64 enter = MAX(enter_x, enter_y);
+
+            // Keeps the first brick entered during the move (the lowest id on a tie).
+            // (A negative time is a brick left behind.)
+            guint id = bricks->ids[slot];
+            if (enter >= 0 && enter < MIN(leave_x, leave_y) && (enter < first || (enter == first && id < hit->id)))
+            {
+                first = enter;
+                *hit = (BrickHit) { id, enter_x == enter, enter_y == enter };
+            }
+        }
+    }
+
+    return first < SWEEP_ONE;
+}
+
+void bricks_destroy(Bricks *bricks, guint id)
+{
+    guint slot = bricks->slots[id];
+    if (!bricks->standing[slot])
+        return;
+
+    bricks->standing[slot] = FALSE;
+    bricks->destroyed[bricks->destroyed_count++] = id;
+    bricks->kept_count = bricks->destroyed_count;
+    refit_slot(bricks, slot);
+}
+
+void bricks_rewind(Bricks *bricks, guint destroyed_count)
+{
+    while (bricks->destroyed_count > destroyed_count)
+    {
+        guint slot = bricks->slots[bricks->destroyed[--bricks->destroyed_count]];
+        bricks->standing[slot] = TRUE;
+        refit_slot(bricks, slot);
+    }
+
+    while (bricks->destroyed_count < MIN(destroyed_count, bricks->kept_count))
+    {
+        guint slot = bricks->slots[bricks->destroyed[bricks->destroyed_count++]];
+        bricks->standing[slot] = FALSE;
+        refit_slot(bricks, slot);
+    }
+}
+
+void bricks_pack(const Bricks *bricks, guint8 *bits)
+{
+    for (guint id = 0; id < bricks->count; id += 8)
+    {
+        guint8 byte = 0;
+        for (guint i = id; i < MIN(id + 8, bricks->count); i++)
+            byte |= bricks->standing[bricks->slots[i]] << (i - id);
+        bits[id / 8] = byte;
+    }
+}
+
+void bricks_unpack(Bricks *bricks, const guint8 *bits)
+{
+    bricks->destroyed_count = 0;
+    for (guint id = 0; id < bricks->count; id++)
+    {
+        gboolean standing = (bits[id / 8] >> (id % 8)) & 1;
+        bricks->standing[bricks->slots[id]] = standing;
+        if (!standing)
+            bricks->destroyed[bricks->destroyed_count++] = id;
+    }
+    bricks->kept_count = bricks->destroyed_count;
+
+    refit_all(bricks);
+}
@@ -0,0 +1,85 @@
+#ifndef BRICKS_H
+#define BRICKS_H
+
+#include <glib.h>
+
+#include "sim.h"
+
+#define BRICK_LEAF 4                // Largest number of bricks of a leaf of the tree
+
+// Node of the bounding-volume hierarchy of the bricks.
+typedef struct BrickNode
+{
+    Rect bounds;                    // Bounds of the standing bricks of the node (empty if none)
+    guint start;                    // First slot of a leaf, or index of the right child of an inner node
+    guint count;                    // Number of slots of a leaf (0 for an inner node)
+    guint parent;                   // Index of the parent (the root is its own parent)
+} BrickNode;
+
+// Result of a swept query.
+typedef struct BrickHit
+{
+    guint id;                       // Index of the brick in the grid (row by row)
+    gboolean x, y;                  // The disc has entered the brick across a vertical or horizontal side
+} BrickHit;
+
+// Bricks of the arena in a bounding-volume hierarchy.
+// (The tree is built when the arena is laid out; destroying a brick only refits
+// the bounds of the nodes above it. The bricks are stored in the order of the
+// leaves: a slot is a position in that order, an id a position in the grid.)
+typedef struct Bricks
+{
+    guint count;                    // Number of bricks
+    guint columns;                  // Number of columns of the grid
+    gint gap;                       // Space between two bricks in pixels
+    gboolean destructible;          // The disc destroys the bricks it hits
+    gint width, height;             // Size of the arena of the layout
+    Rect *rects;                    // Bricks (by slot)
+    gboolean *standing;             // Whether each brick is standing (by slot)
+    guint *ids;                     // Id of the brick of each slot
+    guint *slots;                   // Slot of each brick (by id)
+    guint *leaves;                  // Leaf of each slot
+    BrickNode *nodes;               // Nodes (the root first)
+    guint node_count;               // Number of nodes
+    guint *destroyed;               // Ids of the destroyed bricks in the order of destruction
+    guint destroyed_count;          // Number of destroyed bricks
+    guint kept_count;               // Number of ids kept in 'destroyed' (those after the destroyed ones were stood again)
+} Bricks;
+
+// Allocates the bricks of the tunables.
+// (Returns NULL if there are none.)
+Bricks *bricks_new(const Config *config);
+
+// Frees bricks.
+void bricks_free(Bricks *bricks);
+
+// Lays the bricks out in the middle half of an arena and builds the tree.
+// (Static bricks leave the top and bottom quarters free, so that the disc can go around them.
+// Nothing is done if the size has not changed.)
+void bricks_layout(Bricks *bricks, gint width, gint height);
+
+// Stands all the bricks again.
+// (They can be destroyed again by a rewind.)
+void bricks_reset(Bricks *bricks);
+
+// Finds the first standing brick met by a rectangle moving from one position to another.
+// (Bricks that the rectangle already overlaps are ignored, so that it can leave them;
+// returns FALSE if there is none.)
+gboolean bricks_sweep(const Bricks *bricks, const Rect *from, const Rect *to, BrickHit *hit);
+
+// Destroys a brick and refits the tree.
+void bricks_destroy(Bricks *bricks, guint id);
+
+// Stands the last destroyed bricks again, down to a number of destroyed bricks.
+// (Or destroys again the bricks stood by a reset or a rewind, up to it: the ids of the
+// bricks destroyed since then are not kept.)
+void bricks_rewind(Bricks *bricks, guint destroyed_count);
+
+// Packs whether each brick is standing (a bit per brick, in the order of the ids).
+void bricks_pack(const Bricks *bricks, guint8 *bits);
+
+// Unpacks whether each brick is standing and refits the tree.
+// (The destroyed bricks are then in the order of their ids.)
+void bricks_unpack(Bricks *bricks, const guint8 *bits);
+
+#endif
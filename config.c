@@ -0,0 +1,618 @@
+#include "config.h"
+#include "sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define CONFIG_GROUP "pong"         // Group of the tunables in the config file
+
+// Largest speed of the disc or of a paddle in pixels per tick.
+// (Its fixed-point step, scaled by the largest time scale, still fits a gint.)
+#define MAX_SPEED ((gdouble) G_MAXINT / FIXED_ONE / MAX_SCALE)
+
+// Type of a tunable.
+typedef enum TunableType
+{
+    TUNABLE_INT,                    // gint
+    TUNABLE_DOUBLE,                 // gdouble
+    TUNABLE_INT64,                  // gint64
+    TUNABLE_BOOLEAN,                // gboolean
+    TUNABLE_CONTROL,                // Control (given by its name)
+    TUNABLE_LINEUP,                 // Lineup (given by a letter per paddle: l, r, t or b)
+    TUNABLE_MODEL,                  // Network (given by its file)
+    TUNABLE_SCRIPT,                 // Script (given by its file)
+} TunableType;
+
+// Description of a tunable.
+typedef struct Tunable
+{
+    const gchar *name;              // Name of the option and of the key in the config file
+    TunableType type;               // Type
+    gsize offset;                   // Offset of the field in the 'Config' structure
+    gboolean reloadable;            // Can be changed during a session
+    const gchar *description;       // Description for --help
+} Tunable;
+
+static const Tunable tunables[] =
+        {
+                { "width", TUNABLE_INT, G_STRUCT_OFFSET(Config, width), FALSE, "Width of the arena in pixels" },
+                { "height", TUNABLE_INT, G_STRUCT_OFFSET(Config, height), FALSE, "Height of the arena in pixels" },
+                { "paddle-width", TUNABLE_INT, G_STRUCT_OFFSET(Config, paddle_width), TRUE, "Width of a paddle in pixels" },
+                { "paddle-height", TUNABLE_INT, G_STRUCT_OFFSET(Config, paddle_height), TRUE, "Height of a paddle in pixels" },
+                { "paddle-step", TUNABLE_INT, G_STRUCT_OFFSET(Config, paddle_step), TRUE, "Step of a paddle in pixels" },
+                { "paddle-period", TUNABLE_INT, G_STRUCT_OFFSET(Config, paddle_period), TRUE, "Period of a paddle in milliseconds" },
+                { "disc-size", TUNABLE_INT, G_STRUCT_OFFSET(Config, disc_size), TRUE, "Size of the disc in pixels" },
+                { "disc-speed", TUNABLE_DOUBLE, G_STRUCT_OFFSET(Config, disc_speed), TRUE, "Speed of the disc in pixels per tick" },
+                { "tick-period", TUNABLE_INT, G_STRUCT_OFFSET(Config, tick_period), TRUE, "Period of the game tick in milliseconds" },
+                { "end-game-score", TUNABLE_INT, G_STRUCT_OFFSET(Config, end_game_score), TRUE, "Score that ends a match" },
+                { "seed", TUNABLE_INT64, G_STRUCT_OFFSET(Config, seed), FALSE, "Seed of the random number generator" },
+                { "headless", TUNABLE_BOOLEAN, G_STRUCT_OFFSET(Config, headless), FALSE, "Run without a user interface" },
+                { "ticks", TUNABLE_INT64, G_STRUCT_OFFSET(Config, ticks), FALSE, "Number of ticks of a headless run" },
+                { "rewind-seconds", TUNABLE_INT, G_STRUCT_OFFSET(Config, rewind_seconds), FALSE, "Duration of the history kept for rewinding in seconds" },
+                { "p1-control", TUNABLE_CONTROL, G_STRUCT_OFFSET(Config, p1_control), TRUE, "Controller of player 1 (keys, follow, noisy, predict, neural or script)" },
+                { "p2-control", TUNABLE_CONTROL, G_STRUCT_OFFSET(Config, p2_control), TRUE, "Controller of player 2 (keys, follow, noisy, predict, neural or script)" },
+                { "others-control", TUNABLE_CONTROL, G_STRUCT_OFFSET(Config, others_control), TRUE, "Controller of the paddles after the first two" },
+                { "paddles", TUNABLE_LINEUP, G_STRUCT_OFFSET(Config, lineup), FALSE, "Sides of the paddles, one letter each (e.g. lr, lrtb or llrr)" },
+                { "brick-columns", TUNABLE_INT, G_STRUCT_OFFSET(Config, brick_columns), FALSE, "Number of columns of bricks between the paddles" },
+                { "brick-rows", TUNABLE_INT, G_STRUCT_OFFSET(Config, brick_rows), FALSE, "Number of rows of bricks" },
+                { "brick-gap", TUNABLE_INT, G_STRUCT_OFFSET(Config, brick_gap), FALSE, "Space between two bricks in pixels" },
+                { "static-bricks", TUNABLE_BOOLEAN, G_STRUCT_OFFSET(Config, static_bricks), FALSE, "The bricks are not destroyed by the disc" },
+                { "bot-fallback", TUNABLE_BOOLEAN, G_STRUCT_OFFSET(Config, bot_fallback), TRUE, "Bots that miss the tick deadline follow the disc" },
+                { "model", TUNABLE_MODEL, G_STRUCT_OFFSET(Config, model), FALSE, "Network file of the neural paddles (see pong_mlp)" },
+                { "script", TUNABLE_SCRIPT, G_STRUCT_OFFSET(Config, script), FALSE, "Bot file of the scripted paddles (see script.c)" },
+                { "script-budget", TUNABLE_INT, G_STRUCT_OFFSET(Config, script_budget), TRUE, "Instructions a scripted bot may run in a tick" },
+                { "tiles", TUNABLE_INT, G_STRUCT_OFFSET(Config, tiles), FALSE, "Number of matches of bots shown at once in a grid of tiles" },
+        };
+
+// Names of the controllers.
+static const gchar *control_names[] = { "keys", "follow", "noisy", "predict", "neural", "script" };
+
+// Letters of the sides.
+static const gchar side_letters[] = "lrtb";
+
+void config_defaults(Config *config)
+{
+    *config = (Config)
+            {
+                    .width = 800,
+                    .height = 500,
+                    .paddle_width = 10,
+                    .paddle_height = 100,
+                    .paddle_step = 5,
+                    .paddle_period = 5,
+                    .disc_size = 10,
+                    .disc_speed = 1,
+                    .tick_period = 4,
+                    .end_game_score = 5,
+                    .seed = 1,
+                    .headless = FALSE,
+                    .ticks = 10000000,
+                    .rewind_seconds = 10,
+                    .p1_control = CONTROL_KEYS,
+                    .p2_control = CONTROL_KEYS,
+                    .others_control = CONTROL_FOLLOW,
+                    .lineup = { 2, { SIDE_LEFT, SIDE_RIGHT } },
+                    .brick_columns = 0,
+                    .brick_rows = 0,
+                    .brick_gap = 2,
+                    .static_bricks = FALSE,
+                    .bot_fallback = FALSE,
+                    .model = NULL,
+                    .script = NULL,
+                    .script_budget = 1000,
+                    .tiles = 0,
+                    .file = NULL,
+            };
+}
+
+gboolean config_parse_control(const gchar *name, Control *control, GError **error)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(control_names); i++)
+    {
+        if (g_strcmp0(name, control_names[i]) == 0)
+        {
+            *control = i;
+            return TRUE;
+        }
+    }
+
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Unknown controller: %s", name);
+    return FALSE;
+}
+
+// Converts the letters of a lineup.
+static gboolean parse_lineup(const gchar *letters, Lineup *lineup, GError **error)
+{
+    gsize count = strlen(letters);
+    if (count == 0 || count > MAX_PADDLES)
+    {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Number of paddles out of range: %s", letters);
+        return FALSE;
+    }
+
+    Lineup parsed = { count };
+    for (gsize i = 0; i < count; i++)
+    {
+        const gchar *letter = strchr(side_letters, letters[i]);
+        if (letter == NULL)
+        {
+            g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Unknown side: %c", letters[i]);
+            return FALSE;
+        }
+        parsed.sides[i] = letter - side_letters;
+    }
+
+    *lineup = parsed;
+    return TRUE;
+}
+
+// Loads a network.
+// (It replaces the one of the config file, if any.)
+static gboolean parse_model(const gchar *path, Mlp **model, GError **error)
+{
+    Mlp *loaded = mlp_load(path, error);
+    if (loaded == NULL)
+        return FALSE;
+
+    mlp_free(*model);
+    *model = loaded;
+    return TRUE;
+}
+
+// Loads a script.
+// (It replaces the one of the config file, if any.)
+static gboolean parse_script(const gchar *path, Script **script, GError **error)
+{
+    Script *loaded = script_load(path, error);
+    if (loaded == NULL)
+        return FALSE;
+
+    script_free(*script);
+    *script = loaded;
+    return TRUE;
+}
+
+// Converts the value of a tunable given as a string.
+static gboolean parse_string(const Tunable *tunable, const gchar *value, gpointer field, GError **error)
+{
+    switch (tunable->type)
+    {
+        case TUNABLE_CONTROL: return config_parse_control(value, field, error);
+        case TUNABLE_LINEUP: return parse_lineup(value, field, error);
+        case TUNABLE_MODEL: return parse_model(value, field, error);
+        default: return parse_script(value, field, error);
+    }
+}
+
+// Checks that the tunables are in range.
+// (The speed of the disc is compared so that nan is rejected.)
+static gboolean config_check(const Config *config, GError **error)
+{
+    if (config->width <= 0 || config->height <= 0 || config->width > MAX_ARENA || config->height > MAX_ARENA
+        || config->paddle_width <= 0 || config->paddle_height <= 0 || config->paddle_step < 0 || config->paddle_period <= 0
+        || config->disc_size <= 0 || !(config->disc_speed >= 0 && config->disc_speed <= MAX_SPEED)
+        || config->tick_period <= 0
+        || (gdouble) config->paddle_step * config->tick_period / config->paddle_period > MAX_SPEED
+        || config->end_game_score <= 0 || config->end_game_score > MAX_SCORE || config->ticks < 0
+        || config->rewind_seconds < 0 || config->rewind_seconds > MAX_REWIND_SECONDS
+        || config->brick_columns < 0 || config->brick_rows < 0 || config->brick_gap < 0
+        || (gint64) config->brick_columns * config->brick_rows > MAX_BRICKS || config->script_budget < 0
+        || config->tiles < 0 || config->tiles > MAX_TILES)
+    {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Tunable out of range");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Gets a tunable by its name.
+// (Returns NULL if it is unknown.)
+static const Tunable *find_tunable(const gchar *name)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        if (strcmp(name, tunables[i].name) == 0)
+            return &tunables[i];
+    }
+
+    return NULL;
+}
+
+// Reads the tunables of the config file.
+// (Only the reloadable ones if 'reload' is TRUE. A key that is not a tunable is an error.)
+static gboolean config_load(Config *config, gboolean reload, GError **error)
+{
+    GKeyFile *file = g_key_file_new();
+    gboolean ok = g_key_file_load_from_file(file, config->file, G_KEY_FILE_NONE, error);
+
+    gchar **keys = ok ? g_key_file_get_keys(file, CONFIG_GROUP, NULL, NULL) : NULL;
+    for (guint i = 0; keys != NULL && keys[i] != NULL && ok; i++)
+    {
+        if (find_tunable(keys[i]) == NULL)
+        {
+            g_set_error(error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND, "Unknown tunable in %s: %s",
+                        config->file, keys[i]);
+            ok = FALSE;
+        }
+    }
+    g_strfreev(keys);
+
+    for (guint i = 0; ok && i < G_N_ELEMENTS(tunables); i++)
+    {
+        const Tunable *tunable = &tunables[i];
+        gpointer field = G_STRUCT_MEMBER_P(config, tunable->offset);
+
+        if ((reload && !tunable->reloadable) || !g_key_file_has_key(file, CONFIG_GROUP, tunable->name, NULL))
+            continue;
+
+        GError *key_error = NULL;
+        switch (tunable->type)
+        {
+            case TUNABLE_INT:
+                *(gint*) field = g_key_file_get_integer(file, CONFIG_GROUP, tunable->name, &key_error);
+                break;
+
+            case TUNABLE_DOUBLE:
+                *(gdouble*) field = g_key_file_get_double(file, CONFIG_GROUP, tunable->name, &key_error);
+                break;
+
+            case TUNABLE_INT64:
+                *(gint64*) field = g_key_file_get_int64(file, CONFIG_GROUP, tunable->name, &key_error);
+                break;
+
+            case TUNABLE_BOOLEAN:
+                *(gboolean*) field = g_key_file_get_boolean(file, CONFIG_GROUP, tunable->name, &key_error);
+                break;
+
+            case TUNABLE_CONTROL:
+            case TUNABLE_LINEUP:
+            case TUNABLE_MODEL:
+            case TUNABLE_SCRIPT:
+            {
+                gchar *value = g_key_file_get_string(file, CONFIG_GROUP, tunable->name, &key_error);
+                if (value != NULL)
+                    parse_string(tunable, value, field, &key_error);
+                g_free(value);
+                break;
+            }
+        }
+
+        if (key_error != NULL)
+        {
+            g_propagate_error(error, key_error);
+            ok = FALSE;
+        }
+    }
+
+    g_key_file_free(file);
+    return ok;
+}
+
+gboolean config_parse(Config *config, const GOptionEntry *options, gboolean ignore_unknown,
+                      int *argc, char ***argv, GError **error)
+{
+    GOptionEntry config_entries[] =
+            {
+                    { "config", 'c', 0, G_OPTION_ARG_FILENAME, &config->file, "Config file", "FILE" },
+                    { NULL },
+            };
+
+    // Finds the config file first, so that the command line overrides it.
+    GOptionContext *context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, config_entries, NULL);
+    g_option_context_set_ignore_unknown_options(context, TRUE);
+    g_option_context_set_help_enabled(context, FALSE);
+    gboolean ok = g_option_context_parse(context, argc, argv, error);
+    g_option_context_free(context);
+
+    if (ok && config->file != NULL)
+        ok = config_load(config, FALSE, error);
+
+    if (!ok)
+        return FALSE;
+
+    // Builds the options from the tunables.
+    // (The controllers, the lineup, the network and the script are given as strings and converted afterwards.
+    // A boolean has a "--no-" option too, to turn off a value set in the config file.)
+    GOptionEntry entries[2 * G_N_ELEMENTS(tunables) + 2];
+    gchar *string_args[G_N_ELEMENTS(tunables)] = { NULL };
+    gchar *reverse_names[G_N_ELEMENTS(tunables)] = { NULL };
+    guint entry_count = 0;
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        const Tunable *tunable = &tunables[i];
+        static const GOptionArg args[] =
+                {
+                        [TUNABLE_INT] = G_OPTION_ARG_INT,
+                        [TUNABLE_DOUBLE] = G_OPTION_ARG_DOUBLE,
+                        [TUNABLE_INT64] = G_OPTION_ARG_INT64,
+                        [TUNABLE_BOOLEAN] = G_OPTION_ARG_NONE,
+                        [TUNABLE_CONTROL] = G_OPTION_ARG_STRING,
+                        [TUNABLE_LINEUP] = G_OPTION_ARG_STRING,
+                        [TUNABLE_MODEL] = G_OPTION_ARG_FILENAME,
+                        [TUNABLE_SCRIPT] = G_OPTION_ARG_FILENAME,
+                };
+        gboolean string = tunable->type >= TUNABLE_CONTROL;
+
+        entries[entry_count++] = (GOptionEntry)
+                {
+                        .long_name = tunable->name,
+                        .arg = args[tunable->type],
+                        .arg_data = string
+                                    ? (gpointer) &string_args[i]
+                                    : G_STRUCT_MEMBER_P(config, tunable->offset),
+                        .description = tunable->description,
+                };
+
+        if (tunable->type == TUNABLE_BOOLEAN)
+        {
+            reverse_names[i] = g_strconcat("no-", tunable->name, NULL);
+            entries[entry_count++] = (GOptionEntry)
+                    {
+                            .long_name = reverse_names[i],
+                            .flags = G_OPTION_FLAG_REVERSE,
+                            .arg = G_OPTION_ARG_NONE,
+                            .arg_data = G_STRUCT_MEMBER_P(config, tunable->offset),
+                            .description = "Turn off the previous option",
+                    };
+        }
+    }
+    entries[entry_count++] = config_entries[0];
+    entries[entry_count] = (GOptionEntry) { NULL };
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (options != NULL)
+        g_option_context_add_main_entries(context, options, NULL);
+    g_option_context_set_ignore_unknown_options(context, ignore_unknown);
+    ok = g_option_context_parse(context, argc, argv, error);
+    g_option_context_free(context);
+
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        if (ok && string_args[i] != NULL)
+            ok = parse_string(&tunables[i], string_args[i], G_STRUCT_MEMBER_P(config, tunables[i].offset), error);
+        g_free(string_args[i]);
+        g_free(reverse_names[i]);
+    }
+
+    return ok && config_check(config, error);
+}
+
+gboolean config_reload(Config *config, GError **error)
+{
+    // Keeps the current tunables if the new ones are not valid.
+    Config reloaded = *config;
+    if (!config_load(&reloaded, TRUE, error) || !config_check(&reloaded, error))
+        return FALSE;
+
+    *config = reloaded;
+    return TRUE;
+}
+
+gboolean config_set_number(Config *config, const gchar *name, gdouble value, GError **error)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        const Tunable *tunable = &tunables[i];
+        if (strcmp(name, tunable->name) != 0)
+            continue;
+
+        // An integer tunable only takes an integer in the range of its type.
+        // (-G_MININT64 is the first double out of the range of a gint64.)
+        gboolean integer = value == floor(value);
+        if ((tunable->type == TUNABLE_INT && !(integer && value >= G_MININT && value <= G_MAXINT))
+            || (tunable->type == TUNABLE_INT64 && !(integer && value >= G_MININT64 && value < -(gdouble) G_MININT64)))
+        {
+            g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Not an integer in range: %s", name);
+            return FALSE;
+        }
+
+        // Keeps the current tunables if the new one is not valid.
+        Config changed = *config;
+        gpointer field = G_STRUCT_MEMBER_P(&changed, tunable->offset);
+        switch (tunable->type)
+        {
+            case TUNABLE_INT: *(gint*) field = (gint) value; break;
+            case TUNABLE_DOUBLE: *(gdouble*) field = value; break;
+            case TUNABLE_INT64: *(gint64*) field = (gint64) value; break;
+            case TUNABLE_BOOLEAN: *(gboolean*) field = value != 0; break;
+
+            default:
+                g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION, "Not a number: %s", name);
+                return FALSE;
+        }
+        if (!config_check(&changed, error))
+            return FALSE;
+
+        *config = changed;
+        return TRUE;
+    }
+
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION, "Unknown tunable: %s", name);
+    return FALSE;
+}
+
+gboolean config_set(Config *config, const gchar *name, const gchar *value, GError **error)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        const Tunable *tunable = &tunables[i];
+        if (strcmp(name, tunable->name) != 0)
+            continue;
+
+        // Keeps the current tunables if the new one is not valid.
+        Config changed = *config;
+        gpointer field = G_STRUCT_MEMBER_P(&changed, tunable->offset);
+        gint64 integer = 0;
+        gchar *end;
+        gboolean ok = TRUE;
+        switch (tunable->type)
+        {
+            case TUNABLE_INT:
+                ok = g_ascii_string_to_signed(value, 10, G_MININT, G_MAXINT, &integer, error);
+                *(gint*) field = (gint) integer;
+                break;
+
+            case TUNABLE_DOUBLE:
+                *(gdouble*) field = g_ascii_strtod(value, &end);
+                ok = end != value && *end == '\0';
+                if (!ok)
+                    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Not a number: %s", value);
+                break;
+
+            case TUNABLE_INT64:
+                ok = g_ascii_string_to_signed(value, 10, G_MININT64, G_MAXINT64, &integer, error);
+                *(gint64*) field = integer;
+                break;
+
+            case TUNABLE_BOOLEAN:
+                *(gboolean*) field = g_strcmp0(value, "true") == 0;
+                ok = *(gboolean*) field || g_strcmp0(value, "false") == 0;
+                if (!ok)
+                    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Not a boolean: %s", value);
+                break;
+
+            default:
+                ok = parse_string(tunable, value, field, error);
+                break;
+        }
+        if (!ok || !config_check(&changed, error))
+            return FALSE;
+
+        *config = changed;
+        return TRUE;
+    }
+
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION, "Unknown tunable: %s", name);
+    return FALSE;
+}
+
+gchar *config_format(const Config *config, const gchar *prefix)
+{
+    GString *text = g_string_new(NULL);
+
+    for (guint i = 0; i < G_N_ELEMENTS(tunables); i++)
+    {
+        const Tunable *tunable = &tunables[i];
+        gconstpointer field = G_STRUCT_MEMBER_P(config, tunable->offset);
+        gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+        gchar letters[MAX_PADDLES + 1];
+
+        // (The network and the script are only known by their contents.)
+        if (tunable->type == TUNABLE_MODEL || tunable->type == TUNABLE_SCRIPT)
+            continue;
+
+        g_string_append_printf(text, "%s%s ", prefix, tunable->name);
+        switch (tunable->type)
+        {
+            case TUNABLE_INT:
+                g_string_append_printf(text, "%d\n", *(const gint*) field);
+                break;
+
+            case TUNABLE_DOUBLE:
+                g_string_append_printf(text, "%s\n", g_ascii_dtostr(buffer, sizeof(buffer), *(const gdouble*) field));
+                break;
+
+            case TUNABLE_INT64:
+                g_string_append_printf(text, "%" G_GINT64_FORMAT "\n", *(const gint64*) field);
+                break;
+
+            case TUNABLE_BOOLEAN:
+                g_string_append_printf(text, "%s\n", *(const gboolean*) field ? "true" : "false");
+                break;
+
+            case TUNABLE_CONTROL:
+                g_string_append_printf(text, "%s\n", control_names[*(const Control*) field]);
+                break;
+
+            case TUNABLE_LINEUP:
+            {
+                const Lineup *lineup = field;
+                for (guint j = 0; j < lineup->count; j++)
+                    letters[j] = side_letters[lineup->sides[j]];
+                letters[lineup->count] = '\0';
+                g_string_append_printf(text, "%s\n", letters);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    return g_string_free(text, FALSE);
+}
+
+void config_write(const Config *config, FILE *file, const gchar *prefix)
+{
+    gchar *text = config_format(config, prefix);
+    fputs(text, file);
+    g_free(text);
+}
+
+// Structure of a watch of the config file.
+typedef struct Watch
+{
+    gchar *name;                    // Name of the file in its directory
+    GSourceFunc callback;           // Function called when the file is written
+    gpointer user_data;             // Data passed to the function
+} Watch;
+
+// Handles the notifications of the directory of the config file.
+static gboolean on_inotify(GIOChannel *channel, GIOCondition condition, gpointer user_data)
+{
+    Watch *watch = user_data;
+    gchar buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    gboolean changed = FALSE;
+    gssize length;
+
+    while ((length = read(g_io_channel_unix_get_fd(channel), buffer, sizeof(buffer))) > 0)
+    {
+        for (gchar *p = buffer; p < buffer + length; )
+        {
+            struct inotify_event *event = (struct inotify_event*) p;
+            if (event->len != 0 && g_strcmp0(event->name, watch->name) == 0)
+                changed = TRUE;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (changed)
+        watch->callback(watch->user_data);
+
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean config_watch(const Config *config, GSourceFunc callback, gpointer user_data)
+{
+    if (config->file == NULL)
+        return FALSE;
+
+    // Watches the directory: editors often replace the file instead of writing it.
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    gchar *directory = g_path_get_dirname(config->file);
+    gboolean ok = fd >= 0 && inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0;
+    g_free(directory);
+
+    if (!ok)
+    {
+        if (fd >= 0)
+            close(fd);
+        return FALSE;
+    }
+
+    Watch *watch = g_new0(Watch, 1);
+    watch->name = g_path_get_basename(config->file);
+    watch->callback = callback;
+    watch->user_data = user_data;
+
+    GIOChannel *channel = g_io_channel_unix_new(fd);
+    g_io_add_watch(channel, G_IO_IN, on_inotify, watch);
+    g_io_channel_unref(channel);
+    return TRUE;
+}
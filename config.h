@@ -0,0 +1,117 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "mlp.h"
+#include "script.h"
+
+// Controller of a paddle.
+typedef enum Control
+{
+    CONTROL_KEYS,                   // The paddle is moved by the keys
+    CONTROL_FOLLOW,                 // The paddle follows the disc
+    CONTROL_NOISY,                  // The paddle follows the disc with random errors
+    CONTROL_PREDICT,                // The paddle moves to where the disc will reach its wall
+    CONTROL_NEURAL,                 // The paddle is moved by the network of the 'model' tunable
+    CONTROL_SCRIPT,                 // The paddle is moved by the bot of the 'script' tunable
+} Control;
+
+#define MAX_PADDLES 64              // Largest number of paddles
+#define MAX_BRICKS 16384            // Largest number of bricks
+#define MAX_TILES 256               // Largest number of matches shown at once
+#define MAX_ARENA 32767             // Largest width or height of the arena in pixels (a snapshot packs them in 16 bits)
+#define MAX_SCORE 65535             // Largest score that ends a match (idem)
+#define MAX_REWIND_SECONDS 600      // Largest duration of the history kept for rewinding in seconds
+
+// Side of the arena where a paddle defends its wall.
+typedef enum Side
+{
+    SIDE_LEFT,                      // Left wall (the paddle moves vertically)
+    SIDE_RIGHT,                     // Right wall (the paddle moves vertically)
+    SIDE_TOP,                       // Top wall (the paddle moves horizontally)
+    SIDE_BOTTOM,                    // Bottom wall (the paddle moves horizontally)
+} Side;
+
+// Sides of the paddles of a match, in the order of the paddles.
+typedef struct Lineup
+{
+    guint count;                    // Number of paddles
+    Side sides[MAX_PADDLES];        // Side of each paddle
+} Lineup;
+
+// Tunables of the game.
+// (Set from the defaults, then the config file, then the command line.)
+typedef struct Config
+{
+    gint width;                     // Width of the arena in pixels
+    gint height;                    // Height of the arena in pixels
+    gint paddle_width;              // Width of a paddle in pixels
+    gint paddle_height;             // Height of a paddle in pixels
+    gint paddle_step;               // Step of a paddle in pixels
+    gint paddle_period;             // Period of a paddle in milliseconds
+    gint disc_size;                 // Width and height of the disc in pixels
+    gdouble disc_speed;             // Horizontal and vertical speed of the disc in pixels per tick
+    gint tick_period;               // Period of the game tick in milliseconds
+    gint end_game_score;            // Maximum number of points for a player
+    gint64 seed;                    // Seed of the random number generator
+    gboolean headless;              // Runs without a user interface
+    gint64 ticks;                   // Number of ticks of a headless run
+    gint rewind_seconds;            // Duration of the history kept for rewinding in seconds
+    Control p1_control;             // Controller of player 1
+    Control p2_control;             // Controller of player 2
+    Control others_control;         // Controller of the paddles after the first two
+    Lineup lineup;                  // Sides of the paddles
+    gint brick_columns;             // Number of columns of bricks between the paddles (0 if none)
+    gint brick_rows;                // Number of rows of bricks
+    gint brick_gap;                 // Space between two bricks in pixels
+    gboolean static_bricks;         // The bricks are not destroyed by the disc
+    gboolean bot_fallback;          // A late bot follows the disc (it keeps its last move otherwise)
+    Mlp *model;                     // Network of the neural paddles, loaded from its file (NULL if none)
+    Script *script;                 // Bot of the scripted paddles, assembled from its file (NULL if none)
+    gint script_budget;             // Largest number of instructions run by a bot in a tick
+    gint tiles;                     // Number of matches shown in a grid of tiles by duel (0 for a single match)
+    gchar *file;                    // Config file (NULL if none)
+} Config;
+
+// Sets the default tunables.
+void config_defaults(Config *config);
+
+// Sets the tunables from the config file and the command line.
+// (The options of the program, if any, are parsed with them. The options are removed
+// from the arguments; returns FALSE on error, or on an unknown option unless 'ignore_unknown'
+// is TRUE: they are then left for another parser, as the one of GTK.)
+gboolean config_parse(Config *config, const GOptionEntry *options, gboolean ignore_unknown,
+                      int *argc, char ***argv, GError **error);
+
+// Converts the name of a controller (keys, follow, noisy, predict, neural or script).
+// (Returns FALSE if it is unknown.)
+gboolean config_parse_control(const gchar *name, Control *control, GError **error);
+
+// Sets a number, integer or boolean tunable by its name (as on the command line).
+// (Returns FALSE, keeping the tunables, if it is out of range or not an integer for an integer
+// tunable: G_OPTION_ERROR_BAD_VALUE, or unknown or not a number: G_OPTION_ERROR_UNKNOWN_OPTION.)
+gboolean config_set_number(Config *config, const gchar *name, gdouble value, GError **error);
+
+// Sets a tunable by its name from its value as on the command line ("true" or "false" for a boolean).
+// (Returns FALSE, keeping the tunables, if it is unknown, not valid or out of range.)
+gboolean config_set(Config *config, const gchar *name, const gchar *value, GError **error);
+
+// Gets the tunables, one "<prefix><name> <value>" line each, as read back by 'config_set'.
+// (The network and the script are not written. Free the text with g_free.)
+gchar *config_format(const Config *config, const gchar *prefix);
+
+// Writes the lines of 'config_format' to a file.
+void config_write(const Config *config, FILE *file, const gchar *prefix);
+
+// Reads the config file again.
+// (The arena size, the seed, the headless settings, the rewind duration, the paddles, the bricks,
+// the network, the script and the tiles are kept.)
+gboolean config_reload(Config *config, GError **error);
+
+// Calls a function each time the config file is written.
+// (Returns FALSE if the file cannot be watched.)
+gboolean config_watch(const Config *config, GSourceFunc callback, gpointer user_data);
+
+#endif
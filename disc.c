@@ -1,57 +1,6 @@
 #include <gtk/gtk.h>
 
-#define PADDLE_STEP 5               // Step of a paddle in pixels
-#define PADDLE_PERIOD 5             // Period of a paddle in milliseconds
-#define DISC_PERIOD 4               // Period of the disc in milliseconds
-#define END_GAME_SCORE 5            // Maximum number of points for a player
-
-// State of the game.
-typedef enum State
-{
-    STOP,                           // Stop state
-    PLAY,                           // Play state
-    PAUSE,                          // Pause state
-} State;
-
-// Structure of a player.
-typedef struct Player
-{
-    GdkRectangle rect;              // Position and size of the player's paddle
-    gint step;                      // Vertical step of the player's paddle in pixels
-    guint score;                    // Score
-    GtkLabel* label;                // Label used to display the score
-    guint event;                    // Event ID used to move the paddle
-} Player;
-
-// Structure of the disc.
-typedef struct Disc
-{
-    GdkRectangle rect;              // Position and size
-    GdkPoint step;                  // Horizontal and verical steps in pixels
-    guint period;                   // Period in milliseconds
-    guint event;                    // Event ID used to move the disc
-} Disc;
-
-// Structure of the graphical user interface.
-typedef struct UserInterface
-{
-    GtkWindow* window;              // Main window
-    GtkDrawingArea* area;           // Drawing area
-    GtkButton* start_button;        // Start button
-    GtkButton* stop_button;         // Stop button
-    GtkScale* speed_scale;          // Speed scale
-    GtkCheckButton* training_cb;    // Training check box
-} UserInterface;
-
-// Structure of the game.
-typedef struct Game
-{
-    State state;                    // State of the game
-    Player p1;                      // Player 1
-    Player p2;                      // Player 2
-    Disc disc;                      // Disc
-    UserInterface ui;               // User interface
-} Game;
+#include "steps.h"
 
 // Event handler for the "draw" signal of the drawing area.
 gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
@@ -59,69 +8,13 @@ gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
     // Gets the 'Game' structure.
     Game *game = user_data;
 
-    // Sets the background to white.
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_paint(cr);
-
-    // Draws the disc in red.
-    cairo_set_source_rgb(cr, 1, 0, 0);
-    cairo_rectangle(cr, game->disc.rect.x, game->disc.rect.y,
-                    game->disc.rect.width, game->disc.rect.height);
-    cairo_fill(cr);
+    // Draws the disc only.
+    steps_draw(cr, NULL, 0, &game->disc.rect);
 
     // Propagates the signal.
     return FALSE;
 }
 
-// Redraws an item in the drawing area.
-void redraw_item(GtkDrawingArea *area, GdkRectangle *old, GdkRectangle *new)
-{
-    // Determines the part of the area to redraw.
-    // (The union of the previous and new positions of the disc.)
-    gdk_rectangle_union(old, new, old);
-
-    // Redraws the disc.
-    gtk_widget_queue_draw_area(GTK_WIDGET(area),
-                               old->x, old->y, old->width, old->height);
-}
-
-// Timeout function called at regular intervals to draw the disc.
-gboolean on_move_disc(gpointer user_data)
-{
-    // Gets the `Game` structure passed as parameter.
-    Game* game = user_data;
-
-    // Gets the largest coordinate for the disc.
-    gint x_max = gtk_widget_get_allocated_width(GTK_WIDGET(game->ui.area))
-                 - game->disc.rect.width;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area))
-                 - game->disc.rect.height;
-
-    // Gets the current position of the disc.
-    GdkRectangle old = game->disc.rect;
-
-    // Works out the new position of the disc.
-    game->disc.rect.x = CLAMP(game->disc.rect.x + game->disc.step.x, 0, x_max);
-    game->disc.rect.y = CLAMP(game->disc.rect.y + game->disc.step.y, 0, y_max);
-
-    //Bounce the disk against the wall
-    if (game->disc.rect.x  == 0 || game->disc.rect.x == x_max)
-    {
-        game->disc.step.x = - (game->disc.step.x);
-    }
-
-    if (game->disc.rect.y  == 0 || game->disc.rect.y == y_max)
-    {
-        game->disc.step.y = - (game->disc.step.y);
-    }
-
-    // Redraws the disc.
-    redraw_item(game->ui.area, &old, &game->disc.rect);
-
-    // Enables the next call.
-    return TRUE;
-}
-
 // Event handler for the "clicked" signal of the start button.
 void on_start(GtkButton *button, gpointer user_data)
 {
@@ -132,7 +25,7 @@ void on_start(GtkButton *button, gpointer user_data)
     // (The event ID is saved into game->disc.event.)
     if (game->disc.event == 0)
     {
-        game->disc.event = g_timeout_add(game->disc.period, on_move_disc, game);
+        game->disc.event = g_timeout_add(game->disc.period, steps_move_disc, game);
     }
 
         // If the timeout function is already activated.
@@ -151,79 +44,24 @@ int main (int argc, char *argv[])
     // Initializes GTK.
     gtk_init(NULL, NULL);
 
-    // Constructs a GtkBuilder instance.
-    GtkBuilder* builder = gtk_builder_new ();
-
-    // Loads the UI description.
+    // Loads the UI description (compiled into the binary).
     // (Exits if an error occurs.)
-    GError* error = NULL;
-    if (gtk_builder_add_from_file(builder, "duel.glade", &error) == 0)
-    {
-        g_printerr("Error loading file: %s\n", error->message);
-        g_clear_error(&error);
+    GtkBuilder* builder = steps_load("/org/gtk/duel/duel.glade");
+    if (builder == NULL)
         return 1;
-    }
-
-    // Gets the widgets.
-    GtkWindow* window = GTK_WINDOW(gtk_builder_get_object(builder, "org.gtk.duel"));
-    GtkDrawingArea* area = GTK_DRAWING_AREA(gtk_builder_get_object(builder, "area"));
-    GtkButton* start_button = GTK_BUTTON(gtk_builder_get_object(builder, "start_button"));
-    GtkButton* stop_button = GTK_BUTTON(gtk_builder_get_object(builder, "stop_button"));
-    GtkLabel* p1_score_label = GTK_LABEL(gtk_builder_get_object(builder, "p1_score_label"));
-    GtkLabel* p2_score_label = GTK_LABEL(gtk_builder_get_object(builder, "p2_score_label"));
-    GtkScale* speed_scale = GTK_SCALE(gtk_builder_get_object(builder, "speed_scale"));
-    GtkCheckButton* training_cb = GTK_CHECK_BUTTON(gtk_builder_get_object(builder, "training_cb"));
-
-    // Creates the "Game" structure.
-    Game game =
-            {
-                    .state = STOP,
 
-                    .p1 =
-                            {
-                                    .rect = { 0, 0, 10, 100 },
-                                    .step = PADDLE_STEP,
-                                    .score = 0,
-                                    .label = p1_score_label,
-                                    .event = 0,
-                            },
-
-                    .p2 =
-                            {
-                                    .rect = { 800 - 10, 0, 10, 100 },
-                                    .step = PADDLE_STEP,
-                                    .score = 0,
-                                    .label = p2_score_label,
-                                    .event = 0,
-                            },
-
-                    .disc =
-                            {
-                                    .rect = { 100, 100, 10, 10 },
-                                    .step = { 1, 1 },
-                                    .event = 0,
-                                    .period = DISC_PERIOD,
-                            },
-
-                    .ui =
-                            {
-                                    .window = window,
-                                    .area = area,
-                                    .start_button = start_button,
-                                    .stop_button = stop_button,
-                                    .speed_scale = speed_scale,
-                                    .training_cb = training_cb,
-                            },
-            };
+    // Creates the "Game" structure from the widgets.
+    Game game;
+    steps_init(&game, builder);
 
     // Connects event handlers.
-    g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
-    g_signal_connect(area, "draw", G_CALLBACK(on_draw), &game);
-    g_signal_connect(start_button, "clicked", G_CALLBACK(on_start), &game);
+    g_signal_connect(game.ui.window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
+    g_signal_connect(game.ui.area, "draw", G_CALLBACK(on_draw), &game);
+    g_signal_connect(game.ui.start_button, "clicked", G_CALLBACK(on_start), &game);
 
     // Runs the main loop.
     gtk_main();
 
     // Exits.
     return 0;
-}
\ No newline at end of file
+}
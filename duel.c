@@ -1,36 +1,81 @@
+#include <math.h>
+#include <stdio.h>
 #include <gtk/gtk.h>
 
-#define PADDLE_STEP 5               // Step of a paddle in pixels
-#define PADDLE_PERIOD 5             // Period of a paddle in milliseconds
-#define DISC_PERIOD 4               // Period of the disc in milliseconds
-#define END_GAME_SCORE 5            // Maximum number of points for a player
-
-// State of the game.
-typedef enum State
+#include "bots.h"
+#include "bricks.h"
+#include "config.h"
+#include "history.h"
+#include "render.h"
+#include "replay.h"
+#include "score.h"
+#include "sim.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "ticker.h"
+#include "tiles.h"
+#include "trace.h"
+
+#define OVERLAY_WIDTH 320           // Width of the overlay in pixels
+#define OVERLAY_HEIGHT 226          // Height of the overlay in pixels
+#define GRAPH_HEIGHT 30             // Height of a graph of the overlay in pixels
+#define SNAPSHOT_FILE "duel.snapshot" // File of the snapshot saved by 'F5' and restored by 'F9'
+
+// Structure of the score display of a player.
+typedef struct ScoreLabel
 {
-    STOP,                           // Stop state
-    PLAY,                           // Play state
-    PAUSE,                          // Pause state
-} State;
+    GtkLabel* label;                // Label used to display the score
+    guint shown;                    // Score displayed by the label
+} ScoreLabel;
 
-// Structure of a player.
-typedef struct Player
+// Structure of the input.
+typedef struct Input
 {
-    GdkRectangle rect;              // Position and size of the player's paddle
-    gint step;                      // Vertical step of the player's paddle in pixels
-    guint score;                    // Score
-    GtkLabel* label;                // Label used to display the score
-    guint event;                    // Event ID used to move the paddle
-} Player;
+    guint keys;                     // Key-state bitmask (written by the key handlers)
+    guint tick_keys;                // Keys applied by the last tick
+    Recorder recorder;              // Recorder of the match (the keys of each tick, the changes made between the ticks)
+} Input;
 
-// Structure of the disc.
-typedef struct Disc
+// Binding of a key to a paddle.
+typedef struct Binding
+{
+    guint keyval;                   // Key
+    guint paddle;                   // Index of the paddle (less than KEY_PADDLES)
+    gint direction;                 // Direction of the move (-1 upwards or leftwards, 1 downwards or rightwards)
+} Binding;
+
+// Structure of an input-to-photon latency probe.
+// (It follows one key press until the frame that shows its effect is presented.)
+typedef struct Probe
+{
+    gint64 input_time;              // Time of the key press in microseconds (0 if no probe)
+    guint key;                      // Key bit of the key press (it only moves the paddle of its binding)
+    gint64 tick_time;               // Time of the tick that applied it (0 if not applied yet)
+    gint64 frame;                   // Frame counter of the frame that shows it (-1 if not drawn yet)
+} Probe;
+
+// Structure of the latency measurements.
+typedef struct Latency
 {
-    GdkRectangle rect;              // Position and size
-    GdkPoint step;                  // Horizontal and verical steps in pixels
-    guint period;                   // Period in milliseconds
-    guint event;                    // Event ID used to move the disc
-} Disc;
+    Probe probe;                    // Probe in flight
+    Stats input_to_tick;            // Key press to tick latencies in microseconds
+    Stats input_to_photon;          // Key press to presentation latencies in microseconds
+} Latency;
+
+// Structure of the timing measurements.
+// (Always recorded: the overlay only displays them.)
+typedef struct Timing
+{
+    gint64 last_tick;               // Time of the last tick in microseconds
+    Stats tick_interval;            // Intervals between ticks in microseconds
+    gint64 second_start;            // Start of the current second of ticks
+    guint ticks;                    // Number of ticks in the current second
+    guint ticks_per_second;         // Number of ticks in the last second
+    gint64 last_frame;              // Frame time of the last drawn frame in microseconds
+    Stats frame_interval;           // Intervals between drawn frames in microseconds
+    guint64 dropped_frames;         // Number of frames missed while animating
+    Stats draw_time;                // Durations of the draw handler in microseconds
+} Timing;
 
 // Structure of the graphical user interface.
 typedef struct UserInterface
@@ -41,15 +86,29 @@ typedef struct UserInterface
     GtkButton* stop_button;         // Stop button
     GtkScale* speed_scale;          // Speed scale
     GtkCheckButton* training_cb;    // Training check box
+    GtkButton* step_back_button;    // Button that goes back one tick
+    GtkButton* step_button;         // Button that goes forward one tick
+    GtkScale* rewind_scale;         // Scale of the ticks before the last one
+    gboolean overlay;               // Overlay displayed over the drawing area
 } UserInterface;
 
 // Structure of the game.
 typedef struct Game
 {
-    State state;                    // State of the game
-    Player p1;                      // Player 1
-    Player p2;                      // Player 2
-    Disc disc;                      // Disc
+    Config config;                  // Tunables
+    Sim sim;                        // Simulation
+    ScoreLabel p1_score;            // Score display of player 1
+    ScoreLabel p2_score;            // Score display of player 2
+    Input input;                    // Input
+    Latency latency;                // Latency measurements
+    Timing timing;                  // Timing measurements
+    History history;                // Last ticks played (for rewinding)
+    guint rewind_age;               // Number of ticks rewound from the last one played
+    Ticker ticker;                  // Game tick (suspended while idle)
+    Bots bots;                      // Bots of the predicting paddles (decided on a worker thread)
+    Tiles tiles;                    // Matches shown in a grid of tiles instead of the simulation (none if 0)
+    guint events;                   // ID of the callback that handles the simulation events (0 if none)
+    gint64 startup;                 // Time main() was entered (0 if the startup is not traced)
     UserInterface ui;               // User interface
 } Game;
 
@@ -58,192 +117,387 @@ gboolean on_configure(GtkWidget *widget, GdkEvent *event, gpointer user_data)
     // Gets the 'Game' structure.
     Game *game = user_data;
 
-    // Adjust the position of the right paddle based on the new dimensions.
-    gint x_max_player = gtk_widget_get_allocated_width(widget) - game->p2.rect.width;
-    game->p2.rect.x = x_max_player;
-
-    // Adjust the position of the disc based on the new dimensions.
-    gint x_max = gtk_widget_get_allocated_width(widget) - game->disc.rect.width;
-    gint y_max_disc = gtk_widget_get_allocated_height(widget) - game->disc.rect.height;
-    game->disc.rect.x = CLAMP(game->disc.rect.x, 0, x_max);
-    game->disc.rect.y = CLAMP(game->disc.rect.y, 0, y_max_disc);
+    // Lays the tiles out again (their arenas keep their size).
+    gint width = gtk_widget_get_allocated_width(widget);
+    gint height = gtk_widget_get_allocated_height(widget);
+    if (game->tiles.count > 0)
+    {
+        if (width != game->tiles.width || height != game->tiles.height)
+        {
+            tiles_layout(&game->tiles, width, height);
+            gtk_widget_queue_draw(widget);
+        }
+        return FALSE;
+    }
 
-    // Redraw the items in the drawing area.
-    gtk_widget_queue_draw(widget);
+    // Adjust the simulation to the new dimensions.
+    // (The configure event is also sent when the size has not changed:
+    // only a resize needs a redraw of the items in the drawing area.
+    // The arena stops growing at the largest size that a snapshot can hold.)
+    width = MIN(width, MAX_ARENA);
+    height = MIN(height, MAX_ARENA);
+    if (width != game->sim.width || height != game->sim.height)
+    {
+        sim_resize(&game->sim, width, height);
+        recorder_snapshot(&game->input.recorder, &game->sim);
+        gtk_widget_queue_draw(widget);
+    }
 
     // Propagate the signal.
     return FALSE;
 }
 
-/// Event handler for the "draw" signal of the drawing area.
-gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+// Resolves the latency probe once the frame that shows the key press is presented.
+void resolve_probe(Game *game, GdkFrameClock *clock)
 {
-    // Gets the 'Game' structure.
-    Game *game = user_data;
+    Probe *probe = &game->latency.probe;
 
-    // Sets the background to white.
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_paint(cr);
+    // The effect of the key press is drawn by the current frame.
+    if (probe->frame < 0)
+    {
+        probe->frame = gdk_frame_clock_get_frame_counter(clock);
+        return;
+    }
 
-    //Draw the paddles in black
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_rectangle(cr, game->p1.rect.x, game->p1.rect.y,
-                    game->p1.rect.width, game->p1.rect.height);
-    cairo_fill(cr);
+    // The timings of the frame are no longer available: drops the probe.
+    if (probe->frame < gdk_frame_clock_get_history_start(clock))
+    {
+        probe->input_time = 0;
+        return;
+    }
 
-    cairo_rectangle(cr, game->p2.rect.x, game->p2.rect.y,
-                    game->p2.rect.width, game->p2.rect.height);
-    cairo_fill(cr);
+    // The frame has not been presented yet.
+    GdkFrameTimings *timings = gdk_frame_clock_get_timings(clock, probe->frame);
+    if (timings == NULL || !gdk_frame_timings_get_complete(timings))
+        return;
 
-    // Draws the disc in red.
-    cairo_set_source_rgb(cr, 1, 0, 0);
-    cairo_rectangle(cr, game->disc.rect.x, game->disc.rect.y,
-                    game->disc.rect.width, game->disc.rect.height);
-    cairo_fill(cr);
+    // Uses the predicted presentation time if the backend does not report the actual one.
+    gint64 presentation = gdk_frame_timings_get_presentation_time(timings);
+    if (presentation == 0)
+        presentation = gdk_frame_timings_get_predicted_presentation_time(timings);
+    if (presentation != 0)
+        stats_add(&game->latency.input_to_photon, presentation - probe->input_time);
 
-    // Propagates the signal.
-    return FALSE;
+    probe->input_time = 0;
+    gtk_widget_queue_draw_area(GTK_WIDGET(game->ui.area), 0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
 }
 
-// Redraws an item in the drawing area.
-void redraw_item(GtkDrawingArea *area, GdkRectangle *old, GdkRectangle *new)
+// Draws the rolling histogram of the samples of the window, a bar per power-of-two bucket.
+// (A bar filling the height of the graph holds all the samples; the mark under the graph
+// shows the bucket of a reference value.)
+void draw_histogram(cairo_t *cr, gdouble y, const Stats *stats, gint64 reference)
 {
-    // Determines the part of the area to redraw.
-    // (The union of the previous and new positions of the disc.)
-    gdk_rectangle_union(old, new, old);
+    guint counts[STATS_BUCKETS];
+    guint size = stats_histogram(stats, counts);
+    gdouble width = (OVERLAY_WIDTH - 10) / (gdouble) STATS_BUCKETS;
 
-    // Redraws the disc.
-    gtk_widget_queue_draw_area(GTK_WIDGET(area),
-                               old->x, old->y, old->width, old->height);
+    for (guint i = 0; i < STATS_BUCKETS && size > 0; i++)
+    {
+        gdouble height = GRAPH_HEIGHT * counts[i] / (gdouble) size;
+        cairo_rectangle(cr, 5 + i * width, y + GRAPH_HEIGHT - height, width - 1, height);
+    }
+    cairo_rectangle(cr, 5 + stats_bucket(reference) * width, y + GRAPH_HEIGHT + 1, width - 1, 2);
+    cairo_fill(cr);
 }
 
-// Sets the 'Pause' state.
-void set_pause(Game* game)
+// Draws a line of text of the overlay.
+void draw_line(cairo_t *cr, gdouble y, const gchar *line)
 {
-    // - Set the state field to PAUSE.
-    game->state = PAUSE;
+    cairo_move_to(cr, 5, y);
+    cairo_show_text(cr, line);
+}
 
-    // - Set the label of the start button to "Resume".
-    gtk_button_set_label(game->ui.start_button, "Resume");
+// Draws the overlay.
+void draw_overlay(cairo_t *cr, Game *game)
+{
+    Latency *latency = &game->latency;
+    Timing *timing = &game->timing;
+    gchar line[128];
 
-    // - Enable the stop button.
-    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), TRUE);
+    cairo_set_source_rgba(cr, 0, 0, 0, 0.6);
+    cairo_rectangle(cr, 0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
+    cairo_fill(cr);
 
-    // - Stop the on_move_disc() function.
-    g_source_remove(game->disc.event);
-    game->disc.event = 0;
-}
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_set_font_size(cr, 12);
+
+    g_snprintf(line, sizeof(line), "input-to-tick   p50 %5.1f ms  p99 %5.1f ms",
+               stats_percentile(&latency->input_to_tick, 50) / 1000.0,
+               stats_percentile(&latency->input_to_tick, 99) / 1000.0);
+    draw_line(cr, 15, line);
+
+    g_snprintf(line, sizeof(line), "input-to-photon p50 %5.1f ms  p99 %5.1f ms",
+               stats_percentile(&latency->input_to_photon, 50) / 1000.0,
+               stats_percentile(&latency->input_to_photon, 99) / 1000.0);
+    draw_line(cr, 30, line);
+
+    gint64 tick_p50 = stats_percentile(&timing->tick_interval, 50);
+    gint64 tick_p99 = stats_percentile(&timing->tick_interval, 99);
+    g_snprintf(line, sizeof(line), "ticks %u/s  interval p50 %.1f ms  jitter %.1f ms",
+               timing->ticks_per_second, tick_p50 / 1000.0, (tick_p99 - tick_p50) / 1000.0);
+    draw_line(cr, 45, line);
+
+    g_snprintf(line, sizeof(line), "frame p50 %.1f ms  p99 %.1f ms  dropped %" G_GUINT64_FORMAT,
+               stats_percentile(&timing->frame_interval, 50) / 1000.0,
+               stats_percentile(&timing->frame_interval, 99) / 1000.0,
+               timing->dropped_frames);
+    draw_line(cr, 60, line);
+
+    g_snprintf(line, sizeof(line), "draw p50 %" G_GINT64_FORMAT " us  p99 %" G_GINT64_FORMAT " us",
+               stats_percentile(&timing->draw_time, 50),
+               stats_percentile(&timing->draw_time, 99));
+    draw_line(cr, 75, line);
+
+    g_snprintf(line, sizeof(line), "wakeups %" G_GUINT64_FORMAT "  suspends %" G_GUINT64_FORMAT
+               "  rewind %u/%u (%" G_GSIZE_FORMAT " KB)",
+               game->ticker.wakeups, game->ticker.suspends, game->history.size,
+               game->history.capacity, history_memory(&game->history) / 1024);
+    draw_line(cr, 90, line);
+
+    // Sums up the bots (with the latency of the slowest one).
+    guint bots = 0;
+    guint64 late = 0;
+    gint64 bot_p99 = 0;
+    for (guint i = 0; i < KEY_PADDLES; i++)
+    {
+        const Bot *bot = &game->bots.bots[i];
+        if (bot->decisions + bot->misses == 0)
+            continue;
 
+        bots++;
+        late += bot->misses;
+        bot_p99 = MAX(bot_p99, stats_percentile(&bot->latency, 99));
+    }
+    g_snprintf(line, sizeof(line), "bots %u  decision p99 %.2f ms  late %" G_GUINT64_FORMAT,
+               bots, bot_p99 / 1000.0, late);
+    draw_line(cr, 105, line);
+
+    // Draws the distributions of the tick intervals (mark: the tick period),
+    // the frame intervals (mark: 16.7 ms) and the draw times (mark: 1 ms).
+    cairo_set_source_rgb(cr, 0.4, 1, 0.4);
+    draw_histogram(cr, 115, &timing->tick_interval, 1000 * game->config.tick_period);
+    cairo_set_source_rgb(cr, 0.4, 0.6, 1);
+    draw_histogram(cr, 115 + GRAPH_HEIGHT + 5, &timing->frame_interval, 1000000 / 60);
+    cairo_set_source_rgb(cr, 1, 0.6, 0.2);
+    draw_histogram(cr, 115 + 2 * (GRAPH_HEIGHT + 5), &timing->draw_time, 1000);
+}
 
-// Timeout function called at regular intervals to draw the disc.
-gboolean on_move_disc(gpointer user_data)
+// Records the interval since the previous drawn frame and the frames missed in between.
+void record_frame(Game *game, GdkFrameClock *clock)
 {
-    // Gets the `Game` structure passed as parameter.
-    Game* game = user_data;
-
-    // Gets the largest coordinate for the disc.
-    gint x_max = gtk_widget_get_allocated_width(GTK_WIDGET(game->ui.area))
-                 - game->disc.rect.width;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area))
-                 - game->disc.rect.height;
+    Timing *timing = &game->timing;
+    gint64 frame_time = gdk_frame_clock_get_frame_time(clock);
 
-    // Gets the current position of the disc.
-    GdkRectangle old = game->disc.rect;
+    // Several draws may happen during the same frame.
+    if (frame_time == timing->last_frame)
+        return;
 
-    // Works out the new position of the disc.
-    game->disc.rect.x = CLAMP(game->disc.rect.x + game->disc.step.x, 0, x_max);
-    game->disc.rect.y = CLAMP(game->disc.rect.y + game->disc.step.y, 0, y_max);
-
-    //Bounce the disk against the wall, add the score and pause the game
-    if (game->disc.rect.x  == 0 || game->disc.rect.x == x_max)
+    // Frames are expected continuously only when something is animated.
+    if (timing->last_frame != 0 && (game->sim.state == PLAY || game->tiles.count > 0 || game->ui.overlay))
     {
-        if(game->disc.rect.x  == 0)
-        {
-            game->p1.score += 1;
-            char *label_score_p1 = calloc(2, sizeof(char));
-            label_score_p1[0] = game->p2.score + 48;
-            gtk_label_set_label(game->p1.label, label_score_p1);
-            free(label_score_p1);
-            set_pause(game);
-        }
-
-        if(game->disc.rect.x  == x_max)
-        {
-            game->p2.score += 1;
-            char *label_score_p2 = calloc(2, sizeof(char));
-            label_score_p2[0] = game->p2.score + 48;
-            gtk_label_set_label(game->p2.label, label_score_p2);
-            free(label_score_p2);
-            set_pause(game);
-        }
+        gint64 interval = frame_time - timing->last_frame;
+        gint64 refresh = 0;
+        gdk_frame_clock_get_refresh_info(clock, frame_time, &refresh, NULL);
 
-        game->disc.step.x = - (game->disc.step.x);
+        stats_add(&timing->frame_interval, interval);
+        if (refresh > 0 && interval > refresh + refresh / 2)
+            timing->dropped_frames += (interval + refresh / 2) / refresh - 1;
     }
 
-    gboolean intersect_p1 = gdk_rectangle_intersect(&game->p1.rect, &game->disc.rect, NULL);
-    gboolean intersect_p2 = gdk_rectangle_intersect(&game->p2.rect, &game->disc.rect, NULL);
+    timing->last_frame = frame_time;
+}
+
+// Draws the tiles in the parts of the drawing area to redraw.
+// (The tiles out of these parts are skipped.)
+void draw_tiles(cairo_t *cr, const Tiles *tiles)
+{
+    cairo_rectangle_list_t *list = cairo_copy_clip_rectangle_list(cr);
+    guint count = list->status == CAIRO_STATUS_SUCCESS ? list->num_rectangles : 1;
+    Rect parts[MAX(count, 1)];
 
-    if(intersect_p1 || intersect_p2)
+    // (Without a list, the whole area is redrawn.)
+    parts[0] = (Rect) { 0, 0, tiles->width, tiles->height };
+    for (guint i = 0; i < count && list->status == CAIRO_STATUS_SUCCESS; i++)
     {
-        game->disc.step.x = - (game->disc.step.x);
+        const cairo_rectangle_t *rectangle = &list->rectangles[i];
+        gint x = (gint) floor(rectangle->x);
+        gint y = (gint) floor(rectangle->y);
+        parts[i] = (Rect) { x, y, (gint) ceil(rectangle->x + rectangle->width) - x,
+                            (gint) ceil(rectangle->y + rectangle->height) - y };
     }
 
-    if (game->disc.rect.y  == 0 || game->disc.rect.y == y_max)
+    render_tiles(cr, tiles, parts, count);
+    cairo_rectangle_list_destroy(list);
+}
+
+// Draws the drawing area.
+void draw_area(GtkWidget *widget, cairo_t *cr, Game *game)
+{
+    gint64 start = g_get_monotonic_time();
+    GdkFrameClock *clock = gtk_widget_get_frame_clock(widget);
+
+    record_frame(game, clock);
+
+    // Reports the startup time on the first frame.
+    if (G_UNLIKELY(game->startup != 0))
     {
-        game->disc.step.y = - (game->disc.step.y);
+        g_printerr("Startup: first frame %.1f ms after main()\n",
+                   (start - game->startup) / 1000.0);
+        game->startup = 0;
     }
 
-    // Redraws the disc.
-    redraw_item(game->ui.area, &old, &game->disc.rect);
+    // Follows the latency probe (if a key press has been applied).
+    if (game->latency.probe.tick_time != 0 && game->latency.probe.input_time != 0)
+        resolve_probe(game, clock);
+
+    // Draws the paddles and the disc, or the tiles.
+    if (game->tiles.count > 0)
+        draw_tiles(cr, &game->tiles);
+    else
+        render_sim(cr, &game->sim);
+
+    // Draws the overlay.
+    if (game->ui.overlay)
+        draw_overlay(cr, game);
+
+    stats_add(&game->timing.draw_time, g_get_monotonic_time() - start);
+}
+
+/// Event handler for the "draw" signal of the drawing area.
+gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+    TRACE_SCOPE("on_draw", draw_area(widget, cr, user_data));
 
-    // Enables the next call.
+    // Propagates the signal.
+    return FALSE;
+}
+
+// Redraws an item in the drawing area if it has moved.
+// (Returns TRUE if it has moved.)
+gboolean redraw_item(GtkDrawingArea *area, const Rect *old, const Rect *new)
+{
+    if (old->x == new->x && old->y == new->y)
+        return FALSE;
+
+    // Determines the part of the area to redraw.
+    // (The union of the previous and new positions of the item.)
+    Rect dirty = rect_union(old, new);
+
+    // Redraws the item.
+    TRACE_SCOPE("redraw_item", gtk_widget_queue_draw_area(GTK_WIDGET(area),
+                                                          dirty.x, dirty.y, dirty.width, dirty.height));
     return TRUE;
 }
 
-// Sets the 'Play' state.
-void set_play(Game* game)
+// Shows the history on the rewind scale.
+void show_history(Game *game)
 {
-    // - Set the state field to PLAY.
-    game->state = PLAY;
+    // (The range of a scale cannot be empty.)
+    GtkRange *range = GTK_RANGE(game->ui.rewind_scale);
+    gtk_range_set_range(range, 0, MAX(game->history.size, 2) - 1);
+    gtk_range_set_value(range, game->rewind_age);
+}
+
+// Shows a state of the game on the buttons.
+void show_state(Game* game, State state)
+{
+    // The ticks can only be rewound while the game is not played.
+    // (A new tick can only be stepped in the 'Pause' state: a stopped match is over.)
+    gboolean rewind = state != PLAY;
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.step_back_button), rewind);
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.step_button), state == PAUSE || (rewind && game->rewind_age > 0));
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.rewind_scale), rewind);
+    if (rewind)
+        show_history(game);
+
+    switch (state)
+    {
+        case STOP:
+            // - Set the label of the start button to "Start".
+            gtk_button_set_label(game->ui.start_button, "Start");
 
-    // - Set the label of the start button to "Pause".
-    gtk_button_set_label(game->ui.start_button, "Pause");
+            // - Disable the stop button.
+            gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+            break;
 
-    // - Disable the stop button.
-    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+        case PLAY:
+            // - Set the label of the start button to "Pause".
+            gtk_button_set_label(game->ui.start_button, "Pause");
 
-    // - Set the on_move_disc() function to be called at regular intervals.
-    game->disc.event = g_timeout_add(game->disc.period, on_move_disc, game);
+            // - Disable the stop button.
+            gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+            break;
+
+        case PAUSE:
+            // - Set the label of the start button to "Resume".
+            gtk_button_set_label(game->ui.start_button, "Resume");
+
+            // - Enable the stop button.
+            gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), TRUE);
+            break;
+    }
+}
 
+// Updates the label of a score if it has changed.
+void show_score(ScoreLabel* score_label, guint score)
+{
+    if (score_label->shown != score)
+    {
+        gtk_label_set_label(score_label->label, score_text(score));
+        score_label->shown = score;
+    }
 }
 
-// Sets the 'Stop' state.
-void set_stop(Game *game)
+// Handles the events emitted by the simulation since the last frame.
+// (Frame clock callback: the widgets are updated at most once per frame,
+// never from the game tick.)
+gboolean on_sim_events(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data)
 {
-    // - Set the state field to STOP.
-    game->state = STOP;
+    Game *game = user_data;
+    Event event;
 
-    // - Set the label of the start button to "Start".
-    gtk_button_set_label(game->ui.start_button, "Start");
+    const Bricks *bricks = game->sim.bricks;
+    while (sim_poll_event(&game->sim, &event))
+    {
+        if (event.type == EVENT_STATE)
+            show_state(game, event.value);
 
-    // - Disable the stop button.
-    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+        // A destroyed brick disappears, and the bricks stand again at the start and the end of a match.
+        if (bricks != NULL && event.type == EVENT_BRICK_HIT && bricks->destructible)
+        {
+            const Rect *rect = &bricks->rects[bricks->slots[event.value]];
+            gtk_widget_queue_draw_area(GTK_WIDGET(game->ui.area), rect->x, rect->y, rect->width, rect->height);
+        }
+        else if (bricks != NULL && event.type == EVENT_STATE)
+            gtk_widget_queue_draw(GTK_WIDGET(game->ui.area));
+    }
 
-    //Reset the scores
-    game->p1.score = 0;
-    game->p2.score = 0;
+    // Goals and stops change the scores.
+    // (The labels show the scores of the first two paddles.)
+    show_score(&game->p1_score, game->sim.paddles[0].score);
+    show_score(&game->p2_score, game->sim.paddle_count > 1 ? game->sim.paddles[1].score : 0);
 
-    //Set the labels
-    char *label_score_p2 = calloc(2, sizeof(char));
-    label_score_p2[0] = game->p2.score + 48;
-    gtk_label_set_label(game->p2.label, label_score_p2);
+    // Removes the callback until the next events.
+    game->events = 0;
+    return G_SOURCE_REMOVE;
+}
 
-    char *label_score_p1 = calloc(2, sizeof(char));
-    label_score_p1[0] = game->p2.score + 48;
-    gtk_label_set_label(game->p1.label, label_score_p1);
+// Schedules the handling of the simulation events on the next frame.
+void schedule_events(Game *game)
+{
+    if (game->events == 0)
+        game->events = gtk_widget_add_tick_callback(GTK_WIDGET(game->ui.window), on_sim_events, game, NULL);
+}
 
-    free(label_score_p1);
-    free(label_score_p2);
+// Resumes the game tick (if it is suspended) after an input.
+void wake_tick(Game *game)
+{
+    if (!ticker_is_running(&game->ticker))
+    {
+        // The time spent suspended is not a tick interval.
+        game->timing.last_tick = 0;
+        ticker_wake(&game->ticker);
+    }
 }
 
 // Event handler for the "clicked" signal of the start button.
@@ -252,227 +506,521 @@ void on_start(GtkButton *button, gpointer user_data)
     // Gets the `Game` structure.
     Game *game = user_data;
 
+    // The match goes on from the rewound tick: forgets the following ones.
+    if (game->sim.state != PLAY)
+    {
+        history_truncate(&game->history, game->rewind_age);
+        game->rewind_age = 0;
+    }
+
     // Sets the next state according to the current state.
-    switch (game->state)
+    switch (game->sim.state)
     {
-        case STOP: set_play(game); break;
-        case PLAY: set_pause(game); break;
-        case PAUSE: set_play(game); break;
+        case STOP: sim_set_state(&game->sim, PLAY); break;
+        case PLAY: sim_set_state(&game->sim, PAUSE); break;
+        case PAUSE: sim_set_state(&game->sim, PLAY); break;
     };
+    recorder_snapshot(&game->input.recorder, &game->sim);
 
+    schedule_events(game);
+    wake_tick(game);
 }
 
 // Event handler for the "clicked" signal of the stop button.
 void on_stop(GtkButton *button, gpointer user_data)
 {
-    set_stop(user_data);
+    Game *game = user_data;
+
+    sim_set_state(&game->sim, STOP);
+    recorder_snapshot(&game->input.recorder, &game->sim);
+    schedule_events(game);
 }
 
-gboolean move_p1_down(gpointer user_data)
+// Shows a tick of the history.
+// (The match is paused on it, or stopped if it ended there: resuming it keeps the scores and the bricks.)
+void rewind_to(Game *game, guint age)
 {
-    Game* game = user_data;
-
-    GdkRectangle old = game->p1.rect;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area)) - game->p1.rect.height;
-
-    game->p1.rect.y = CLAMP(game->p1.rect.y + game->p1.step, 0, y_max);
-    redraw_item(game->ui.area, &old, &game->p1.rect);
-
-    return TRUE;
+    if (!history_restore(&game->history, age, &game->sim))
+        return;
+    recorder_snapshot(&game->input.recorder, &game->sim);
+
+    game->rewind_age = age;
+    show_state(game, game->sim.state);
+    gtk_widget_queue_draw(GTK_WIDGET(game->ui.area));
+    schedule_events(game);
 }
 
-gboolean move_p1_up(gpointer user_data)
+// Event handler for the "clicked" signal of the step back button.
+void on_step_back(GtkButton *button, gpointer user_data)
 {
-    Game* game = user_data;
-
-    GdkRectangle old = game->p1.rect;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area)) - game->p1.rect.height;
-
-    game->p1.rect.y = CLAMP(game->p1.rect.y - game->p1.step, 0, y_max);
-    redraw_item(game->ui.area, &old, &game->p1.rect);
-
-    return TRUE;
+    Game *game = user_data;
 
+    rewind_to(game, game->rewind_age + 1);
+    show_history(game);
 }
 
-gboolean move_p2_down(gpointer user_data)
+// Gets the keys of the next tick and records them.
+// (The key-state mask is sampled once, so that the whole tick sees the same input.
+// The bots move their paddles by the keys: their moves, and the paddles they move, are recorded as such.)
+guint collect_keys(Game *game)
 {
-    Game* game = user_data;
-
-    GdkRectangle old = game->p2.rect;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area)) - game->p2.rect.height;
-
-    game->p2.rect.y = CLAMP(game->p2.rect.y + game->p2.step, 0, y_max);
-    redraw_item(game->ui.area, &old, &game->p2.rect);
-
-    return TRUE;
+    guint bot_keys = bots_collect(&game->bots, &game->sim, game->config.bot_fallback);
+    guint keys = (g_atomic_int_get(&game->input.keys) & ~game->bots.keys) | bot_keys;
+    game->input.tick_keys = keys;
+    recorder_remote(&game->input.recorder, game->sim.remote_keys);
+    recorder_add(&game->input.recorder, keys);
+    return keys;
 }
 
-gboolean move_p2_up(gpointer user_data)
+// Event handler for the "clicked" signal of the step button.
+void on_step(GtkButton *button, gpointer user_data)
 {
-    Game* game = user_data;
+    Game *game = user_data;
+    Sim *sim = &game->sim;
+
+    // Shows the next tick of the history, or runs a new one as if the game was played
+    // with the keys held and the moves of the bots.
+    // (The tick is out of the game loop: its keys are recorded, then its result as a snapshot,
+    // since the replay plays it in the 'Pause' state.)
+    if (game->rewind_age > 0)
+        rewind_to(game, game->rewind_age - 1);
+    else if (sim->state == PAUSE)
+    {
+        guint keys = collect_keys(game);
+        sim->state = PLAY;
+        sim_step(sim, keys);
+        history_push(&game->history, sim);
+        bots_send(&game->bots, sim);
+
+        // (A goal changes the state and emits its event.)
+        if (sim->state == PLAY)
+            sim->state = PAUSE;
+        recorder_snapshot(&game->input.recorder, sim);
+
+        gtk_widget_queue_draw(GTK_WIDGET(game->ui.area));
+        schedule_events(game);
+    }
 
-    GdkRectangle old = game->p2.rect;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area)) - game->p2.rect.height;
+    show_history(game);
+}
 
-    game->p2.rect.y = CLAMP(game->p2.rect.y - game->p2.step, 0, y_max);
-    redraw_item(game->ui.area, &old, &game->p2.rect);
+// Event handler for the "value-changed" signal of the rewind scale.
+void on_rewind_changed(GtkRange *range, gpointer user_data)
+{
+    Game *game = user_data;
+    guint age = (guint) gtk_range_get_value(range);
 
-    return TRUE;
+    if (game->sim.state != PLAY && age != game->rewind_age)
+        rewind_to(game, age);
 }
 
-gboolean follow_rectangle(gpointer user_data)
+// Records the interval since the previous tick and the number of ticks per second.
+void record_tick(Game *game)
 {
-    Game* game = user_data;
+    Timing *timing = &game->timing;
+    gint64 now = g_get_monotonic_time();
 
-    GdkRectangle old = game->p1.rect;
-    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area)) - game->p1.rect.height;
+    if (timing->last_tick != 0)
+        stats_add(&timing->tick_interval, now - timing->last_tick);
+    timing->last_tick = now;
 
-    game->p1.rect.y = CLAMP(game->disc.rect.y - game->p1.rect.height / 2, 0, y_max);
-    redraw_item(game->ui.area, &old, &game->p1.rect);
+    timing->ticks++;
+    if (now - timing->second_start >= G_USEC_PER_SEC)
+    {
+        timing->ticks_per_second = timing->ticks;
+        timing->ticks = 0;
+        timing->second_start = now;
+    }
+}
 
-    return TRUE;
+// Redraws a part of a tile that has changed.
+void redraw_tile(const Rect *part, gpointer user_data)
+{
+    gtk_widget_queue_draw_area(GTK_WIDGET(user_data), part->x, part->y, part->width, part->height);
 }
 
-// Event handler for the "key-press-event" signal.
-gboolean on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+// Runs one tick of the game.
+// (Returns FALSE once the game is idle.)
+gboolean run_tick(Game *game)
 {
-    Game *game = user_data;
 
-    // If the 'f' key is pressed, moves the player 1 upwards.
-    if (event->keyval == GDK_KEY_f)
+    record_tick(game);
+
+    // Runs a tick of the matches of the tiles instead (played by bots: never idle).
+    if (game->tiles.count > 0)
     {
-        if (game->p1.event == 0)
-        {
-            game->p1.event = g_timeout_add(PADDLE_PERIOD, move_p1_up, game);
-        }
+        tiles_step(&game->tiles, redraw_tile, game->ui.area);
+        if (game->ui.overlay)
+            gtk_widget_queue_draw_area(GTK_WIDGET(game->ui.area), 0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
         return TRUE;
     }
 
-        // If the 'v' key is pressed, moves the player 1 downwards.
-    else if (event->keyval == GDK_KEY_v)
+    // Runs one tick of the simulation.
+    // (Every tick is recorded: the paddles also move out of the 'Play' state.)
+    guint keys = collect_keys(game);
+    Sim *sim = &game->sim;
+    Rect paddles[MAX_PADDLES];
+    for (guint i = 0; i < sim->paddle_count; i++)
+        paddles[i] = sim->paddles[i].rect;
+    Rect disc = sim->disc.rect;
+
+    gboolean playing = sim->state == PLAY;
+    gboolean moving = sim_step(sim, keys);
+    if (playing)
+        history_push(&game->history, sim);
+
+    // The bots decide the next tick from this state meanwhile.
+    bots_send(&game->bots, sim);
+
+    // Redraws the items that have moved.
+    // (Only the paddle of the key of the probe shows the effect of its key press,
+    // if the tick has applied the key.)
+    Probe *probe = &game->latency.probe;
+    gboolean moved = FALSE;
+    for (guint i = 0; i < sim->paddle_count; i++)
     {
-        if (game->p1.event == 0)
-        {
-            game->p1.event = g_timeout_add(PADDLE_PERIOD, move_p1_down, game);
-        }
-        return TRUE;
+        const Paddle *paddle = &sim->paddles[i];
+        if (redraw_item(game->ui.area, &paddles[i], &paddle->rect))
+            moved |= (probe->key & keys & (paddle->up | paddle->down)) != 0;
     }
+    redraw_item(game->ui.area, &disc, &sim->disc.rect);
 
-        // If the 'Up Arrow' key is pressed, moves the player 2 upwards.
-    else if (event->keyval == GDK_KEY_Up)
+    // Follows the latency probe.
+    if (probe->input_time != 0)
     {
-        if (game->p2.event == 0)
+        // This tick applies the key press.
+        // (If no paddle has moved, nothing will be shown: drops the probe.)
+        if (probe->tick_time == 0)
         {
-            game->p2.event = g_timeout_add(PADDLE_PERIOD, move_p2_up, game);
+            if (moved)
+            {
+                probe->tick_time = g_get_monotonic_time();
+                stats_add(&game->latency.input_to_tick, probe->tick_time - probe->input_time);
+            }
+            else
+                probe->input_time = 0;
         }
-        return TRUE;
+
+        // The frame is waiting for its presentation: requests the next frame to check it.
+        else if (probe->frame >= 0)
+            gtk_widget_queue_draw_area(GTK_WIDGET(game->ui.area), 0, 0, 1, 1);
     }
 
-        // If the 'Down Arrow' key is pressed, moves the player 2 downwards.
-    else if (event->keyval == GDK_KEY_Down)
-    {
-        if (game->p2.event == 0)
-        {
-            game->p2.event = g_timeout_add(PADDLE_PERIOD, move_p2_down, game);
-        }
+    // Handles the events of the simulation on the next frame.
+    if (sim_has_events(sim))
+        schedule_events(game);
 
-        return TRUE;
+    // Refreshes the overlay.
+    if (game->ui.overlay)
+        gtk_widget_queue_draw_area(GTK_WIDGET(game->ui.area), 0, 0, OVERLAY_WIDTH, OVERLAY_HEIGHT);
+
+    // Enables the next call while something can move or is measured.
+    // (Out of the 'Play' state, nothing moves without a key held or a moving paddle.)
+    return moving || keys != 0 || probe->input_time != 0 || game->ui.overlay;
+}
+
+// Timeout function called at regular intervals to run one tick of the game.
+// (Returns FALSE once the game is idle: the tick is suspended until the next input.)
+gboolean on_tick(gpointer user_data)
+{
+    gboolean running;
+    TRACE_SCOPE("tick", running = run_tick(user_data));
+    return running;
+}
+
+// Keys of the paddles moved by the keys.
+static const Binding bindings[] =
+        {
+                { GDK_KEY_f, 0, -1 },
+                { GDK_KEY_v, 0, 1 },
+                { GDK_KEY_Up, 1, -1 },
+                { GDK_KEY_Down, 1, 1 },
+                { GDK_KEY_z, 2, -1 },
+                { GDK_KEY_x, 2, 1 },
+                { GDK_KEY_Left, 3, -1 },
+                { GDK_KEY_Right, 3, 1 },
+        };
+
+// Gets the bit of the key-state mask bound to a key (0 if the key is not bound).
+guint key_bit(guint keyval)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(bindings); i++)
+    {
+        if (bindings[i].keyval == keyval)
+            return bindings[i].direction < 0 ? KEY_UP(bindings[i].paddle) : KEY_DOWN(bindings[i].paddle);
     }
 
-        // Otherwise, propagates the signal.
-    else
-        return FALSE;
+    return 0;
 }
 
-// Event handler for the "key-release-event" signal.
-gboolean on_key_release(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+// Gets the time of a key event on the monotonic clock in microseconds.
+gint64 key_event_time(const GdkEventKey *event)
 {
-    Game *game = user_data;
+    gint64 now = g_get_monotonic_time();
 
-    // Check the state of the checkbox
-    gboolean active = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(game->ui.training_cb));
+    // The event time is in milliseconds and, on most backends, on the monotonic clock.
+    // (Otherwise, falls back on the time the event is received.)
+    guint32 age = (guint32) (now / 1000) - event->time;
+    return age < 1000 ? now - (gint64) age * 1000 : now;
+}
 
+// Saves the match to the snapshot file.
+void save_match(Game *game)
+{
+    Snapshot snapshot;
+    snapshot_save(&game->sim, &snapshot);
+
+    if (!snapshot_write(&snapshot, SNAPSHOT_FILE))
+        g_printerr("Error writing file: %s\n", SNAPSHOT_FILE);
+}
 
-    // If the 'f' key is released, stops the player 1.
-    if (event->keyval == GDK_KEY_f && active == FALSE)
+// Restores the match from the snapshot file.
+void restore_match(Game *game)
+{
+    Snapshot snapshot;
+    if (!snapshot_read(&snapshot, SNAPSHOT_FILE) || !snapshot_restore(&game->sim, &snapshot))
     {
-        g_source_remove(game->p1.event);
-        game->p1.event = 0;
-        return TRUE;
+        g_printerr("Error reading snapshot: %s\n", SNAPSHOT_FILE);
+        return;
     }
 
-    // If the 'v' key is released, stops the player 1.
-    if (event->keyval == GDK_KEY_v && active == FALSE)
+    // The history belongs to another match (which may have another number of paddles).
+    if (game->history.paddle_count != game->sim.paddle_count)
     {
-        g_source_remove(game->p1.event);
-        game->p1.event = 0;
-        return TRUE;
+        guint capacity = game->history.capacity;
+        history_free(&game->history);
+        history_init(&game->history, capacity, game->sim.paddle_count);
     }
+    history_truncate(&game->history, game->history.size);
+    game->rewind_age = 0;
+
+    // The match may have been saved in an arena of another size.
+    GtkWidget *area = GTK_WIDGET(game->ui.area);
+    sim_resize(&game->sim, MIN(gtk_widget_get_allocated_width(area), MAX_ARENA),
+               MIN(gtk_widget_get_allocated_height(area), MAX_ARENA));
+
+    // Shows the restored controller of player 1 on the training checkbox.
+    Control control = game->sim.paddles[0].control;
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(game->ui.training_cb), control == CONTROL_FOLLOW);
+    game->sim.paddles[0].control = control;
+    recorder_snapshot(&game->input.recorder, &game->sim);
+
+    gtk_widget_queue_draw(area);
+    schedule_events(game);
+    wake_tick(game);
+}
+
+// Event handler for the "key-press-event" signal.
+gboolean on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+    TRACE_INSTANT("key_press");
+
+    Game *game = user_data;
 
-    // If the 'Up Arrow' key is released, stops the player 2.
-    if (event->keyval == GDK_KEY_Up)
+    // If the 'F1' key is pressed, shows or hides the overlay.
+    if (event->keyval == GDK_KEY_F1)
     {
-        g_source_remove(game->p2.event);
-        game->p2.event = 0;
+        game->ui.overlay = !game->ui.overlay;
+        gtk_widget_queue_draw(GTK_WIDGET(game->ui.area));
+        wake_tick(game);
         return TRUE;
     }
 
-    // If the 'Down Arrow' key is released, stops the player 2.
-    if (event->keyval == GDK_KEY_Down)
+    // If the 'F5' or 'F9' key is pressed, saves or restores the match.
+    if (event->keyval == GDK_KEY_F5 || event->keyval == GDK_KEY_F9)
     {
-        g_source_remove(game->p2.event);
-        game->p2.event = 0;
+        if (event->keyval == GDK_KEY_F5)
+            save_match(game);
+        else
+            restore_match(game);
         return TRUE;
     }
 
-        // Otherwise, propagates the signal.
-    else
+    // If the key is not bound, propagates the signal.
+    guint bit = key_bit(event->keyval);
+    if (bit == 0)
+        return FALSE;
+
+    // Sets the bit of the key; the next tick moves the paddle.
+    guint old = g_atomic_int_or(&game->input.keys, bit);
+
+    // Starts a latency probe on a new key press (not on auto-repeat).
+    Probe *probe = &game->latency.probe;
+    if ((old & bit) == 0 && probe->input_time == 0)
+    {
+        probe->input_time = key_event_time(event);
+        probe->key = bit;
+        probe->tick_time = 0;
+        probe->frame = -1;
+    }
+
+    wake_tick(game);
+    return TRUE;
+}
+
+// Event handler for the "key-release-event" signal.
+gboolean on_key_release(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+    TRACE_INSTANT("key_release");
+
+    Game *game = user_data;
+
+    // If the key is not bound, propagates the signal.
+    guint bit = key_bit(event->keyval);
+    if (bit == 0)
         return FALSE;
+
+    // Clears the bit of the key only; the other keys keep their state.
+    g_atomic_int_and(&game->input.keys, ~bit);
+    return TRUE;
 }
 
+// Event handler for the "focus-out-event" signal of the window.
+gboolean on_focus_out(GtkWidget *widget, GdkEvent *event, gpointer user_data)
+{
+    Game *game = user_data;
+
+    // The key releases will not be received any more: releases all the keys.
+    g_atomic_int_set(&game->input.keys, 0);
+
+    // Propagates the signal.
+    return FALSE;
+}
+
+// Event handler for the "value-changed" signal of the speed scale.
+void on_speed_changed(GtkRange *range, gpointer user_data)
+{
+    Game *game = user_data;
+
+    // The next tick uses the new time scale (the game tick is not reinstalled).
+    game->sim.scale = (gint) (gtk_range_get_value(range) * FIXED_ONE);
+    recorder_snapshot(&game->input.recorder, &game->sim);
+}
 
 // Event handler for when the training button is toggled
 gboolean on_training_toggled(GtkWidget *widget, gpointer user_data)
 {
     Game *game = user_data;
 
-    // Check the state of the checkbox
+    // Player 1 follows the disc as long as the checkbox is active.
     gboolean active = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(game->ui.training_cb));
+    game->sim.paddles[0].control = active ? CONTROL_FOLLOW : game->config.p1_control;
+    recorder_snapshot(&game->input.recorder, &game->sim);
+
+    // The paddle may have to move towards the disc.
+    wake_tick(game);
+    return TRUE;
+}
+
+// Applies the config file when it is written.
+gboolean on_config_changed(gpointer user_data)
+{
+    Game *game = user_data;
 
-    if (active)
+    // Keeps the current tunables if the file is not valid.
+    GError *error = NULL;
+    if (!config_reload(&game->config, &error))
     {
-        // Add the timeout function so that p1 follows the triangle.
-        game->p1.event = g_timeout_add(PADDLE_PERIOD, follow_rectangle, game);
+        g_printerr("Error reloading config: %s\n", error->message);
+        g_clear_error(&error);
+        return G_SOURCE_CONTINUE;
     }
-    else
+
+    sim_apply_config(&game->sim, &game->config);
+    recorder_config(&game->input.recorder, &game->config);
+    on_training_toggled(GTK_WIDGET(game->ui.training_cb), game);
+
+    // Reinstalls the game tick with its new period.
+    ticker_set_period(&game->ticker, game->config.tick_period);
+
+    // The sizes of the items may have changed.
+    gtk_widget_queue_draw(GTK_WIDGET(game->ui.area));
+    return G_SOURCE_CONTINUE;
+}
+
+// Runs matches without a user interface and prints the final scores.
+// (The match is resumed after each goal, until the end of a match or the number of ticks.)
+int run_headless(const Config *config)
+{
+    Sim sim;
+    sim_init(&sim, config);
+    sim_set_state(&sim, PLAY);
+
+    gint64 tick = 0;
+    for (; tick < config->ticks && sim.state != STOP; tick++)
     {
-        // Remove the timeout function so that p1 stops following the triangle.
-        g_source_remove(game->p1.event);
-        game->p1.event = 0;
+        sim_step(&sim, 0);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (event.type == EVENT_STATE && event.value == PAUSE)
+                sim_set_state(&sim, PLAY);
+        }
     }
 
-    return TRUE;
+    printf("ticks %" G_GINT64_FORMAT "  score %u - %u\n", tick, sim.paddles[0].score,
+           sim.paddle_count > 1 ? sim.paddles[1].score : 0);
+    sim_free(&sim);
+    return 0;
 }
 
 
+// Gets whether an option is given on the command line.
+gboolean has_option(int argc, char *argv[], const gchar *option)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (g_strcmp0(argv[i], option) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
 int main (int argc, char *argv[])
 {
+    // Times the startup (if requested).
+    gint64 startup = has_option(argc, argv, "--startup-trace") ? g_get_monotonic_time() : 0;
+
+    // Gets the tunables from the config file and the command line.
+    // (Exits if an error occurs. The unknown options are left to GTK.)
+    Config config;
+    config_defaults(&config);
+    GError* error = NULL;
+    if (!config_parse(&config, NULL, TRUE, &argc, &argv, &error))
+    {
+        g_printerr("Error in the options: %s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
+
+    if (config.headless)
+        return run_headless(&config);
+
     // Initializes GTK.
-    gtk_init(NULL, NULL);
+    gtk_init(&argc, &argv);
+
+    // Enables tracing (if requested).
+    trace_init();
+
+    // Formats the texts of the scores.
+    score_init();
 
     // Constructs a GtkBuilder instance.
     GtkBuilder* builder = gtk_builder_new ();
 
-    // Loads the UI description.
+    // Loads the UI description (compiled into the binary).
     // (Exits if an error occurs.)
-    GError* error = NULL;
-    if (gtk_builder_add_from_file(builder, "duel.glade", &error) == 0)
+    guint loaded;
+    TRACE_SCOPE("load_ui", loaded = gtk_builder_add_from_resource(builder, "/org/gtk/duel/duel.glade", &error));
+    if (loaded == 0)
     {
-        g_printerr("Error loading file: %s\n", error->message);
+        g_printerr("Error loading resource: %s\n", error->message);
         g_clear_error(&error);
         return 1;
     }
+    if (startup != 0)
+        g_printerr("Startup: UI loaded %.1f ms after main()\n", (g_get_monotonic_time() - startup) / 1000.0);
 
     // Gets the widgets.
     GtkWindow* window = GTK_WINDOW(gtk_builder_get_object(builder, "org.gtk.duel"));
@@ -483,37 +1031,28 @@ int main (int argc, char *argv[])
     GtkLabel* p2_score_label = GTK_LABEL(gtk_builder_get_object(builder, "p2_score_label"));
     GtkScale* speed_scale = GTK_SCALE(gtk_builder_get_object(builder, "speed_scale"));
     GtkCheckButton* training_cb = GTK_CHECK_BUTTON(gtk_builder_get_object(builder, "training_cb"));
+    GtkButton* step_back_button = GTK_BUTTON(gtk_builder_get_object(builder, "step_back_button"));
+    GtkButton* step_button = GTK_BUTTON(gtk_builder_get_object(builder, "step_button"));
+    GtkScale* rewind_scale = GTK_SCALE(gtk_builder_get_object(builder, "rewind_scale"));
 
     // Creates the "Game" structure.
     Game game =
             {
-                    .state = STOP,
+                    .config = config,
 
-                    .p1 =
+                    .p1_score =
                             {
-                                    .rect = { 0, 0, 10, 100 },
-                                    .step = PADDLE_STEP,
-                                    .score = 0,
                                     .label = p1_score_label,
-                                    .event = 0,
+                                    .shown = 0,
                             },
 
-                    .p2 =
+                    .p2_score =
                             {
-                                    .rect = { 800 - 10, 0, 10, 100 },
-                                    .step = PADDLE_STEP,
-                                    .score = 0,
                                     .label = p2_score_label,
-                                    .event = 0,
+                                    .shown = 0,
                             },
 
-                    .disc =
-                            {
-                                    .rect = { 100, 100, 10, 10 },
-                                    .step = { 1, 1 },
-                                    .event = 0,
-                                    .period = DISC_PERIOD,
-                            },
+                    .startup = startup,
 
                     .ui =
                             {
@@ -523,9 +1062,24 @@ int main (int argc, char *argv[])
                                     .stop_button = stop_button,
                                     .speed_scale = speed_scale,
                                     .training_cb = training_cb,
+                                    .step_back_button = step_back_button,
+                                    .step_button = step_button,
+                                    .rewind_scale = rewind_scale,
                             },
             };
 
+    // Initializes the simulation, or the matches of the tiles (resized or laid out when the
+    // drawing area is configured).
+    sim_init(&game.sim, &game.config);
+    tiles_init(&game.tiles, &game.config, game.config.tiles);
+    gtk_widget_set_size_request(GTK_WIDGET(area), game.config.width, game.config.height);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(training_cb), game.config.p1_control == CONTROL_FOLLOW);
+
+    // Allocates the history of the last ticks once (its memory is shown on the overlay).
+    // (The tunables bound the rewind, so that its number of ticks fits.)
+    history_init(&game.history, (guint) ((gint64) game.config.rewind_seconds * 1000 / game.config.tick_period),
+                 game.config.lineup.count);
+
     // Connects event handlers.
     g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
     g_signal_connect(area, "configure-event", G_CALLBACK(on_configure), &game);
@@ -534,11 +1088,71 @@ int main (int argc, char *argv[])
     g_signal_connect(stop_button, "clicked", G_CALLBACK(on_stop), &game);
     g_signal_connect(window, "key_press_event", G_CALLBACK(on_key_press), &game);
     g_signal_connect(window, "key_release_event", G_CALLBACK(on_key_release), &game);
+    g_signal_connect(window, "focus-out-event", G_CALLBACK(on_focus_out), &game);
     g_signal_connect(training_cb, "toggled", G_CALLBACK(on_training_toggled), &game);
+    g_signal_connect(speed_scale, "value-changed", G_CALLBACK(on_speed_changed), &game);
+    g_signal_connect(step_back_button, "clicked", G_CALLBACK(on_step_back), &game);
+    g_signal_connect(step_button, "clicked", G_CALLBACK(on_step), &game);
+    g_signal_connect(rewind_scale, "value-changed", G_CALLBACK(on_rewind_changed), &game);
+
+    // Gets the initial time scale.
+    on_speed_changed(GTK_RANGE(speed_scale), &game);
+
+    // Decides the predicting paddles on a worker thread.
+    bots_start(&game.bots);
+
+    // Runs the game tick at regular intervals.
+    // (It is the only timeout source: the paddles and the disc all move from it.
+    // It is suspended while the game is idle, and resumed by the inputs.)
+    ticker_start(&game.ticker, game.config.tick_period, on_tick, &game);
+
+    // Applies the config file each time it is written.
+    config_watch(&game.config, on_config_changed, &game);
+
+    // Records the match (if requested).
+    const gchar *record_file = g_getenv("PONG_RECORD");
+    if (record_file != NULL && !recorder_open(&game.input.recorder, record_file, &game.config, &game.sim))
+    {
+        g_printerr("Error opening file: %s\n", record_file);
+        return 1;
+    }
 
     // Runs the main loop.
     gtk_main();
 
+    recorder_close(&game.input.recorder);
+    bots_stop(&game.bots);
+    history_free(&game.history);
+    sim_free(&game.sim);
+    tiles_free(&game.tiles);
+
+    // Writes the latency measurements (if requested).
+    const gchar *latency_file = g_getenv("PONG_LATENCY_FILE");
+    if (latency_file != NULL)
+    {
+        FILE *file = fopen(latency_file, "w");
+        if (file == NULL)
+        {
+            g_printerr("Error opening file: %s\n", latency_file);
+            return 1;
+        }
+        stats_dump(file, "input-to-tick", "us", &game.latency.input_to_tick);
+        stats_dump(file, "input-to-photon", "us", &game.latency.input_to_photon);
+        for (guint i = 0; i < KEY_PADDLES; i++)
+        {
+            const Bot *bot = &game.bots.bots[i];
+            if (bot->decisions + bot->misses == 0)
+                continue;
+
+            gchar name[32];
+            g_snprintf(name, sizeof(name), "bot-%u-decision", i);
+            stats_dump(file, name, "us", &bot->latency);
+            fprintf(file, "bot-%u-late: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " ticks\n",
+                    i, bot->misses, bot->decisions + bot->misses);
+        }
+        fclose(file);
+    }
+
     // Exits.
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "history.h"
+#include "bricks.h"
+
+G_STATIC_ASSERT(sizeof(HistoryState) == 28);
+G_STATIC_ASSERT(sizeof(HistoryPaddle) == 6);
+G_STATIC_ASSERT(MAX_BRICKS <= G_MAXUINT16);
+
+void history_init(History *history, guint capacity, guint paddle_count)
+{
+    capacity = MAX(capacity, 1);
+
+    *history = (History)
+            {
+                    .states = g_new(HistoryState, capacity),
+                    .paddles = g_new(HistoryPaddle, (gsize) capacity * paddle_count),
+                    .paddle_count = paddle_count,
+                    .capacity = capacity,
+            };
+}
+
+void history_free(History *history)
+{
+    g_free(history->states);
+    g_free(history->paddles);
+    history->states = NULL;
+    history->paddles = NULL;
+    history->capacity = 0;
+    history->size = 0;
+}
+
+void history_push(History *history, const Sim *sim)
+{
+    history->states[history->next] = (HistoryState)
+            {
+                    .disc_position = sim->disc.position,
+                    .disc_step = sim->disc.step,
+                    .rng = sim->rng,
+                    .tick = sim->tick,
+                    .destroyed = sim->bricks != NULL ? sim->bricks->destroyed_count : 0,
+                    .state = sim->state,
+            };
+
+    // (Each paddle only moves along its wall.)
+    HistoryPaddle *paddles = &history->paddles[history->next * history->paddle_count];
+    for (guint i = 0; i < history->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        gboolean horizontal = paddle->side == SIDE_TOP || paddle->side == SIDE_BOTTOM;
+        paddles[i] = (HistoryPaddle) { horizontal ? paddle->rect.x : paddle->rect.y, paddle->fraction, paddle->score };
+    }
+
+    history->next = (history->next + 1) % history->capacity;
+    history->size = MIN(history->size + 1, history->capacity);
+}
+
+gboolean history_restore(const History *history, guint age, Sim *sim)
+{
+    if (age >= history->size || sim->paddle_count != history->paddle_count)
+        return FALSE;
+
+    guint index = (history->next + history->capacity - 1 - age) % history->capacity;
+    const HistoryState *state = &history->states[index];
+
+    sim->disc.position = state->disc_position;
+    sim->disc.rect.x = state->disc_position.x >> FIXED_SHIFT;
+    sim->disc.rect.y = state->disc_position.y >> FIXED_SHIFT;
+    sim->disc.step = state->disc_step;
+    sim->rng = state->rng;
+    sim->tick = state->tick;
+    sim->state = state->state == PLAY ? PAUSE : state->state;
+    if (sim->bricks != NULL)
+        bricks_rewind(sim->bricks, state->destroyed);
+
+    const HistoryPaddle *paddles = &history->paddles[index * history->paddle_count];
+    for (guint i = 0; i < history->paddle_count; i++)
+    {
+        Paddle *paddle = &sim->paddles[i];
+        if (paddle->side == SIDE_TOP || paddle->side == SIDE_BOTTOM)
+            paddle->rect.x = paddles[i].position;
+        else
+            paddle->rect.y = paddles[i].position;
+        paddle->fraction = paddles[i].fraction;
+        paddle->score = paddles[i].score;
+    }
+
+    // The arena may have been resized since.
+    sim_resize(sim, sim->width, sim->height);
+    return TRUE;
+}
+
+void history_truncate(History *history, guint age)
+{
+    age = MIN(age, history->size);
+    history->next = (history->next + history->capacity - age) % history->capacity;
+    history->size -= age;
+}
+
+gsize history_memory(const History *history)
+{
+    return history->capacity * (sizeof(HistoryState) + history->paddle_count * sizeof(HistoryPaddle));
+}
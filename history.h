@@ -0,0 +1,64 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <glib.h>
+
+#include "sim.h"
+
+// State of a simulation at one tick, packed for the history (28 bytes).
+// (Only what changes from tick to tick: the sizes, the steps of the paddles,
+// the controllers and the time scale are not kept.)
+typedef struct HistoryState
+{
+    Point disc_position;            // Position of the disc in fixed-point pixels
+    Point disc_step;                // Steps of the disc in fixed-point pixels per tick
+    guint32 rng;                    // State of the random number generator
+    guint32 tick;                   // Tick of the simulation
+    guint16 destroyed;              // Number of destroyed bricks
+    guint16 state;                  // State of the game after the tick
+} HistoryState;
+
+// State of a paddle at one tick (6 bytes: 40 bytes a tick with two paddles).
+typedef struct HistoryPaddle
+{
+    gint16 position;                // Position along its wall
+    guint16 fraction;               // Fraction of a pixel of its position in fixed point
+    guint16 score;                  // Score
+} HistoryPaddle;
+
+// History of the last ticks of a simulation.
+// (Ring buffer allocated once: the oldest states are overwritten.)
+typedef struct History
+{
+    HistoryState *states;           // States
+    HistoryPaddle *paddles;         // States of the paddles ('paddle_count' per state)
+    guint paddle_count;             // Number of paddles of the simulation
+    guint capacity;                 // Number of states kept
+    guint size;                     // Number of states recorded (at most the capacity)
+    guint next;                     // Index of the next state
+} History;
+
+// Allocates a history for a number of states of a simulation with a number of paddles.
+void history_init(History *history, guint capacity, guint paddle_count);
+
+// Frees a history.
+void history_free(History *history);
+
+// Records the state of a simulation.
+void history_push(History *history, const Sim *sim);
+
+// Restores a recorded state (age 0 is the most recent one).
+// (Returns FALSE if there is no such state, or if the simulation has another number of paddles.
+// A tick played is restored in the 'Pause' state, so that the match resumes from it. The bricks
+// destroyed since are stood again, and those stood by the end of the match are destroyed again,
+// but not those of a previous match.)
+gboolean history_restore(const History *history, guint age, Sim *sim);
+
+// Forgets the states more recent than a state.
+// (The simulation continues from it: the forgotten ticks will not happen any more.)
+void history_truncate(History *history, guint age);
+
+// Gets the memory used by the states in bytes.
+gsize history_memory(const History *history);
+
+#endif
@@ -0,0 +1,749 @@
+#include "mlp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MLP_X86 1
+#endif
+
+#define MLP_MAGIC 0x504C4D50        // "PMLP": first bytes of a network file
+#define MLP_VERSION 1               // Version of the layout of a network file
+
+// Defines the kernels of a set from its products of one row.
+// (The loop over the rows is in the kernel, where the products of a row are inlined.)
+#define LAYER_KERNELS(name, attributes) \
+    attributes static void dot_##name(const gfloat *weights, const gfloat *inputs, guint stride, guint rows, \
+                                      gfloat *sums) \
+    { \
+        for (guint row = 0; row < rows; row++) \
+            sums[row] = dot_row_##name(weights + row * stride, inputs, stride); \
+    } \
+    attributes static void dot4_##name(const gfloat *weights, const gfloat *inputs[4], guint stride, guint rows, \
+                                       gfloat *sums[4]) \
+    { \
+        for (guint row = 0; row < rows; row++) \
+        { \
+            gfloat row_sums[4]; \
+            dot4_row_##name(weights + row * stride, inputs, stride, row_sums); \
+            for (guint k = 0; k < 4; k++) \
+                sums[k][row] = row_sums[k]; \
+        } \
+    } \
+    attributes static void qdot_##name(const gint8 *weights, const gint8 *inputs, guint stride, guint rows, \
+                                       gint32 *sums) \
+    { \
+        for (guint row = 0; row < rows; row++) \
+            sums[row] = qdot_row_##name(weights + row * stride, inputs, stride); \
+    } \
+    attributes static void qdot4_##name(const gint8 *weights, const gint8 *inputs[4], guint stride, guint rows, \
+                                        gint32 *sums[4]) \
+    { \
+        for (guint row = 0; row < rows; row++) \
+        { \
+            gint32 row_sums[4]; \
+            qdot4_row_##name(weights + row * stride, inputs, stride, row_sums); \
+            for (guint k = 0; k < 4; k++) \
+                sums[k][row] = row_sums[k]; \
+        } \
+    }
+
+// Adds the 8 lanes of a float product in a fixed order.
+// (((0 + 4) + (2 + 6)) + ((1 + 5) + (3 + 7)), as the vector kernels do.)
+static gfloat reduce_lanes(const gfloat lanes[8])
+{
+    gfloat s0 = lanes[0] + lanes[4];
+    gfloat s1 = lanes[1] + lanes[5];
+    gfloat s2 = lanes[2] + lanes[6];
+    gfloat s3 = lanes[3] + lanes[7];
+    return (s0 + s2) + (s1 + s3);
+}
+
+static gfloat dot_row_scalar(const gfloat *weights, const gfloat *inputs, guint stride)
+{
+    gfloat lanes[8] = { 0 };
+
+    for (guint i = 0; i < stride; i += 8)
+    {
+        for (guint j = 0; j < 8; j++)
+            lanes[j] += weights[i + j] * inputs[i + j];
+    }
+
+    return reduce_lanes(lanes);
+}
+
+static void dot4_row_scalar(const gfloat *weights, const gfloat *inputs[4], guint stride, gfloat sums[4])
+{
+    for (guint k = 0; k < 4; k++)
+        sums[k] = dot_row_scalar(weights, inputs[k], stride);
+}
+
+static gint32 qdot_row_scalar(const gint8 *weights, const gint8 *inputs, guint stride)
+{
+    gint32 sum = 0;
+
+    for (guint i = 0; i < stride; i++)
+        sum += weights[i] * inputs[i];
+
+    return sum;
+}
+
+static void qdot4_row_scalar(const gint8 *weights, const gint8 *inputs[4], guint stride, gint32 sums[4])
+{
+    for (guint k = 0; k < 4; k++)
+        sums[k] = qdot_row_scalar(weights, inputs[k], stride);
+}
+
+LAYER_KERNELS(scalar, )
+
+static const MlpKernels scalar_kernels = { "scalar", dot_scalar, dot4_scalar, qdot_scalar, qdot4_scalar };
+
+#ifdef MLP_X86
+
+// Adds the lanes of the two halves of a float product (lanes 0 to 3, then 4 to 7).
+static gfloat reduce_sse2(__m128 low, __m128 high)
+{
+    __m128 s = _mm_add_ps(low, high);
+    __m128 t = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+}
+
+// Adds the lanes of an int32 product.
+static gint32 qreduce_sse2(__m128i sum)
+{
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// Multiplies 16 int8 weights with 16 int8 inputs into 4 int32 sums.
+// (SSE2 has no int8 product: both are widened to int16 by their signs.)
+static __m128i qproduct_sse2(__m128i weights, __m128i inputs)
+{
+    __m128i w_low = _mm_srai_epi16(_mm_unpacklo_epi8(weights, weights), 8);
+    __m128i w_high = _mm_srai_epi16(_mm_unpackhi_epi8(weights, weights), 8);
+    __m128i x_low = _mm_srai_epi16(_mm_unpacklo_epi8(inputs, inputs), 8);
+    __m128i x_high = _mm_srai_epi16(_mm_unpackhi_epi8(inputs, inputs), 8);
+    return _mm_add_epi32(_mm_madd_epi16(w_low, x_low), _mm_madd_epi16(w_high, x_high));
+}
+
+static gfloat dot_row_sse2(const gfloat *weights, const gfloat *inputs, guint stride)
+{
+    __m128 low = _mm_setzero_ps();
+    __m128 high = _mm_setzero_ps();
+
+    for (guint i = 0; i < stride; i += 8)
+    {
+        low = _mm_add_ps(low, _mm_mul_ps(_mm_loadu_ps(weights + i), _mm_loadu_ps(inputs + i)));
+        high = _mm_add_ps(high, _mm_mul_ps(_mm_loadu_ps(weights + i + 4), _mm_loadu_ps(inputs + i + 4)));
+    }
+
+    return reduce_sse2(low, high);
+}
+
+static void dot4_row_sse2(const gfloat *weights, const gfloat *inputs[4], guint stride, gfloat sums[4])
+{
+    __m128 low[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+    __m128 high[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+
+    for (guint i = 0; i < stride; i += 8)
+    {
+        __m128 w_low = _mm_loadu_ps(weights + i);
+        __m128 w_high = _mm_loadu_ps(weights + i + 4);
+        for (guint k = 0; k < 4; k++)
+        {
+            low[k] = _mm_add_ps(low[k], _mm_mul_ps(w_low, _mm_loadu_ps(inputs[k] + i)));
+            high[k] = _mm_add_ps(high[k], _mm_mul_ps(w_high, _mm_loadu_ps(inputs[k] + i + 4)));
+        }
+    }
+
+    for (guint k = 0; k < 4; k++)
+        sums[k] = reduce_sse2(low[k], high[k]);
+}
+
+static gint32 qdot_row_sse2(const gint8 *weights, const gint8 *inputs, guint stride)
+{
+    __m128i sum = _mm_setzero_si128();
+
+    for (guint i = 0; i < stride; i += 16)
+    {
+        __m128i w = _mm_loadu_si128((const __m128i*) (weights + i));
+        sum = _mm_add_epi32(sum, qproduct_sse2(w, _mm_loadu_si128((const __m128i*) (inputs + i))));
+    }
+
+    return qreduce_sse2(sum);
+}
+
+static void qdot4_row_sse2(const gint8 *weights, const gint8 *inputs[4], guint stride, gint32 sums[4])
+{
+    __m128i sum[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+    for (guint i = 0; i < stride; i += 16)
+    {
+        __m128i w = _mm_loadu_si128((const __m128i*) (weights + i));
+        for (guint k = 0; k < 4; k++)
+            sum[k] = _mm_add_epi32(sum[k], qproduct_sse2(w, _mm_loadu_si128((const __m128i*) (inputs[k] + i))));
+    }
+
+    for (guint k = 0; k < 4; k++)
+        sums[k] = qreduce_sse2(sum[k]);
+}
+
+LAYER_KERNELS(sse2, )
+
+static const MlpKernels sse2_kernels = { "sse2", dot_sse2, dot4_sse2, qdot_sse2, qdot4_sse2 };
+
+// The AVX2 kernels are compiled for AVX2 only, and used if the processor has it.
+// (Not for FMA: a fused multiply-add would round differently from the other kernels.)
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static gfloat reduce_avx2(__m256 sum)
+{
+    return reduce_sse2(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+}
+
+AVX2 static gint32 qreduce_avx2(__m256i sum)
+{
+    return qreduce_sse2(_mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+}
+
+AVX2 static gfloat dot_row_avx2(const gfloat *weights, const gfloat *inputs, guint stride)
+{
+    __m256 sum = _mm256_setzero_ps();
+
+    for (guint i = 0; i < stride; i += 8)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(weights + i), _mm256_loadu_ps(inputs + i)));
+
+    return reduce_avx2(sum);
+}
+
+AVX2 static void dot4_row_avx2(const gfloat *weights, const gfloat *inputs[4], guint stride, gfloat sums[4])
+{
+    __m256 sum[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (guint i = 0; i < stride; i += 8)
+    {
+        __m256 w = _mm256_loadu_ps(weights + i);
+        for (guint k = 0; k < 4; k++)
+            sum[k] = _mm256_add_ps(sum[k], _mm256_mul_ps(w, _mm256_loadu_ps(inputs[k] + i)));
+    }
+
+    for (guint k = 0; k < 4; k++)
+        sums[k] = reduce_avx2(sum[k]);
+}
+
+AVX2 static gint32 qdot_row_avx2(const gint8 *weights, const gint8 *inputs, guint stride)
+{
+    __m256i sum = _mm256_setzero_si256();
+
+    for (guint i = 0; i < stride; i += 16)
+    {
+        __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (weights + i)));
+        __m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (inputs + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(w, x));
+    }
+
+    return qreduce_avx2(sum);
+}
+
+AVX2 static void qdot4_row_avx2(const gint8 *weights, const gint8 *inputs[4], guint stride, gint32 sums[4])
+{
+    __m256i sum[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+    for (guint i = 0; i < stride; i += 16)
+    {
+        __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (weights + i)));
+        for (guint k = 0; k < 4; k++)
+        {
+            __m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) (inputs[k] + i)));
+            sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(w, x));
+        }
+    }
+
+    for (guint k = 0; k < 4; k++)
+        sums[k] = qreduce_avx2(sum[k]);
+}
+
+LAYER_KERNELS(avx2, AVX2)
+
+static const MlpKernels avx2_kernels = { "avx2", dot_avx2, dot4_avx2, qdot_avx2, qdot4_avx2 };
+
+#endif
+
+// Gets the best kernels of the processor.
+// (The PONG_MLP_KERNELS environment variable can force other ones: scalar, sse2 or avx2.)
+static const MlpKernels *best_kernels(void)
+{
+    const MlpKernels *available[3] = { &scalar_kernels };
+    guint count = 1;
+
+#ifdef MLP_X86
+    available[count++] = &sse2_kernels;
+    if (__builtin_cpu_supports("avx2"))
+        available[count++] = &avx2_kernels;
+#endif
+
+    const gchar *forced = g_getenv("PONG_MLP_KERNELS");
+    for (guint i = 0; forced != NULL && i < count; i++)
+    {
+        if (g_strcmp0(forced, available[i]->name) == 0)
+            return available[i];
+    }
+
+    return available[count - 1];
+}
+
+// Rounds a number of inputs up to a multiple of MLP_LANES.
+static guint padded(guint inputs)
+{
+    return (inputs + MLP_LANES - 1) / MLP_LANES * MLP_LANES;
+}
+
+// Allocates the arrays of a layer.
+static void layer_init(MlpLayer *layer, guint inputs, guint outputs, gboolean quantized)
+{
+    *layer = (MlpLayer)
+            {
+                    .inputs = inputs,
+                    .outputs = outputs,
+                    .stride = padded(inputs),
+                    .quantized = quantized,
+                    .input_scale = 1,
+                    .bias = g_new0(gfloat, outputs),
+            };
+
+    if (quantized)
+    {
+        layer->qweights = g_new0(gint8, outputs * layer->stride);
+        layer->row_scales = g_new0(gfloat, outputs);
+        layer->scales = g_new0(gfloat, outputs);
+    }
+    else
+        layer->weights = g_new0(gfloat, outputs * layer->stride);
+}
+
+// Frees the arrays of a layer.
+static void layer_free(MlpLayer *layer)
+{
+    g_free(layer->weights);
+    g_free(layer->qweights);
+    g_free(layer->row_scales);
+    g_free(layer->scales);
+    g_free(layer->bias);
+}
+
+Mlp *mlp_new(const guint *widths, guint layer_count)
+{
+    Mlp *mlp = g_new0(Mlp, 1);
+    mlp->layer_count = layer_count;
+    mlp->kernels = best_kernels();
+
+    for (guint i = 0; i < layer_count; i++)
+        layer_init(&mlp->layers[i], widths[i], widths[i + 1], FALSE);
+
+    return mlp;
+}
+
+void mlp_free(Mlp *mlp)
+{
+    if (mlp == NULL)
+        return;
+
+    for (guint i = 0; i < mlp->layer_count; i++)
+        layer_free(&mlp->layers[i]);
+    g_free(mlp);
+}
+
+// Converts the inputs of a quantized layer to int8 (rounded half away from zero).
+// (The padding stays zero.)
+static void quantize_inputs(const MlpLayer *layer, const gfloat *inputs, gint8 *quantized)
+{
+    gfloat inverse = 1 / layer->input_scale;
+    for (guint i = 0; i < layer->inputs; i++)
+    {
+        gfloat value = CLAMP(inputs[i] * inverse, -127, 127);
+        quantized[i] = (gint8) (value + copysignf(0.5f, value));
+    }
+    memset(quantized + layer->inputs, 0, layer->stride - layer->inputs);
+}
+
+// Applies the bias and the activation to the sums of the rows of a layer.
+static void finish_layer(const MlpLayer *layer, gfloat *outputs, gboolean last)
+{
+    for (guint row = 0; row < layer->outputs; row++)
+    {
+        gfloat output = outputs[row] + layer->bias[row];
+        outputs[row] = last ? output : MAX(output, 0);
+    }
+}
+
+// Works out the outputs of a layer for one input.
+// (The outputs are padded with zeros for the next layer.)
+static void run_layer(const Mlp *mlp, const MlpLayer *layer, const gfloat *inputs, gfloat *outputs, gboolean last)
+{
+    if (layer->quantized)
+    {
+        gint8 quantized[MLP_MAX_WIDTH];
+        gint32 sums[MLP_MAX_WIDTH];
+        quantize_inputs(layer, inputs, quantized);
+        mlp->kernels->qdot(layer->qweights, quantized, layer->stride, layer->outputs, sums);
+        for (guint row = 0; row < layer->outputs; row++)
+            outputs[row] = sums[row] * layer->scales[row];
+    }
+    else
+        mlp->kernels->dot(layer->weights, inputs, layer->stride, layer->outputs, outputs);
+
+    finish_layer(layer, outputs, last);
+    memset(outputs + layer->outputs, 0, (padded(layer->outputs) - layer->outputs) * sizeof(gfloat));
+}
+
+// Works out the outputs of a layer for four inputs.
+// (The same bits as four runs of 'run_layer'.)
+static void run_layer4(const Mlp *mlp, const MlpLayer *layer, gfloat *inputs[4], gfloat *outputs[4], gboolean last)
+{
+    if (layer->quantized)
+    {
+        gint8 quantized[4][MLP_MAX_WIDTH];
+        gint32 sums[4][MLP_MAX_WIDTH];
+        const gint8 *rows[4] = { quantized[0], quantized[1], quantized[2], quantized[3] };
+        gint32 *row_sums[4] = { sums[0], sums[1], sums[2], sums[3] };
+        for (guint k = 0; k < 4; k++)
+            quantize_inputs(layer, inputs[k], quantized[k]);
+
+        mlp->kernels->qdot4(layer->qweights, rows, layer->stride, layer->outputs, row_sums);
+        for (guint k = 0; k < 4; k++)
+        {
+            for (guint row = 0; row < layer->outputs; row++)
+                outputs[k][row] = sums[k][row] * layer->scales[row];
+        }
+    }
+    else
+    {
+        const gfloat *rows[4] = { inputs[0], inputs[1], inputs[2], inputs[3] };
+        mlp->kernels->dot4(layer->weights, rows, layer->stride, layer->outputs, outputs);
+    }
+
+    for (guint k = 0; k < 4; k++)
+    {
+        finish_layer(layer, outputs[k], last);
+        memset(outputs[k] + layer->outputs, 0, (padded(layer->outputs) - layer->outputs) * sizeof(gfloat));
+    }
+}
+
+// Works out the outputs of the first layers of a network for one observation.
+// (Returns the buffer that holds them.)
+static gfloat *run_layers(const Mlp *mlp, guint count, const gfloat *observation, gfloat buffers[2][MLP_MAX_WIDTH])
+{
+    gfloat *inputs = buffers[0];
+    memcpy(inputs, observation, MLP_OBSERVATIONS * sizeof(gfloat));
+    memset(inputs + MLP_OBSERVATIONS, 0, (padded(MLP_OBSERVATIONS) - MLP_OBSERVATIONS) * sizeof(gfloat));
+
+    for (guint i = 0; i < count; i++)
+    {
+        gfloat *outputs = buffers[(i + 1) % 2];
+        run_layer(mlp, &mlp->layers[i], inputs, outputs, i == mlp->layer_count - 1);
+        inputs = outputs;
+    }
+
+    return inputs;
+}
+
+// Gets the move of the largest output (the first one on a tie).
+static gint best_action(const gfloat *outputs)
+{
+    guint best = 0;
+    for (guint i = 1; i < MLP_ACTIONS; i++)
+    {
+        if (outputs[i] > outputs[best])
+            best = i;
+    }
+
+    return (gint) best - 1;
+}
+
+void mlp_forward(const Mlp *mlp, const gfloat *observation, gfloat *outputs)
+{
+    gfloat buffers[2][MLP_MAX_WIDTH];
+    memcpy(outputs, run_layers(mlp, mlp->layer_count, observation, buffers), MLP_ACTIONS * sizeof(gfloat));
+}
+
+gint mlp_decide(const Mlp *mlp, const gfloat *observation)
+{
+    gfloat buffers[2][MLP_MAX_WIDTH];
+    return best_action(run_layers(mlp, mlp->layer_count, observation, buffers));
+}
+
+// Decides the moves of four observations.
+static void decide4(const Mlp *mlp, const gfloat *observations, gint *directions)
+{
+    gfloat buffers[2][4][MLP_MAX_WIDTH];
+    gfloat *inputs[4], *outputs[4];
+
+    for (guint k = 0; k < 4; k++)
+    {
+        inputs[k] = buffers[0][k];
+        memcpy(inputs[k], observations + k * MLP_OBSERVATIONS, MLP_OBSERVATIONS * sizeof(gfloat));
+        memset(inputs[k] + MLP_OBSERVATIONS, 0, (padded(MLP_OBSERVATIONS) - MLP_OBSERVATIONS) * sizeof(gfloat));
+    }
+
+    for (guint j = 0; j < mlp->layer_count; j++)
+    {
+        for (guint k = 0; k < 4; k++)
+            outputs[k] = buffers[(j + 1) % 2][k];
+        run_layer4(mlp, &mlp->layers[j], inputs, outputs, j == mlp->layer_count - 1);
+        memcpy(inputs, outputs, sizeof(inputs));
+    }
+
+    for (guint k = 0; k < 4; k++)
+        directions[k] = best_action(inputs[k]);
+}
+
+void mlp_decide_batch(const Mlp *mlp, const gfloat *observations, guint count, gint *directions)
+{
+    guint i = 0;
+    for (; i + 4 <= count; i += 4)
+        decide4(mlp, observations + i * MLP_OBSERVATIONS, directions + i);
+
+    // Decides the last observations one by one.
+    for (; i < count; i++)
+        directions[i] = mlp_decide(mlp, observations + i * MLP_OBSERVATIONS);
+}
+
+// Gets the largest absolute value of an array (1 if they are all zero).
+static gfloat largest(const gfloat *values, guint count)
+{
+    gfloat max = 0;
+    for (guint i = 0; i < count; i++)
+        max = MAX(max, fabsf(values[i]));
+    return max > 0 ? max : 1;
+}
+
+void mlp_quantize(Mlp *mlp, const gfloat *observations, guint count)
+{
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        MlpLayer *layer = &mlp->layers[i];
+        if (layer->quantized)
+            continue;
+
+        // Takes the step of the inputs from the outputs of the layers before (already quantized).
+        gfloat max = 0;
+        for (guint j = 0; j < count; j++)
+        {
+            gfloat buffers[2][MLP_MAX_WIDTH];
+            const gfloat *inputs = run_layers(mlp, i, observations + j * MLP_OBSERVATIONS, buffers);
+            max = MAX(max, largest(inputs, layer->inputs));
+        }
+
+        MlpLayer quantized;
+        layer_init(&quantized, layer->inputs, layer->outputs, TRUE);
+        quantized.input_scale = (count > 0 ? max : 1) / 127;
+        memcpy(quantized.bias, layer->bias, layer->outputs * sizeof(gfloat));
+
+        for (guint row = 0; row < layer->outputs; row++)
+        {
+            const gfloat *weights = layer->weights + row * layer->stride;
+            gint8 *qweights = quantized.qweights + row * quantized.stride;
+            gfloat step = largest(weights, layer->inputs) / 127;
+
+            for (guint j = 0; j < layer->inputs; j++)
+                qweights[j] = (gint8) CLAMP(floorf(weights[j] / step + 0.5f), -127, 127);
+            quantized.row_scales[row] = step;
+            quantized.scales[row] = quantized.input_scale * step;
+        }
+
+        layer_free(layer);
+        *layer = quantized;
+    }
+}
+
+// Writes packed little-endian values to a byte array.
+static void put_u16(GByteArray *bytes, guint16 value)
+{
+    guint8 p[2] = { value, value >> 8 };
+    g_byte_array_append(bytes, p, 2);
+}
+
+static void put_u32(GByteArray *bytes, guint32 value)
+{
+    guint8 p[4] = { value, value >> 8, value >> 16, value >> 24 };
+    g_byte_array_append(bytes, p, 4);
+}
+
+static void put_float(GByteArray *bytes, gfloat value)
+{
+    guint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u32(bytes, bits);
+}
+
+gboolean mlp_save(const Mlp *mlp, const gchar *path)
+{
+    GByteArray *bytes = g_byte_array_new();
+    put_u32(bytes, MLP_MAGIC);
+    put_u16(bytes, MLP_VERSION);
+    put_u16(bytes, mlp->layer_count);
+
+    // Layer: inputs, outputs, type (0 float, 1 int8), the int8 steps, the weights without padding, the bias.
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        const MlpLayer *layer = &mlp->layers[i];
+        put_u16(bytes, layer->inputs);
+        put_u16(bytes, layer->outputs);
+        put_u16(bytes, layer->quantized);
+
+        if (layer->quantized)
+        {
+            put_float(bytes, layer->input_scale);
+            for (guint row = 0; row < layer->outputs; row++)
+                put_float(bytes, layer->row_scales[row]);
+            for (guint row = 0; row < layer->outputs; row++)
+                g_byte_array_append(bytes, (const guint8*) layer->qweights + row * layer->stride, layer->inputs);
+        }
+        else
+        {
+            for (guint row = 0; row < layer->outputs; row++)
+            {
+                for (guint j = 0; j < layer->inputs; j++)
+                    put_float(bytes, layer->weights[row * layer->stride + j]);
+            }
+        }
+
+        for (guint row = 0; row < layer->outputs; row++)
+            put_float(bytes, layer->bias[row]);
+    }
+
+    FILE *file = fopen(path, "wb");
+    gboolean ok = file != NULL && fwrite(bytes->data, bytes->len, 1, file) == 1;
+    ok = (file == NULL || fclose(file) == 0) && ok;
+    g_byte_array_free(bytes, TRUE);
+    return ok;
+}
+
+// Reader of the bytes of a network file.
+typedef struct Reader
+{
+    const guint8 *p;                // Next byte
+    const guint8 *end;              // End of the bytes
+    gboolean overrun;               // A value has been read past the end
+} Reader;
+
+// Reads packed little-endian values (0 past the end).
+static const guint8 *take(Reader *reader, gsize size)
+{
+    if ((gsize) (reader->end - reader->p) < size)
+    {
+        reader->overrun = TRUE;
+        return NULL;
+    }
+
+    const guint8 *p = reader->p;
+    reader->p += size;
+    return p;
+}
+
+static guint16 get_u16(Reader *reader)
+{
+    const guint8 *p = take(reader, 2);
+    return p != NULL ? p[0] | p[1] << 8 : 0;
+}
+
+static guint32 get_u32(Reader *reader)
+{
+    const guint8 *p = take(reader, 4);
+    return p != NULL ? p[0] | p[1] << 8 | p[2] << 16 | (guint32) p[3] << 24 : 0;
+}
+
+static gfloat get_float(Reader *reader)
+{
+    guint32 bits = get_u32(reader);
+    gfloat value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Reads a layer.
+// (Returns FALSE if a step is not a positive number.)
+static gboolean read_layer(Reader *reader, MlpLayer *layer, guint inputs, guint outputs, gboolean quantized)
+{
+    layer_init(layer, inputs, outputs, quantized);
+    gboolean ok = TRUE;
+
+    if (quantized)
+    {
+        layer->input_scale = get_float(reader);
+        ok = isfinite(layer->input_scale) && layer->input_scale > 0 && isfinite(1 / layer->input_scale);
+        for (guint row = 0; row < outputs; row++)
+        {
+            layer->row_scales[row] = get_float(reader);
+            layer->scales[row] = layer->input_scale * layer->row_scales[row];
+            ok = ok && isfinite(layer->row_scales[row]) && layer->row_scales[row] > 0;
+        }
+
+        for (guint row = 0; row < outputs; row++)
+        {
+            const guint8 *p = take(reader, inputs);
+            if (p != NULL)
+                memcpy(layer->qweights + row * layer->stride, p, inputs);
+        }
+    }
+    else
+    {
+        for (guint row = 0; row < outputs; row++)
+        {
+            for (guint j = 0; j < inputs; j++)
+                layer->weights[row * layer->stride + j] = get_float(reader);
+        }
+    }
+
+    for (guint row = 0; row < outputs; row++)
+        layer->bias[row] = get_float(reader);
+
+    return ok;
+}
+
+Mlp *mlp_load(const gchar *path, GError **error)
+{
+    gchar *data;
+    gsize size;
+    if (!g_file_get_contents(path, &data, &size, error))
+        return NULL;
+
+    Reader reader = { (const guint8*) data, (const guint8*) data + size, FALSE };
+    guint32 magic = get_u32(&reader);
+    guint16 version = get_u16(&reader);
+    guint16 layer_count = get_u16(&reader);
+
+    Mlp *mlp = g_new0(Mlp, 1);
+    mlp->kernels = best_kernels();
+    gboolean ok = magic == MLP_MAGIC && version == MLP_VERSION && layer_count >= 1 && layer_count <= MLP_MAX_LAYERS;
+
+    // The layers are chained from the observations to the actions.
+    guint width = MLP_OBSERVATIONS;
+    for (guint i = 0; ok && i < layer_count; i++)
+    {
+        guint16 inputs = get_u16(&reader);
+        guint16 outputs = get_u16(&reader);
+        guint16 type = get_u16(&reader);
+
+        ok = inputs == width && outputs >= 1 && outputs <= MLP_MAX_WIDTH && type <= 1;
+        if (ok)
+        {
+            ok = read_layer(&reader, &mlp->layers[i], inputs, outputs, type == 1);
+            mlp->layer_count = i + 1;
+            width = outputs;
+        }
+    }
+
+    g_free(data);
+    if (!ok || width != MLP_ACTIONS || reader.overrun || reader.p != reader.end)
+    {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Not a valid network: %s", path);
+        mlp_free(mlp);
+        return NULL;
+    }
+
+    return mlp;
+}
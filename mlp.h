@@ -0,0 +1,78 @@
+#ifndef MLP_H
+#define MLP_H
+
+#include <glib.h>
+
+#define MLP_OBSERVATIONS 8          // Number of inputs of a network (see 'sim_observe')
+#define MLP_ACTIONS 3               // Number of outputs of a network (up, still, down)
+#define MLP_MAX_LAYERS 4            // Largest number of layers of a network
+#define MLP_MAX_WIDTH 256           // Largest number of inputs or outputs of a layer
+#define MLP_LANES 16                // Rows of weights are padded with zeros to a multiple of this
+
+// Layer of a network: fully connected, followed by a ReLU except for the last one.
+// (The weights are stored row by row, a row per output.)
+typedef struct MlpLayer
+{
+    guint inputs;                   // Number of inputs
+    guint outputs;                  // Number of outputs
+    guint stride;                   // Length of a row of weights (the inputs padded to MLP_LANES)
+    gboolean quantized;             // The weights are int8 (floats otherwise)
+    gfloat *weights;                // Float weights (NULL if quantized)
+    gint8 *qweights;                // Int8 weights (NULL if not quantized)
+    gfloat input_scale;             // Step of the int8 inputs of a quantized layer
+    gfloat *row_scales;             // Step of the int8 weights of each row of a quantized layer
+    gfloat *scales;                 // Step of the products of each row (input_scale * row_scales)
+    gfloat *bias;                   // Bias of each output
+} MlpLayer;
+
+// Kernels of the products of the rows of weights of a layer with its inputs.
+// (All the kernels give the same bits: the int8 products are exact, and the float ones
+// add the products in the same order, on 8 lanes, without fused multiply-adds.)
+typedef struct MlpKernels
+{
+    const gchar *name;              // Name (scalar, sse2 or avx2)
+    void (*dot)(const gfloat *weights, const gfloat *inputs, guint stride, guint rows, gfloat *sums);
+    void (*dot4)(const gfloat *weights, const gfloat *inputs[4], guint stride, guint rows, gfloat *sums[4]);
+    void (*qdot)(const gint8 *weights, const gint8 *inputs, guint stride, guint rows, gint32 *sums);
+    void (*qdot4)(const gint8 *weights, const gint8 *inputs[4], guint stride, guint rows, gint32 *sums[4]);
+} MlpKernels;
+
+// Multilayer perceptron that maps the observations of a paddle to its move.
+typedef struct Mlp
+{
+    guint layer_count;              // Number of layers
+    MlpLayer layers[MLP_MAX_LAYERS]; // Layers
+    const MlpKernels *kernels;      // Kernels used (the best ones of the processor)
+} Mlp;
+
+// Allocates a network of float layers with zero weights.
+// (The widths are the inputs of the first layer, then the outputs of each layer.)
+Mlp *mlp_new(const guint *widths, guint layer_count);
+
+// Loads a network from a file.
+// (Returns NULL on error.)
+Mlp *mlp_load(const gchar *path, GError **error);
+
+// Saves a network to a file.
+// (Returns FALSE if the file cannot be written.)
+gboolean mlp_save(const Mlp *mlp, const gchar *path);
+
+// Frees a network.
+void mlp_free(Mlp *mlp);
+
+// Quantizes the float layers of a network to int8.
+// (The steps of the inputs of each layer are taken from their largest values over a set of observations.)
+void mlp_quantize(Mlp *mlp, const gfloat *observations, guint count);
+
+// Gets the outputs of the last layer for one observation.
+void mlp_forward(const Mlp *mlp, const gfloat *observation, gfloat *outputs);
+
+// Gets the move decided for one observation (-1 upwards or leftwards, 0 still, 1 downwards or rightwards).
+gint mlp_decide(const Mlp *mlp, const gfloat *observation);
+
+// Gets the moves decided for a batch of observations (MLP_OBSERVATIONS floats each).
+// (The same moves as 'mlp_decide', four observations at a time: each row of weights
+// is loaded once for the four.)
+void mlp_decide_batch(const Mlp *mlp, const gfloat *observations, guint count, gint *directions);
+
+#endif
@@ -1,5 +1,7 @@
 #include <gtk/gtk.h>
 
+#include "steps.h"
+
 // Signal handler for the "clicked" signal of the start button.
 void on_start(GtkButton *button, gpointer user_data)
 {
@@ -9,17 +11,8 @@ void on_start(GtkButton *button, gpointer user_data)
 // Signal handler for the "draw" signal of the drawing area.
 gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
 {
-    // Gets the rectangle.
-    GdkRectangle *r = user_data;
-
-    // Sets the background to white.
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_paint(cr);
-
-    // Draws the rectangle in red.
-    cairo_set_source_rgb(cr, 1, 0, 0);
-    cairo_rectangle(cr, r->x, r->y, r->width, r->height);
-    cairo_fill(cr);
+    // Draws the rectangle in red, without paddles.
+    steps_draw(cr, NULL, 0, user_data);
 
     // Propagates the signal.
     return FALSE;
@@ -48,16 +41,11 @@ int main (int argc, char *argv[])
     // Initializes GTK.
     gtk_init(NULL, NULL);
 
-    // Loads the UI description and builds the UI.
+    // Loads the UI description (compiled into the binary) and builds the UI.
     // (Exits if an error occurs.)
-    GtkBuilder* builder = gtk_builder_new();
-    GError* error = NULL;
-    if (gtk_builder_add_from_file(builder, "plain.glade", &error) == 0)
-    {
-        g_printerr("Error loading file: %s\n", error->message);
-        g_clear_error(&error);
+    GtkBuilder* builder = steps_load("/org/gtk/duel/plain.glade");
+    if (builder == NULL)
         return 1;
-    }
 
     // Gets the widgets.
     GtkWindow* window = GTK_WINDOW(gtk_builder_get_object(builder, "org.gtk.duel"));
@@ -77,4 +65,4 @@ int main (int argc, char *argv[])
 
     // Exits.
     return 0;
-}
\ No newline at end of file
+}
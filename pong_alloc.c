@@ -0,0 +1,172 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "bricks.h"
+#include "config.h"
+#include "history.h"
+#include "mlp.h"
+#include "score.h"
+#include "script.h"
+#include "sim.h"
+
+#define WARMUP_TICKS 200000         // Ticks played before counting (the first matches end meanwhile)
+#define CHECK_TICKS 1000000         // Ticks counted
+#define HISTORY_TICKS 2500          // States of the history (10 seconds of ticks, as duel)
+
+// Number of heap allocations since the start.
+// (Counted by the wrappers of the allocator of the C library below: GLib allocates through it.)
+static gint allocations;
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+    g_atomic_int_inc(&allocations);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    g_atomic_int_inc(&allocations);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    g_atomic_int_inc(&allocations);
+    return __libc_realloc(pointer, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    g_atomic_int_inc(&allocations);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    g_atomic_int_inc(&allocations);
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer != NULL ? 0 : ENOMEM;
+}
+
+// Match whose steady-state tick is checked.
+typedef struct Case
+{
+    const gchar *name;              // Name
+    Config config;                  // Tunables of the match
+} Case;
+
+// Plays the ticks of a match as duel does, without GTK: the tick with the keys, the history
+// of the rewind, then the handling of the events and the update of the score texts.
+// (Returns the number of allocations of the ticks played after the warmup.)
+static guint play(const Config *config, guint *goals, guint *updates)
+{
+    Sim sim;
+    History history;
+    sim_init(&sim, config);
+    history_init(&history, HISTORY_TICKS, sim.paddle_count);
+    sim_set_state(&sim, PLAY);
+
+    const gchar *shown[MAX_PADDLES] = { NULL };
+    guint counted = 0;
+    for (guint tick = 0; tick < WARMUP_TICKS + CHECK_TICKS; tick++)
+    {
+        if (tick == WARMUP_TICKS)
+            counted = g_atomic_int_get(&allocations);
+
+        // (The keys move the paddles of the keys up and down.)
+        guint keys = tick / 300 % 2 == 0 ? 0x55555555 : 0xaaaaaaaa;
+        sim_step(&sim, keys);
+        if (sim.state == PLAY)
+            history_push(&history, &sim);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (tick >= WARMUP_TICKS)
+                *goals += event.type == EVENT_GOAL;
+            if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+
+        // (A label is only set when its text changes.)
+        for (guint i = 0; i < sim.paddle_count; i++)
+        {
+            const gchar *text = score_text(sim.paddles[i].score);
+            if (text != shown[i] && tick >= WARMUP_TICKS)
+                (*updates)++;
+            shown[i] = text;
+        }
+    }
+    counted = g_atomic_int_get(&allocations) - counted;
+
+    history_free(&history);
+    sim_free(&sim);
+    return counted;
+}
+
+// Checks that the steady-state tick and score update of matches never allocate.
+// (Matches with the keys, the bots of each controller, several paddles and the bricks.
+// Exits with 1 if any tick allocates.)
+// Usage: pong_alloc
+int main(void)
+{
+    score_init();
+
+    static const guint widths[] = { MLP_OBSERVATIONS, 16, MLP_ACTIONS };
+    Mlp *model = mlp_new(widths, G_N_ELEMENTS(widths) - 1);
+    Script *script = script_assemble("in r1, disc_along\n in r2, paddle_along\n sub r1, r1, r2\n move r1\n",
+                                     "chase", NULL);
+
+    static Case cases[] =
+            {
+                    { "keys" },
+                    { "follow-noisy" },
+                    { "predict-bricks" },
+                    { "neural-script" },
+                    { "crowd" },
+            };
+    for (guint i = 0; i < G_N_ELEMENTS(cases); i++)
+        config_defaults(&cases[i].config);
+
+    cases[1].config.p1_control = CONTROL_FOLLOW;
+    cases[1].config.p2_control = CONTROL_NOISY;
+
+    cases[2].config.p1_control = CONTROL_PREDICT;
+    cases[2].config.p2_control = CONTROL_PREDICT;
+    cases[2].config.brick_columns = 20;
+    cases[2].config.brick_rows = 10;
+
+    cases[3].config.p1_control = CONTROL_NEURAL;
+    cases[3].config.p2_control = CONTROL_SCRIPT;
+    cases[3].config.model = model;
+    cases[3].config.script = script;
+
+    cases[4].config.p1_control = CONTROL_KEYS;
+    cases[4].config.p2_control = CONTROL_PREDICT;
+    cases[4].config.others_control = CONTROL_NOISY;
+    cases[4].config.lineup.count = 16;
+    for (guint j = 0; j < cases[4].config.lineup.count; j++)
+        cases[4].config.lineup.sides[j] = j % 4;
+
+    gboolean clean = TRUE;
+    for (guint i = 0; i < G_N_ELEMENTS(cases); i++)
+    {
+        guint goals = 0;
+        guint updates = 0;
+        guint counted = play(&cases[i].config, &goals, &updates);
+        printf("%-16s %u allocations over %d ticks (%u goals, %u score updates)\n",
+               cases[i].name, counted, CHECK_TICKS, goals, updates);
+        clean &= counted == 0;
+    }
+
+    mlp_free(model);
+    script_free(script);
+    return clean ? 0 : 1;
+}
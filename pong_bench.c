@@ -0,0 +1,648 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+
+#include "bots.h"
+#include "mlp.h"
+#include "render.h"
+#include "script.h"
+#include "sim.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "ticker.h"
+#include "tiles.h"
+
+#ifndef PONG_VERSION
+#define PONG_VERSION "unknown"
+#endif
+
+#define WARMUP_NS 100000000         // Warmup time of a benchmark in nanoseconds
+#define BATCH_NS 1000000            // Smallest duration of a batch in nanoseconds
+#define BATCHES 200                 // Number of timed batches of a benchmark
+#define RECTS 256                   // Number of rectangles of the collision benchmark
+#define IDLE_MS 1000                // Duration of the measurement of the idle wakeups in milliseconds
+#define CROWDS 6                    // Number of matches of the paddle-count benchmarks (2 to 64 paddles)
+#define LEVELS 3                    // Number of matches of the brick-count benchmarks (100 to 10000 bricks)
+#define NN_HIDDEN 32                // Width of the hidden layers of the network benchmarks (as pong_mlp)
+#define NN_SAMPLES 256              // Number of observations of the network benchmarks
+#define SCRIPT_LOOP 1000            // Number of turns of the loop of the script benchmark (2 instructions each)
+#define SCRIPT_PADDLES 64           // Number of paddles of the scripted match benchmark
+#define TILES 64                    // Number of matches of the tile benchmarks (drawn in the 800x500 image)
+
+// Data used by the benchmarks.
+typedef struct Context
+{
+    Sim sim;                        // Simulation
+    Sim crowds[CROWDS];             // Simulations with 2, 4, ... 64 paddles
+    Sim levels[LEVELS];             // Simulations with 100, 1000 and 10000 static bricks
+    Rect rects[RECTS];              // Random rectangles
+    Mlp *network;                   // Random network with float weights
+    Mlp *quantized;                 // Same network with int8 weights
+    gfloat observations[NN_SAMPLES * MLP_OBSERVATIONS]; // Random observations
+    Script *chase;                  // Script that chases the disc
+    Script *loop;                   // Script that turns SCRIPT_LOOP times in a loop
+    gint script_inputs[SCRIPT_INPUTS]; // Inputs of the scripts
+    Sim scripted;                   // Simulation with SCRIPT_PADDLES scripted paddles
+    Tiles tiles;                    // TILES matches laid out in the image
+    Rect parts[TILES];              // Parts of the image changed by a tick of the tiles
+    guint part_count;               // Number of changed parts
+    cairo_surface_t *surface;       // Image of the arena
+    cairo_t *cr;                    // Cairo context of the image
+    guint sink;                     // Results (so that the compiler keeps the work)
+} Context;
+
+// Structure of a benchmark.
+typedef struct Bench
+{
+    const gchar *name;              // Name
+    void (*run)(Context *context, guint64 ops); // Runs a number of operations
+} Bench;
+
+// Structure of the result of a benchmark.
+typedef struct Result
+{
+    guint64 ops;                    // Number of operations of a batch
+    Stats ps_per_op;                // Time per operation of each batch in picoseconds
+    gdouble mean_ns;                // Mean time per operation in nanoseconds
+} Result;
+
+// Structure of the result of the idle measurement.
+typedef struct Idle
+{
+    gdouble wakeups_per_sec;        // Ticks run per second while the game is idle
+    gdouble resume_ms;              // Delay between an input and the next tick in milliseconds
+} Idle;
+
+// Game ticked by the idle measurement (with the policy of duel: no keys, no overlay).
+typedef struct IdleGame
+{
+    Sim sim;                        // Simulation
+    guint keys;                     // Key-state mask
+    gint64 woken;                   // Time of the last input in microseconds (0 if resumed)
+    gint64 resume;                  // Delay between the last input and the next tick in microseconds
+} IdleGame;
+
+// Gets the monotonic time in nanoseconds.
+static gint64 now_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (gint64) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// Resumes the match after a goal (or starts a new one).
+static void resume(Sim *sim)
+{
+    Event event;
+    while (sim_poll_event(sim, &event))
+    {
+        if (event.type == EVENT_STATE && event.value != PLAY)
+            sim_set_state(sim, PLAY);
+    }
+}
+
+// Ticks of the simulation with still paddles (the disc moves and bounces).
+static void bench_disc_step(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+    {
+        sim_step(&context->sim, 0);
+        resume(&context->sim);
+    }
+    context->sink += context->sim.disc.rect.x;
+}
+
+// Moves of a paddle controlled by the keys.
+static void bench_paddle_move(Context *context, guint64 ops)
+{
+    Paddle *paddle = &context->sim.paddles[1];
+    paddle->control = CONTROL_KEYS;
+
+    for (guint64 i = 0; i < ops; i++)
+        sim_control_paddle(&context->sim, paddle, (i & 256) ? KEY_P2_UP : KEY_P2_DOWN);
+    context->sink += paddle->rect.y;
+}
+
+// Intersection tests of rectangles.
+static void bench_collision(Context *context, guint64 ops)
+{
+    guint hits = 0;
+    for (guint64 i = 0; i < ops; i++)
+        hits += rect_intersect(&context->rects[i % RECTS], &context->rects[(i * 7 + 1) % RECTS]);
+    context->sink += hits;
+}
+
+// Decisions of a paddle that follows the disc.
+static void bench_ai_decision(Context *context, guint64 ops)
+{
+    Paddle *paddle = &context->sim.paddles[0];
+    paddle->control = CONTROL_FOLLOW;
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        context->sim.disc.rect.y = i % 400;
+        sim_control_paddle(&context->sim, paddle, 0);
+    }
+    context->sink += paddle->rect.y;
+}
+
+// Decisions of a paddle that predicts where the disc will reach its wall.
+// (The costly controller, which duel runs on the worker thread of the bots.)
+static void bench_ai_predict(Context *context, guint64 ops)
+{
+    Sim sim = context->sim;
+    sim.state = PLAY;
+    sim.disc.step.x = -ABS(sim.disc.step.x);
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        sim.disc.position.x = (gint) (200 + i % 500) * FIXED_ONE;
+        context->sink += sim_decide(&sim, &sim.paddles[0]);
+    }
+}
+
+// Round trips of a state through a mailbox of the bots (on a single thread).
+// (The cost added to the game tick: a copy of the simulation and two atomic exchanges.)
+static void bench_bot_mailbox(Context *context, guint64 ops)
+{
+    Mailbox mailbox;
+    mailbox_init(&mailbox, sizeof(BotRequest));
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        BotRequest *request = mailbox_slot(&mailbox);
+        request->sim = context->sim;
+        request->time = i;
+        mailbox_post(&mailbox);
+
+        const BotRequest *taken = mailbox_take(&mailbox);
+        context->sink += taken->time;
+    }
+
+    mailbox_free(&mailbox);
+}
+
+// Decisions of a neural paddle with float weights.
+static void bench_nn_float(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+        context->sink += mlp_decide(context->network, context->observations + i % NN_SAMPLES * MLP_OBSERVATIONS);
+}
+
+// Decisions of a neural paddle with int8 weights.
+static void bench_nn_int8(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+        context->sink += mlp_decide(context->quantized, context->observations + i % NN_SAMPLES * MLP_OBSERVATIONS);
+}
+
+// Decisions of neural paddles with int8 weights, by batches of NN_SAMPLES (time per decision).
+static void bench_nn_int8_batch(Context *context, guint64 ops)
+{
+    gint directions[NN_SAMPLES];
+
+    for (guint64 i = 0; i < ops; i += NN_SAMPLES)
+    {
+        guint count = MIN(ops - i, NN_SAMPLES);
+        mlp_decide_batch(context->quantized, context->observations, count, directions);
+        context->sink += directions[count - 1];
+    }
+}
+
+// Decisions of a scripted paddle that chases the disc.
+static void bench_script_chase(Context *context, guint64 ops)
+{
+    gint direction = 0;
+    for (guint64 i = 0; i < ops; i++)
+    {
+        context->script_inputs[INPUT_DISC_ALONG] = i % 500;
+        script_run(context->chase, context->script_inputs, 1000, &direction);
+        context->sink += direction;
+    }
+}
+
+// Instructions of a script that loops (time per instruction).
+static void bench_script_loop(Context *context, guint64 ops)
+{
+    gint direction = 0;
+    for (guint64 i = 0; i < ops; i += 2 * SCRIPT_LOOP)
+    {
+        script_run(context->loop, context->script_inputs, 4 * SCRIPT_LOOP, &direction);
+        context->sink += direction;
+    }
+}
+
+// Ticks of a match with SCRIPT_PADDLES paddles that run the chasing script.
+static void bench_scripts_64(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+    {
+        sim_step(&context->scripted, 0);
+        resume(&context->scripted);
+    }
+    context->sink += context->scripted.disc.rect.x;
+}
+
+// Full draws of the arena (as done by on_draw) into an image.
+static void bench_render(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+    {
+        context->sim.disc.rect.x = i % 790;
+        render_sim(context->cr, &context->sim);
+    }
+    cairo_surface_flush(context->surface);
+    context->sink += cairo_image_surface_get_data(context->surface)[0];
+}
+
+// Full draws of the tiles (as done by on_draw after a resize) into an image.
+static void bench_tiles_64(Context *context, guint64 ops)
+{
+    Rect whole = { 0, 0, context->tiles.width, context->tiles.height };
+    for (guint64 i = 0; i < ops; i++)
+        render_tiles(context->cr, &context->tiles, &whole, 1);
+    cairo_surface_flush(context->surface);
+    context->sink += cairo_image_surface_get_data(context->surface)[0];
+}
+
+// Adds a changed part of the tiles.
+static void add_part(const Rect *part, gpointer user_data)
+{
+    Context *context = user_data;
+    context->parts[context->part_count++] = *part;
+}
+
+// Ticks of the tiles followed by draws of their changed parts (as done by on_tick and on_draw).
+static void bench_tiles_64_tick(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+    {
+        context->part_count = 0;
+        tiles_step(&context->tiles, add_part, context);
+        render_tiles(context->cr, &context->tiles, context->parts, context->part_count);
+    }
+    cairo_surface_flush(context->surface);
+    context->sink += cairo_image_surface_get_data(context->surface)[0];
+}
+
+// Restores of a snapshot (as done by a search over the states of a match).
+static void bench_snapshot_restore(Context *context, guint64 ops)
+{
+    Snapshot snapshot;
+    snapshot_save(&context->sim, &snapshot);
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        snapshot_restore(&context->sim, &snapshot);
+        context->sink += context->sim.disc.rect.x;
+    }
+}
+
+// Hashes of the state (as done on every tick by the determinism check).
+static void bench_state_hash(Context *context, guint64 ops)
+{
+    for (guint64 i = 0; i < ops; i++)
+    {
+        context->sim.tick = i;
+        context->sink += sim_hash(&context->sim);
+    }
+}
+
+// Ticks of a match with a number of paddles on the four sides (a power of two from 2 to 64).
+// (The time per tick grows linearly with the number of paddles.)
+static void run_crowd(Context *context, guint paddles, guint64 ops)
+{
+    Sim *sim = &context->crowds[g_bit_nth_lsf(paddles, -1) - 1];
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        sim_step(sim, 0);
+        resume(sim);
+    }
+    context->sink += sim->disc.rect.x;
+}
+
+#define BENCH_PADDLES(count) \
+    static void bench_paddles_##count(Context *context, guint64 ops) { run_crowd(context, count, ops); }
+
+BENCH_PADDLES(2)
+BENCH_PADDLES(4)
+BENCH_PADDLES(8)
+BENCH_PADDLES(16)
+BENCH_PADDLES(32)
+BENCH_PADDLES(64)
+
+// Ticks of a match with static bricks (10 columns by 10 rows, then 10 times more each time).
+// (The time per tick stays flat: a swept query of the bricks only visits a branch of their tree.)
+static void run_level(Context *context, guint level, guint64 ops)
+{
+    Sim *sim = &context->levels[level];
+
+    for (guint64 i = 0; i < ops; i++)
+    {
+        sim_step(sim, 0);
+        resume(sim);
+    }
+    context->sink += sim->disc.rect.x;
+}
+
+static void bench_bricks_100(Context *context, guint64 ops) { run_level(context, 0, ops); }
+static void bench_bricks_1000(Context *context, guint64 ops) { run_level(context, 1, ops); }
+static void bench_bricks_10000(Context *context, guint64 ops) { run_level(context, 2, ops); }
+
+static const Bench benches[] =
+        {
+                { "disc_step", bench_disc_step },
+                { "paddle_move", bench_paddle_move },
+                { "collision", bench_collision },
+                { "ai_decision", bench_ai_decision },
+                { "ai_predict", bench_ai_predict },
+                { "bot_mailbox", bench_bot_mailbox },
+                { "nn_float", bench_nn_float },
+                { "nn_int8", bench_nn_int8 },
+                { "nn_int8_batch", bench_nn_int8_batch },
+                { "script_chase", bench_script_chase },
+                { "script_loop", bench_script_loop },
+                { "scripts_64", bench_scripts_64 },
+                { "render", bench_render },
+                { "tiles_64", bench_tiles_64 },
+                { "tiles_64_tick", bench_tiles_64_tick },
+                { "snapshot_restore", bench_snapshot_restore },
+                { "state_hash", bench_state_hash },
+                { "paddles_2", bench_paddles_2 },
+                { "paddles_4", bench_paddles_4 },
+                { "paddles_8", bench_paddles_8 },
+                { "paddles_16", bench_paddles_16 },
+                { "paddles_32", bench_paddles_32 },
+                { "paddles_64", bench_paddles_64 },
+                { "bricks_100", bench_bricks_100 },
+                { "bricks_1000", bench_bricks_1000 },
+                { "bricks_10000", bench_bricks_10000 },
+        };
+
+// Runs a benchmark: warmup, calibration of the batch size, then timed batches.
+static void run_bench(const Bench *bench, Context *context, Result *result)
+{
+    // Warms up the caches and the branch predictors, and finds a batch size
+    // that takes at least BATCH_NS.
+    guint64 ops = 1;
+    gint64 warmup_end = now_ns() + WARMUP_NS;
+    while (TRUE)
+    {
+        gint64 start = now_ns();
+        bench->run(context, ops);
+        gint64 elapsed = now_ns() - start;
+
+        if (elapsed < BATCH_NS)
+            ops *= 2;
+        else if (start >= warmup_end)
+            break;
+    }
+
+    result->ops = ops;
+    gint64 total = 0;
+    for (guint i = 0; i < BATCHES; i++)
+    {
+        gint64 start = now_ns();
+        bench->run(context, ops);
+        gint64 elapsed = now_ns() - start;
+
+        stats_add(&result->ps_per_op, elapsed * 1000 / (gint64) ops);
+        total += elapsed;
+    }
+    result->mean_ns = (gdouble) total / ((gdouble) ops * BATCHES);
+}
+
+// Runs one tick of the idle measurement.
+static gboolean on_idle_tick(gpointer user_data)
+{
+    IdleGame *game = user_data;
+
+    if (game->woken != 0)
+    {
+        game->resume = g_get_monotonic_time() - game->woken;
+        game->woken = 0;
+    }
+
+    gboolean moving = sim_step(&game->sim, game->keys);
+    game->keys = 0;
+    return moving;
+}
+
+// Ends a phase of the idle measurement.
+static gboolean on_idle_end(gpointer user_data)
+{
+    *(gboolean*) user_data = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+// Runs the main loop for a duration.
+static void run_loop(guint ms)
+{
+    gboolean done = FALSE;
+    g_timeout_add(ms, on_idle_end, &done);
+    while (!done)
+        g_main_context_iteration(NULL, TRUE);
+}
+
+// Counts the ticks run while the game is stopped and no key is held,
+// then the delay for a key press to resume the tick.
+static void run_idle(const Config *config, Idle *idle)
+{
+    static IdleGame game;
+    Ticker ticker;
+
+    sim_init(&game.sim, config);
+    ticker_start(&ticker, config->tick_period, on_idle_tick, &game);
+
+    // Lets the tick find that the game is idle.
+    run_loop(10 * config->tick_period);
+
+    guint64 wakeups = ticker.wakeups;
+    run_loop(IDLE_MS);
+    idle->wakeups_per_sec = (ticker.wakeups - wakeups) * 1000.0 / IDLE_MS;
+
+    // Presses a key.
+    game.keys = KEY_P1_DOWN;
+    game.woken = g_get_monotonic_time();
+    ticker_wake(&ticker);
+    run_loop(10 * config->tick_period);
+    idle->resume_ms = game.resume / 1000.0;
+}
+
+// Pins the process on a CPU, so that the results do not depend on migrations.
+// (Returns FALSE if it is not possible.)
+static gboolean pin_cpu(gint cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// Writes the results in JSON.
+static void write_json(FILE *file, gint cpu, const Result *results, const Idle *idle)
+{
+    fprintf(file, "{\n  \"version\": \"%s\",\n  \"compiler\": \"%s\",\n"
+            "  \"cpus\": %u,\n  \"pinned_cpu\": %d,\n  \"benchmarks\": [\n",
+            PONG_VERSION, __VERSION__, g_get_num_processors(), cpu);
+
+    for (guint i = 0; i < G_N_ELEMENTS(benches); i++)
+    {
+        const Result *result = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ops_per_batch\": %" G_GUINT64_FORMAT
+                ", \"batches\": %d, \"mean_ns\": %.3f, \"ops_per_sec\": %.0f,"
+                " \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f}%s\n",
+                benches[i].name, result->ops, BATCHES, result->mean_ns, 1e9 / result->mean_ns,
+                stats_percentile(&result->ps_per_op, 50) / 1000.0,
+                stats_percentile(&result->ps_per_op, 90) / 1000.0,
+                stats_percentile(&result->ps_per_op, 99) / 1000.0,
+                i + 1 < G_N_ELEMENTS(benches) ? "," : "");
+    }
+
+    fprintf(file, "  ],\n  \"idle\": {\"wakeups_per_sec\": %.1f, \"resume_ms\": %.3f}\n}\n",
+            idle->wakeups_per_sec, idle->resume_ms);
+}
+
+// Runs the benchmarks and writes the results in JSON to a file (or to the standard output).
+// Usage: pong_bench [output.json] [cpu]
+int main(int argc, char *argv[])
+{
+    const gchar *path = argc > 1 ? argv[1] : NULL;
+    gint cpu = argc > 2 ? atoi(argv[2]) : 0;
+
+    if (!pin_cpu(cpu))
+    {
+        g_printerr("Warning: cannot pin the process on CPU %d\n", cpu);
+        cpu = -1;
+    }
+
+    static Context context;
+    Config config;
+    config_defaults(&config);
+    sim_init(&context.sim, &config);
+    sim_set_state(&context.sim, PLAY);
+    // The paddles of the crowds go round the sides: left, right, top, bottom, left...
+    // (The first two play as in pong_sim, the others follow the disc.)
+    for (guint i = 0; i < CROWDS; i++)
+    {
+        Config crowd = config;
+        crowd.p1_control = CONTROL_FOLLOW;
+        crowd.p2_control = CONTROL_NOISY;
+        crowd.lineup.count = 2u << i;
+        for (guint j = 0; j < crowd.lineup.count; j++)
+            crowd.lineup.sides[j] = j % 4;
+
+        sim_init(&context.crowds[i], &crowd);
+        sim_set_state(&context.crowds[i], PLAY);
+    }
+
+    // The disc of the levels bounces between the left paddle and the bricks.
+    static const gint level_sizes[LEVELS][2] = { { 10, 10 }, { 25, 40 }, { 100, 100 } };
+    for (guint i = 0; i < LEVELS; i++)
+    {
+        Config level = config;
+        level.p1_control = CONTROL_FOLLOW;
+        level.p2_control = CONTROL_FOLLOW;
+        level.brick_columns = level_sizes[i][0];
+        level.brick_rows = level_sizes[i][1];
+        level.brick_gap = 1;
+        level.static_bricks = TRUE;
+
+        sim_init(&context.levels[i], &level);
+        sim_set_state(&context.levels[i], PLAY);
+    }
+
+    context.surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, 800, 500);
+    context.cr = cairo_create(context.surface);
+    tiles_init(&context.tiles, &config, TILES);
+    tiles_layout(&context.tiles, 800, 500);
+
+    guint32 seed = 1;
+    for (guint i = 0; i < RECTS; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        context.rects[i] = (Rect) { (seed >> 8) % 800, (seed >> 16) % 500, 10, 100 };
+    }
+
+    // The networks have random weights and are quantized on the random observations.
+    static const guint nn_widths[] = { MLP_OBSERVATIONS, NN_HIDDEN, NN_HIDDEN, MLP_ACTIONS };
+    context.network = mlp_new(nn_widths, G_N_ELEMENTS(nn_widths) - 1);
+    context.quantized = mlp_new(nn_widths, G_N_ELEMENTS(nn_widths) - 1);
+    for (guint i = 0; i < context.network->layer_count; i++)
+    {
+        MlpLayer *layer = &context.network->layers[i];
+        for (guint k = 0; k < layer->outputs * layer->stride; k++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            layer->weights[k] = k % layer->stride < layer->inputs ? (gint) (seed >> 16) / 65536.0f - 0.5f : 0;
+        }
+        memcpy(context.quantized->layers[i].weights, layer->weights, layer->outputs * layer->stride * sizeof(gfloat));
+    }
+    for (guint i = 0; i < G_N_ELEMENTS(context.observations); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        context.observations[i] = (gint) (seed >> 16) / 32768.0f - 1;
+    }
+    mlp_quantize(context.quantized, context.observations, NN_SAMPLES);
+
+    // The scripts are assembled from their sources (as bots/chase.bot for the chasing one).
+    static const gchar chase_source[] =
+            "in r1, disc_along\n in r2, paddle_along\n in r3, paddle_step\n sub r1, r1, r2\n"
+            "abs r4, r1\n jle r4, r3, hold\n move r1\n hold: stay\n";
+    static const gchar loop_source[] = "loop: add r1, r1, 1\n jlt r1, " G_STRINGIFY(SCRIPT_LOOP) ", loop\n";
+    context.chase = script_assemble(chase_source, "chase", NULL);
+    context.loop = script_assemble(loop_source, "loop", NULL);
+    context.script_inputs[INPUT_PADDLE_ALONG] = 250;
+    context.script_inputs[INPUT_PADDLE_STEP] = 5;
+
+    Config scripted = config;
+    scripted.p1_control = CONTROL_SCRIPT;
+    scripted.p2_control = CONTROL_SCRIPT;
+    scripted.others_control = CONTROL_SCRIPT;
+    scripted.script = context.chase;
+    scripted.lineup.count = SCRIPT_PADDLES;
+    for (guint j = 0; j < scripted.lineup.count; j++)
+        scripted.lineup.sides[j] = j % 4;
+    sim_init(&context.scripted, &scripted);
+    sim_set_state(&context.scripted, PLAY);
+
+    static Result results[G_N_ELEMENTS(benches)];
+    for (guint i = 0; i < G_N_ELEMENTS(benches); i++)
+    {
+        run_bench(&benches[i], &context, &results[i]);
+        g_printerr("%-16s %10.2f ns/op  %14.0f ops/s  p50 %.2f  p99 %.2f ns\n",
+                   benches[i].name, results[i].mean_ns, 1e9 / results[i].mean_ns,
+                   stats_percentile(&results[i].ps_per_op, 50) / 1000.0,
+                   stats_percentile(&results[i].ps_per_op, 99) / 1000.0);
+    }
+
+    Idle idle;
+    run_idle(&config, &idle);
+    g_printerr("%-16s %10.1f wakeups/s  resume %.3f ms\n", "idle", idle.wakeups_per_sec, idle.resume_ms);
+
+    FILE *file = path != NULL ? fopen(path, "w") : stdout;
+    if (file == NULL)
+    {
+        g_printerr("Error opening file: %s\n", path);
+        return 1;
+    }
+    write_json(file, cpu, results, &idle);
+    if (file != stdout)
+        fclose(file);
+
+    for (guint i = 0; i < LEVELS; i++)
+        sim_free(&context.levels[i]);
+    mlp_free(context.network);
+    mlp_free(context.quantized);
+    sim_free(&context.scripted);
+    tiles_free(&context.tiles);
+    script_free(context.chase);
+    script_free(context.loop);
+    cairo_destroy(context.cr);
+    cairo_surface_destroy(context.surface);
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <glib.h>
+
+#include "config.h"
+#include "replay.h"
+#include "sim.h"
+#include "snapshot.h"
+
+#define HASHES_HEADER "pong-hashes 1\n" // First line of a file of hashes
+
+// Match run by a thread.
+typedef struct Run
+{
+    const Config *config;           // Tunables
+    const Replay *replays;          // Replays played by player 2
+    guint replay_count;             // Number of replays (0 if none)
+    guint64 *hashes;                // Hash of the state after each tick
+} Run;
+
+// Plays a match and hashes the state after each tick.
+// (Same inputs as pong_sim: player 2 plays the replays if any, the match is resumed after each goal.)
+static gpointer run_match(gpointer data)
+{
+    Run *run = data;
+    guint current = 0;
+    guint position = 0;
+
+    Sim sim;
+    sim_init(&sim, run->config);
+    if (run->replay_count != 0)
+        sim.paddles[1].control = CONTROL_KEYS;
+    sim_set_state(&sim, PLAY);
+
+    for (gint64 tick = 0; tick < run->config->ticks; tick++)
+    {
+        guint keys = 0;
+        if (run->replay_count != 0)
+        {
+            keys = run->replays[current].keys[position++];
+            if (position == run->replays[current].length)
+            {
+                position = 0;
+                current = (current + 1) % run->replay_count;
+            }
+        }
+
+        sim_step(&sim, keys);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+
+        run->hashes[tick] = sim_hash(&sim);
+    }
+
+    sim_free(&sim);
+    return NULL;
+}
+
+// Gets the first tick where two runs diverge (the number of ticks if they do not).
+static gint64 first_divergence(const guint64 *a, const guint64 *b, gint64 ticks)
+{
+    for (gint64 tick = 0; tick < ticks; tick++)
+    {
+        if (a[tick] != b[tick])
+            return tick;
+    }
+    return ticks;
+}
+
+// Writes the hashes of a run to a file (little-endian).
+// (Returns FALSE if the file cannot be written.)
+static gboolean write_hashes(const gchar *path, const guint64 *hashes, gint64 ticks)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return FALSE;
+
+    fputs(HASHES_HEADER, file);
+    for (gint64 tick = 0; tick < ticks; tick++)
+    {
+        guint64 hash = GUINT64_TO_LE(hashes[tick]);
+        fwrite(&hash, sizeof(hash), 1, file);
+    }
+
+    return fclose(file) == 0;
+}
+
+// Reads the hashes of a run from a file.
+// (Returns the number of ticks read, or -1 if the file cannot be read or is not a file of hashes.)
+static gint64 read_hashes(const gchar *path, guint64 *hashes, gint64 ticks)
+{
+    gchar header[32];
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+
+    if (fgets(header, sizeof(header), file) == NULL || g_strcmp0(header, HASHES_HEADER) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    gint64 count = 0;
+    guint64 hash;
+    while (count < ticks && fread(&hash, sizeof(hash), 1, file) == 1)
+        hashes[count++] = GUINT64_FROM_LE(hash);
+
+    fclose(file);
+    return count;
+}
+
+// Reports the comparison of a run with the reference run.
+// (Returns FALSE if they diverge.)
+static gboolean report(const gchar *name, const guint64 *reference, const guint64 *hashes, gint64 ticks)
+{
+    gint64 tick = first_divergence(reference, hashes, ticks);
+    if (tick == ticks)
+    {
+        printf("%-24s identical over %" G_GINT64_FORMAT " ticks\n", name, ticks);
+        return TRUE;
+    }
+
+    printf("%-24s diverges at tick %" G_GINT64_FORMAT "  (%016" G_GINT64_MODIFIER "x != %016" G_GINT64_MODIFIER "x)\n",
+           name, tick, hashes[tick], reference[tick]);
+    return FALSE;
+}
+
+// Runs the same match on several threads and checks that the states are bit-exact on every tick.
+// (The hashes can be written to a file and compared with those of other builds.)
+// Usage: pong_determinism [--threads=N] [--output=FILE] [--compare=FILE...] [--OPTION=VALUE...] [replays...]
+int main(int argc, char *argv[])
+{
+    gint threads = MAX(g_get_num_processors(), 2);
+    gchar *output = NULL;
+    gchar **compare = NULL;
+
+    Config config;
+    config_defaults(&config);
+    config.ticks = 1000000;
+    config.p1_control = CONTROL_FOLLOW;
+    config.p2_control = CONTROL_NOISY;
+
+    GOptionEntry entries[] =
+            {
+                    { "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads", "N" },
+                    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "File of the hashes of the run", "FILE" },
+                    { "compare", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &compare, "File of hashes of another build", "FILE" },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    if (!config_parse(&config, entries, FALSE, &argc, &argv, &error) || threads < 1)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "no thread");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Loads the replays.
+    guint replay_count = argc - 1;
+    Replay replays[MAX(replay_count, 1)];
+    for (guint i = 0; i < replay_count; i++)
+    {
+        if (!replay_load(&replays[i], argv[i + 1]))
+        {
+            g_printerr("Error loading replay: %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
+
+    // Runs the match on all the threads at once.
+    gint64 ticks = config.ticks;
+    Run runs[threads];
+    GThread *workers[threads];
+    for (gint i = 0; i < threads; i++)
+    {
+        runs[i] = (Run) { &config, replays, replay_count, g_new(guint64, MAX(ticks, 1)) };
+        workers[i] = g_thread_new("match", run_match, &runs[i]);
+    }
+    for (gint i = 0; i < threads; i++)
+        g_thread_join(workers[i]);
+
+    // Compares the threads with the first one.
+    gboolean identical = TRUE;
+    for (gint i = 1; i < threads; i++)
+    {
+        gchar name[32];
+        g_snprintf(name, sizeof(name), "thread %d", i);
+        identical &= report(name, runs[0].hashes, runs[i].hashes, ticks);
+    }
+
+    // Compares the other builds with this one.
+    guint64 *hashes = g_new(guint64, MAX(ticks, 1));
+    for (gchar **path = compare; path != NULL && *path != NULL; path++)
+    {
+        gint64 count = read_hashes(*path, hashes, ticks);
+        if (count < 0)
+        {
+            g_printerr("Error reading hashes: %s\n", *path);
+            identical = FALSE;
+            continue;
+        }
+
+        identical &= report(*path, runs[0].hashes, hashes, count);
+        if (count < ticks)
+            printf("%-24s only has %" G_GINT64_FORMAT " ticks\n", *path, count);
+    }
+
+    if (output != NULL && !write_hashes(output, runs[0].hashes, ticks))
+    {
+        g_printerr("Error writing file: %s\n", output);
+        identical = FALSE;
+    }
+
+    g_free(hashes);
+    for (gint i = 0; i < threads; i++)
+        g_free(runs[i].hashes);
+    for (guint i = 0; i < replay_count; i++)
+        replay_free(&replays[i]);
+    g_strfreev(compare);
+    g_free(output);
+    g_free(config.file);
+    mlp_free(config.model);
+    script_free(config.script);
+
+    return identical ? 0 : 1;
+}
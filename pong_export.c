@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <string.h>
+#include <cairo.h>
+#include <glib.h>
+
+#include "config.h"
+#include "render.h"
+#include "replay.h"
+#include "sim.h"
+#include "snapshot.h"
+
+#define MAX_FPS 1000                // Largest number of frames per second
+#define SLOTS_PER_THREAD 4          // Frames of the reorder queue per worker
+
+// Format of the exported frames.
+typedef enum Format
+{
+    FORMAT_Y4M,                     // Single YUV4MPEG2 stream (4:2:0, full range)
+    FORMAT_PNG,                     // Sequence of numbered PNG files
+} Format;
+
+// Frame of the reorder queue.
+// (Filled by the main thread, drawn and encoded by a worker, then written in order by the main thread.)
+typedef struct Slot
+{
+    Snapshot snapshot;              // State of the simulation shown by the frame
+    GByteArray *data;               // Encoded frame
+    gboolean drawn;                 // The state could be restored (the frame is empty otherwise)
+    gboolean done;                  // The frame is encoded (or the slot has never been used)
+} Slot;
+
+// Export shared by the main thread and the workers.
+typedef struct Export
+{
+    const Config *config;           // Tunables of the match
+    gint width;                     // Width of the frames (the widest arena of the match)
+    gint height;                    // Height of the frames (the highest arena of the match)
+    Format format;                  // Format of the frames
+    Slot *slots;                    // Reorder queue (frame 'f' in slot 'f % window')
+    guint window;                   // Number of slots
+    guint next;                     // Next frame to be drawn by a worker
+    guint queued;                   // Number of frames queued by the main thread
+    gboolean finished;              // No frame will be queued anymore
+    gboolean failed;                // A frame could not be drawn (set by the main thread)
+    GMutex mutex;                   // Lock of the queue
+    GCond changed;                  // Signaled when a frame is queued or encoded
+} Export;
+
+// Appends the bytes written by cairo to a buffer.
+static cairo_status_t append_png(void *closure, const unsigned char *data, unsigned int length)
+{
+    g_byte_array_append(closure, data, length);
+    return CAIRO_STATUS_SUCCESS;
+}
+
+// Converts an image to a Y4M frame: the planes Y, Cb and Cr of BT.601 in full range,
+// the chroma averaged over blocks of 2x2 pixels (and clipped: pure red and blue round up to 256).
+static void encode_y4m(cairo_surface_t *surface, GByteArray *data)
+{
+    gint width = cairo_image_surface_get_width(surface);
+    gint height = cairo_image_surface_get_height(surface);
+    gint stride = cairo_image_surface_get_stride(surface);
+    const guint8 *pixels = cairo_image_surface_get_data(surface);
+    gint chroma_width = (width + 1) / 2;
+    gint chroma_height = (height + 1) / 2;
+
+    g_byte_array_append(data, (const guint8*) "FRAME\n", 6);
+    guint header = data->len;
+    g_byte_array_set_size(data, header + width * height + 2 * chroma_width * chroma_height);
+    guint8 *luma = data->data + header;
+    guint8 *blue = luma + width * height;
+    guint8 *red = blue + chroma_width * chroma_height;
+
+    for (gint y = 0; y < height; y++)
+    {
+        const guint32 *row = (const guint32*) (pixels + y * stride);
+        for (gint x = 0; x < width; x++)
+        {
+            gint r = (row[x] >> 16) & 0xff, g = (row[x] >> 8) & 0xff, b = row[x] & 0xff;
+            luma[y * width + x] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+        }
+    }
+
+    // (The last row and column of an odd size are counted twice.)
+    for (gint y = 0; y < chroma_height; y++)
+    {
+        const guint32 *top = (const guint32*) (pixels + 2 * y * stride);
+        const guint32 *bottom = (const guint32*) (pixels + MIN(2 * y + 1, height - 1) * stride);
+        for (gint x = 0; x < chroma_width; x++)
+        {
+            gint left = 2 * x, right = MIN(2 * x + 1, width - 1);
+            guint32 quad[4] = { top[left], top[right], bottom[left], bottom[right] };
+            gint r = 0, g = 0, b = 0;
+            for (guint i = 0; i < 4; i++)
+            {
+                r += (quad[i] >> 16) & 0xff;
+                g += (quad[i] >> 8) & 0xff;
+                b += quad[i] & 0xff;
+            }
+            blue[y * chroma_width + x] = MIN((-43 * r - 85 * g + 128 * b + 4 * (128 * 256 + 128)) >> 10, 255);
+            red[y * chroma_width + x] = MIN((128 * r - 107 * g - 21 * b + 4 * (128 * 256 + 128)) >> 10, 255);
+        }
+    }
+}
+
+// Draws and encodes the queued frames in any order.
+static gpointer run_worker(gpointer data)
+{
+    Export *export = data;
+
+    // (The simulation of a worker only receives the states of the frames.)
+    Sim sim;
+    sim_init(&sim, export->config);
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, export->width, export->height);
+    cairo_t *cr = cairo_create(surface);
+
+    g_mutex_lock(&export->mutex);
+    while (TRUE)
+    {
+        while (export->next == export->queued && !export->finished)
+            g_cond_wait(&export->changed, &export->mutex);
+        if (export->next == export->queued)
+            break;
+        Slot *slot = &export->slots[export->next++ % export->window];
+        g_mutex_unlock(&export->mutex);
+
+        // (The slot is left to the worker until it is marked as done.)
+        g_byte_array_set_size(slot->data, 0);
+        slot->drawn = snapshot_restore(&sim, &slot->snapshot);
+        if (slot->drawn)
+        {
+            render_sim(cr, &sim);
+            cairo_surface_flush(surface);
+            if (export->format == FORMAT_Y4M)
+                encode_y4m(surface, slot->data);
+            else
+                cairo_surface_write_to_png_stream(surface, append_png, slot->data);
+        }
+
+        g_mutex_lock(&export->mutex);
+        slot->done = TRUE;
+        g_cond_broadcast(&export->changed);
+    }
+    g_mutex_unlock(&export->mutex);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    sim_free(&sim);
+    return NULL;
+}
+
+// Waits for a frame to be encoded and writes it.
+// (Returns FALSE if it cannot be drawn or written.)
+static gboolean write_frame(Export *export, guint frame, FILE *file, const gchar *output)
+{
+    Slot *slot = &export->slots[frame % export->window];
+    g_mutex_lock(&export->mutex);
+    while (!slot->done)
+        g_cond_wait(&export->changed, &export->mutex);
+    g_mutex_unlock(&export->mutex);
+
+    if (!slot->drawn)
+    {
+        g_printerr("Error drawing frame %u: its state cannot be restored\n", frame);
+        export->failed = TRUE;
+        return FALSE;
+    }
+
+    if (export->format == FORMAT_Y4M)
+        return fwrite(slot->data->data, 1, slot->data->len, file) == slot->data->len;
+
+    // (The frames are numbered from 0, before the suffix of the output: "match-000000.png".)
+    gchar *path = g_strdup_printf("%.*s-%06u.png", (gint) (strlen(output) - 4), output, frame);
+    gboolean written = g_file_set_contents(path, (const gchar*) slot->data->data, slot->data->len, NULL);
+    if (!written)
+        g_printerr("Error writing file: %s\n", path);
+    g_free(path);
+    return written;
+}
+
+// Checks that a replay can be played back, and gets the size of its largest arena.
+// (Returns FALSE if a snapshot does not fit the tunables of its header, or if a paddle is
+// moved by a network or a script that is not given.)
+static gboolean check_replay(const Replay *replay, gint *width, gint *height)
+{
+    Playback playback;
+    Sim sim;
+    playback_start(&playback, replay, &sim);
+
+    gboolean ok = TRUE;
+    *width = sim.width;
+    *height = sim.height;
+    while (ok && playback_step(&playback, &sim))
+    {
+        *width = MAX(*width, sim.width);
+        *height = MAX(*height, sim.height);
+        for (guint i = 0; i < sim.paddle_count; i++)
+        {
+            Control control = sim.paddles[i].control;
+            ok &= (control != CONTROL_NEURAL || playback.config.model != NULL)
+                  && (control != CONTROL_SCRIPT || playback.config.script != NULL);
+        }
+    }
+
+    sim_free(&sim);
+    return ok && !playback.broken;
+}
+
+// Replays a recorded match and exports its frames at a frame rate.
+// (The simulation is set up from the tunables of the replay, and plays its ticks and the
+// changes recorded between them, as in duel. The frames have the size of the largest arena
+// of the match, a smaller one being drawn in their top-left corner. The frames are drawn and
+// encoded by the workers; the main thread runs the simulation and writes the frames in order,
+// through a bounded queue. An output ending in ".png" gets a PNG file per frame, any other one
+// a Y4M stream; "-" is the standard output. The network and the script are not recorded: they
+// are given again if the match needs them.)
+// Usage: pong_export [--model=FILE] [--script=FILE] [--output=FILE] [--fps=N] [--threads=N] replay
+int main(int argc, char *argv[])
+{
+    gint fps = 60;
+    gint threads = g_get_num_processors();
+    gchar *output = NULL;
+    gchar *model = NULL;
+    gchar *script = NULL;
+
+    GOptionEntry entries[] =
+            {
+                    { "model", 0, 0, G_OPTION_ARG_FILENAME, &model, "Network file of the neural paddles of the match", "FILE" },
+                    { "script", 0, 0, G_OPTION_ARG_FILENAME, &script, "Bot file of the scripted paddles of the match", "FILE" },
+                    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Y4M file, or PNG files if it ends in .png (match.y4m by default)", "FILE" },
+                    { "fps", 0, 0, G_OPTION_ARG_INT, &fps, "Frames per second of play", "N" },
+                    { "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads", "N" },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("replay");
+    g_option_context_add_main_entries(context, entries, NULL);
+    gboolean ok = g_option_context_parse(context, &argc, &argv, &error);
+    g_option_context_free(context);
+    if (!ok || threads < 1 || fps < 1 || fps > MAX_FPS || argc != 2)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "no thread, no frame or not one replay");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Loads the replay, with the network and the script of its match.
+    // (A replay of version 1 has no tunables: the match cannot be set up again.)
+    Replay replay;
+    if (!replay_load(&replay, argv[1]))
+    {
+        g_printerr("Error loading replay: %s\n", argv[1]);
+        return 1;
+    }
+    if (model != NULL)
+        replay.config.model = mlp_load(model, &error);
+    if (script != NULL && error == NULL)
+        replay.config.script = script_load(script, &error);
+
+    gint width, height;
+    if (error != NULL || replay.version < 2 || !check_replay(&replay, &width, &height))
+    {
+        g_printerr("Error in the replay: %s\n", error != NULL ? error->message
+                   : "no tunables, snapshots that do not fit them, or a network or a script missing");
+        g_clear_error(&error);
+        replay_free(&replay);
+        return 1;
+    }
+
+    if (output == NULL)
+        output = g_strdup("match.y4m");
+    Format format = g_str_has_suffix(output, ".png") ? FORMAT_PNG : FORMAT_Y4M;
+
+    Playback playback;
+    Sim sim;
+    playback_start(&playback, &replay, &sim);
+
+    // Opens the stream (the frame rate is the one of the export, whatever the tick period;
+    // the samples are in full range, which the header tells the players).
+    FILE *file = NULL;
+    if (format == FORMAT_Y4M)
+    {
+        file = strcmp(output, "-") == 0 ? stdout : fopen(output, "wb");
+        if (file == NULL)
+        {
+            g_printerr("Error opening file: %s\n", output);
+            return 1;
+        }
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, fps);
+    }
+
+    Export export =
+            {
+                    .config = &replay.config,
+                    .width = width,
+                    .height = height,
+                    .format = format,
+                    .window = SLOTS_PER_THREAD * threads,
+            };
+    export.slots = g_new0(Slot, export.window);
+    for (guint i = 0; i < export.window; i++)
+    {
+        export.slots[i].data = g_byte_array_new();
+        export.slots[i].done = TRUE;
+    }
+    g_mutex_init(&export.mutex);
+    g_cond_init(&export.changed);
+
+    gint64 start = g_get_monotonic_time();
+    GThread *workers[threads];
+    for (gint i = 0; i < threads; i++)
+        workers[i] = g_thread_new("export", run_worker, &export);
+
+    // Frame 'f' shows the match after the ticks that started before 'f / fps' seconds.
+    // (The time of the match adds up the tick period of each tick: a reload can change it.
+    // The last frame shows the end of the replay.)
+    guint64 time = 0;
+    gboolean playing = TRUE;
+    gboolean written = TRUE;
+    for (guint frame = 0; playing && written; frame++)
+    {
+        while (time * fps < (guint64) frame * 1000 && playback_step(&playback, &sim))
+            time += playback.config.tick_period;
+        playing = playback.tick < replay.length;
+
+        // Writes the frame that last used the slot, then queues this one.
+        if (frame >= export.window)
+            written = write_frame(&export, frame - export.window, file, output);
+
+        Slot *slot = &export.slots[frame % export.window];
+        snapshot_save(&sim, &slot->snapshot);
+        slot->done = FALSE;
+
+        g_mutex_lock(&export.mutex);
+        export.queued++;
+        g_cond_broadcast(&export.changed);
+        g_mutex_unlock(&export.mutex);
+    }
+
+    g_mutex_lock(&export.mutex);
+    export.finished = TRUE;
+    g_cond_broadcast(&export.changed);
+    g_mutex_unlock(&export.mutex);
+
+    // Writes the frames left in the queue.
+    for (guint frame = export.queued > export.window ? export.queued - export.window : 0;
+         frame < export.queued && written; frame++)
+        written = write_frame(&export, frame, file, output);
+
+    for (gint i = 0; i < threads; i++)
+        g_thread_join(workers[i]);
+    gdouble elapsed = (g_get_monotonic_time() - start) / 1e6;
+
+    if (file != NULL && (fflush(file) != 0 || (file != stdout && fclose(file) != 0)))
+        written = FALSE;
+    if (!written && format == FORMAT_Y4M && !export.failed)
+        g_printerr("Error writing file: %s\n", output);
+
+    gdouble seconds = time / 1000.0;
+    g_printerr("frames %u  threads %d  ms/frame %.3f  speed %.1fx real time\n", export.queued, threads,
+               export.queued == 0 ? 0.0 : elapsed * 1000 / export.queued, elapsed > 0 ? seconds / elapsed : 0.0);
+
+    for (guint i = 0; i < export.window; i++)
+        g_byte_array_unref(export.slots[i].data);
+    g_free(export.slots);
+    g_mutex_clear(&export.mutex);
+    g_cond_clear(&export.changed);
+    sim_free(&sim);
+    mlp_free(replay.config.model);
+    script_free(replay.config.script);
+    replay_free(&replay);
+    g_free(output);
+    g_free(model);
+    g_free(script);
+
+    return written ? 0 : 1;
+}
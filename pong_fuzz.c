@@ -0,0 +1,540 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "bricks.h"
+#include "config.h"
+#include "sim.h"
+#include "snapshot.h"
+
+#define INPUT_SIZE 4096             // Size of the random inputs of the standalone mode in bytes
+#define OP_RESIZE 0xf8              // Smallest byte of an input that resizes the arena
+#define OP_SCALE 0xf0               // Smallest byte of an input that changes the time scale
+#define FUZZ_PADDLES 8              // Largest number of paddles of an input
+#define FUZZ_BRICKS 16              // Largest number of columns or rows of bricks of an input
+#define FUZZ_SCRIPT 32              // Largest number of lines of the script of an input
+#define BRICK_CHECK_PERIOD 64       // Number of ticks between two checks of the bricks without changes
+
+// Reader of the bytes of an input (zeros once they are exhausted).
+typedef struct Reader
+{
+    const guint8 *data;             // Bytes
+    gsize size;                     // Number of bytes
+    gsize position;                 // Index of the next byte
+} Reader;
+
+// Input being run by the thread (written to a file if an invariant is broken).
+static __thread const Reader *current_input;
+
+// Reads a byte of an input.
+static guint read_byte(Reader *reader)
+{
+    return reader->position < reader->size ? reader->data[reader->position++] : 0;
+}
+
+// Reads two bytes of an input.
+static guint read_u16(Reader *reader)
+{
+    guint low = read_byte(reader);
+    return low | read_byte(reader) << 8;
+}
+
+// Reports a broken invariant, saves the input and aborts.
+static void fail(const Sim *sim, const gchar *invariant)
+{
+    g_printerr("Invariant broken at tick %u: %s\n"
+               "  arena %dx%d  disc %d,%d step %d,%d  state %d\n",
+               sim->tick, invariant, sim->width, sim->height, sim->disc.rect.x, sim->disc.rect.y,
+               sim->disc.step.x, sim->disc.step.y, sim->state);
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        g_printerr("  paddle %u side %d  %d,%d  score %u\n", i, paddle->side, paddle->rect.x, paddle->rect.y, paddle->score);
+    }
+
+    gchar path[64];
+    g_snprintf(path, sizeof(path), "crash-%016" G_GINT64_MODIFIER "x.bin", sim_hash(sim));
+    FILE *file = fopen(path, "wb");
+    if (file != NULL)
+    {
+        fwrite(current_input->data, 1, current_input->size, file);
+        fclose(file);
+        g_printerr("  input saved to %s\n", path);
+    }
+
+    abort();
+}
+
+// Gets whether a paddle stands against its wall.
+static gboolean against_wall(const Sim *sim, const Paddle *paddle)
+{
+    switch (paddle->side)
+    {
+        case SIDE_LEFT: return paddle->rect.x == 0;
+        case SIDE_RIGHT: return paddle->rect.x == sim->width - paddle->rect.width;
+        case SIDE_TOP: return paddle->rect.y == 0;
+        default: return paddle->rect.y == sim->height - paddle->rect.height;
+    }
+}
+
+// Gets whether the disc moves towards the wall of a side.
+static gboolean moves_towards(const Disc *disc, Side side)
+{
+    switch (side)
+    {
+        case SIDE_LEFT: return disc->step.x < 0;
+        case SIDE_RIGHT: return disc->step.x > 0;
+        case SIDE_TOP: return disc->step.y < 0;
+        default: return disc->step.y > 0;
+    }
+}
+
+// Checks that a paddle is inside the arena and has been resolved against the disc.
+// (If the disc overlaps a paddle against its wall during play, it moves away from it.)
+static void check_paddle(const Sim *sim, const Paddle *paddle)
+{
+    const Rect *rect = &paddle->rect;
+
+    if (rect->x < 0 || rect->x > sim->width - rect->width || rect->y < 0 || rect->y > sim->height - rect->height)
+        fail(sim, "paddle inside the arena");
+
+    if (sim->state == PLAY && against_wall(sim, paddle) && moves_towards(&sim->disc, paddle->side)
+        && rect_intersect(rect, &sim->disc.rect))
+        fail(sim, "no paddle overlap after resolution");
+}
+
+// Checks the invariants after a tick.
+static void check_tick(const Sim *sim, const guint *scores)
+{
+    const Disc *disc = &sim->disc;
+
+    if (disc->rect.x < 0 || disc->rect.x > sim->width - disc->rect.width
+        || disc->rect.y < 0 || disc->rect.y > sim->height - disc->rect.height)
+        fail(sim, "disc inside the arena");
+
+    // The first paddle of each side stands against its wall.
+    guint placed = 0;
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        if (!(placed & 1u << paddle->side) && !against_wall(sim, paddle))
+            fail(sim, "first paddle of a side against its wall");
+        placed |= 1u << paddle->side;
+
+        check_paddle(sim, paddle);
+    }
+
+    // A tick scores at most one goal, counted by all the paddles of its wall,
+    // and pauses or ends the match.
+    guint scored = 0;
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        if (paddle->score < scores[i] || paddle->score > scores[i] + 1)
+            fail(sim, "score monotonicity");
+        if (paddle->score != scores[i])
+            scored |= 1u << paddle->side;
+    }
+
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        if ((scored & 1u << paddle->side) && paddle->score == scores[i])
+            fail(sim, "goal counted by the paddles of its wall");
+    }
+
+    if (scored != 0 && (scored & (scored - 1)) != 0)
+        fail(sim, "one goal per tick");
+
+    if (scored != 0 && sim->state == PLAY)
+        fail(sim, "goal pauses the match");
+
+    // A goal is only scored when the disc has passed the paddles in front of the wall.
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        if ((scored & 1u << sim->paddles[i].side) && rect_intersect(&sim->paddles[i].rect, &disc->rect))
+            fail(sim, "no tunneling through a paddle");
+    }
+}
+
+// Gets the bounds of the standing bricks of a node of the tree from the bricks themselves.
+// ('exact' is cleared if the bounds of the node or of one of its children are not those.)
+static Rect node_bounds(const Bricks *bricks, guint index, gboolean *exact)
+{
+    const BrickNode *node = &bricks->nodes[index];
+    Rect bounds = { 0, 0, 0, 0 };
+
+    if (node->count == 0)
+    {
+        Rect left = node_bounds(bricks, index + 1, exact);
+        Rect right = node_bounds(bricks, node->start, exact);
+        bounds = left.width == 0 ? right : right.width == 0 ? left : rect_union(&left, &right);
+    }
+    else
+    {
+        for (guint slot = node->start; slot < node->start + node->count; slot++)
+        {
+            if (bricks->standing[slot])
+                bounds = bounds.width == 0 ? bricks->rects[slot] : rect_union(&bounds, &bricks->rects[slot]);
+        }
+    }
+
+    if (bounds.x != node->bounds.x || bounds.y != node->bounds.y
+        || bounds.width != node->bounds.width || bounds.height != node->bounds.height)
+        *exact = FALSE;
+    return bounds;
+}
+
+// Gets the time when a moving interval enters a still one along an axis, and the time it leaves it.
+// (Reference for the swept queries, in 16.16 fractions of the move.)
+static void enter_leave(gint from, gint to, gint size, gint start, gint length, gint64 *enter, gint64 *leave)
+{
+    gint64 move = to - from;
+    gint64 near = move > 0 ? start - (gint64) from - size : from - (gint64) start - length;
+    gint64 far = move > 0 ? start + (gint64) length - from : from + (gint64) size - start;
+
+    if (move != 0)
+    {
+        *enter = near * 65536 / ABS(move);
+        *leave = far * 65536 / ABS(move);
+    }
+    else
+    {
+        gboolean inside = from < start + length && start < from + size;
+        *enter = inside ? G_MININT64 : G_MAXINT64;
+        *leave = inside ? G_MAXINT64 : G_MININT64;
+    }
+}
+
+// Checks the tree of the bricks: exact bounds after the refits, and the same swept query
+// as a test of every brick.
+static void check_bricks(const Sim *sim)
+{
+    const Bricks *bricks = sim->bricks;
+
+    gboolean exact = TRUE;
+    node_bounds(bricks, 0, &exact);
+    if (!exact)
+        fail(sim, "brick bounds refitted");
+
+    // Sweeps the disc over 8 ticks.
+    Rect from = sim->disc.rect;
+    Rect to = from;
+    to.x += (sim->disc.step.x * 8) >> FIXED_SHIFT;
+    to.y += (sim->disc.step.y * 8) >> FIXED_SHIFT;
+
+    gint64 first = 65536;
+    guint first_id = 0;
+    for (guint slot = 0; slot < bricks->count; slot++)
+    {
+        const Rect *rect = &bricks->rects[slot];
+        if (!bricks->standing[slot] || rect_intersect(rect, &from))
+            continue;
+
+        gint64 enter_x, leave_x, enter_y, leave_y;
+        enter_leave(from.x, to.x, from.width, rect->x, rect->width, &enter_x, &leave_x);
+        enter_leave(from.y, to.y, from.height, rect->y, rect->height, &enter_y, &leave_y);
+        gint64 enter = MAX(enter_x, enter_y);
+        if (enter >= 0 && enter < MIN(leave_x, leave_y) && (enter < first || (enter == first && bricks->ids[slot] < first_id)))
+        {
+            first = enter;
+            first_id = bricks->ids[slot];
+        }
+    }
+
+    BrickHit hit;
+    gboolean found = bricks_sweep(bricks, &from, &to, &hit);
+    if (found != (first < 65536) || (found && hit.id != first_id))
+        fail(sim, "swept query of the tree equal to a test of every brick");
+}
+
+// Writes the source of a script from the bytes of an input.
+// (Each line has an instruction with operands of its form: most scripts assemble, and the
+// jumps go anywhere. An operand is now and then of the wrong kind, so that some do not.)
+static gchar *fuzz_script(Reader *reader)
+{
+    // Instructions, with the kinds of their operands: register written, register, value, input or label.
+    static const gchar *instructions[][2] =
+            {
+                    { "add", "wrv" }, { "sub", "wrv" }, { "mul", "wrv" }, { "div", "wrv" }, { "mod", "wrv" },
+                    { "and", "wrv" }, { "or", "wrv" }, { "xor", "wrv" }, { "shl", "wrv" }, { "shr", "wrv" },
+                    { "min", "wrv" }, { "max", "wrv" }, { "mov", "wv" }, { "neg", "wv" }, { "abs", "wv" },
+                    { "in", "wi" }, { "jmp", "l" }, { "jeq", "rvl" }, { "jne", "rvl" }, { "jlt", "rvl" },
+                    { "jle", "rvl" }, { "jgt", "rvl" }, { "jge", "rvl" }, { "move", "v" }, { "up", "" },
+                    { "down", "" }, { "stay", "" },
+            };
+    static const gchar *inputs[] = { "disc_along", "disc_distance", "disc_step_along", "disc_step_towards", "tick" };
+
+    GString *source = g_string_new(NULL);
+    guint count = 1 + read_byte(reader) % FUZZ_SCRIPT;
+    for (guint i = 0; i < count; i++)
+    {
+        guint instruction = read_byte(reader) % G_N_ELEMENTS(instructions);
+        g_string_append_printf(source, "l%u: %s", i, instructions[instruction][0]);
+
+        for (const gchar *kind = instructions[instruction][1]; *kind != '\0'; kind++)
+        {
+            guint byte = read_byte(reader);
+            g_string_append(source, kind == instructions[instruction][1] ? " " : ", ");
+
+            // (One byte in 64 gives an operand of the wrong kind.)
+            gchar actual = byte % 64 == 63 ? "wrvil"[byte / 64 % 5] : *kind;
+            switch (actual)
+            {
+                case 'w': g_string_append_printf(source, "r%u", 1 + byte % 15); break;
+                case 'r': g_string_append_printf(source, "r%u", byte % 16); break;
+                case 'i': g_string_append(source, inputs[byte % G_N_ELEMENTS(inputs)]); break;
+                case 'l': g_string_append_printf(source, "l%u", byte % count); break;
+                default:
+                    if (byte & 1)
+                        g_string_append_printf(source, "r%u%+d", byte / 2 % 16, (gint8) read_byte(reader));
+                    else
+                        g_string_append_printf(source, "%d", (gint8) read_byte(reader) * 4099);
+                    break;
+            }
+        }
+        g_string_append_c(source, '\n');
+    }
+
+    return g_string_free(source, FALSE);
+}
+
+// Gets an arena size that holds the paddles and the disc.
+// (Large enough for a disc never to touch a paddle against a wall and a paddle
+// in front of the opposite wall at once, whichever the sides of the paddles.)
+static void arena_size(const Config *config, guint width, guint height, gint *arena_width, gint *arena_height)
+{
+    gint size = 4 * (config->paddle_width + config->disc_size) + config->paddle_height;
+
+    *arena_width = size + width % 1500;
+    *arena_height = size + height % 1000;
+}
+
+// Runs a match driven by an input and checks the invariants on every tick.
+// (Returns the number of ticks run.)
+static guint64 fuzz_one(const guint8 *data, gsize size)
+{
+    Reader reader = { data, size, 0 };
+    current_input = &reader;
+
+    // The first bytes set the tunables.
+    Config config;
+    config_defaults(&config);
+    config.paddle_width = 1 + read_byte(&reader) % 20;
+    config.paddle_height = 1 + read_byte(&reader) % 200;
+    config.paddle_step = read_byte(&reader) % 30;
+    config.paddle_period = 1 + read_byte(&reader) % 10;
+    config.disc_size = 1 + read_byte(&reader) % 30;
+    config.disc_speed = read_byte(&reader) / 8.0;
+    config.tick_period = 1 + read_byte(&reader) % 10;
+    config.end_game_score = 1 + read_byte(&reader) % 10;
+    config.seed = read_byte(&reader);
+    config.p1_control = read_byte(&reader) % (CONTROL_SCRIPT + 1);
+    config.p2_control = read_byte(&reader) % (CONTROL_SCRIPT + 1);
+    config.others_control = read_byte(&reader) % (CONTROL_SCRIPT + 1);
+
+    // Two bits per side: from one paddle up to FUZZ_PADDLES.
+    config.lineup.count = 1 + read_byte(&reader) % FUZZ_PADDLES;
+    for (guint i = 0; i < config.lineup.count; i += 4)
+    {
+        guint sides = read_byte(&reader);
+        for (guint j = i; j < MIN(i + 4, config.lineup.count); j++, sides >>= 2)
+            config.lineup.sides[j] = sides & 3;
+    }
+
+    config.brick_columns = read_byte(&reader) % FUZZ_BRICKS;
+    config.brick_rows = read_byte(&reader) % FUZZ_BRICKS;
+    config.brick_gap = read_byte(&reader) % 4;
+    config.static_bricks = read_byte(&reader) & 1;
+    guint width = read_u16(&reader);
+    arena_size(&config, width, read_u16(&reader), &config.width, &config.height);
+
+    // The scripted paddles run a random script, with a budget small enough to be exceeded.
+    gchar *source = fuzz_script(&reader);
+    config.script = script_assemble(source, "fuzz", NULL);
+    config.script_budget = read_byte(&reader) % 64;
+    g_free(source);
+
+    Sim sim;
+    sim_init(&sim, &config);
+    sim_set_state(&sim, PLAY);
+
+    guint scores[MAX_PADDLES] = { 0 };
+    guint64 ticks = 0;
+    gboolean bricks_changed = TRUE;
+
+    // The next bytes resize the arena, change the time scale, or give the keys of a run of ticks.
+    while (reader.position < reader.size)
+    {
+        guint op = read_byte(&reader);
+
+        if (op >= OP_RESIZE)
+        {
+            gint arena_width, arena_height;
+            guint resize_width = read_u16(&reader);
+            arena_size(&config, resize_width, read_u16(&reader), &arena_width, &arena_height);
+            sim_resize(&sim, arena_width, arena_height);
+            bricks_changed = TRUE;
+            continue;
+        }
+
+        if (op >= OP_SCALE)
+        {
+            sim.scale = FIXED_ONE / 2 + read_byte(&reader) * (FIXED_ONE / 8);
+            continue;
+        }
+
+        for (guint i = 0; i <= op >> 4; i++, ticks++)
+        {
+            // (The keys of the first two paddles are repeated for the others.)
+            sim_step(&sim, (op & 0xf) * 0x11111111u);
+            check_tick(&sim, scores);
+
+            // Resumes after a goal, and starts a new match after the end of one.
+            Event event;
+            while (sim_poll_event(&sim, &event))
+            {
+                if (event.type == EVENT_STATE && event.value != PLAY)
+                {
+                    bricks_changed |= event.value == STOP;
+                    sim_set_state(&sim, PLAY);
+                }
+                bricks_changed |= event.type == EVENT_BRICK_HIT && sim.bricks->destructible;
+            }
+
+            // The whole tree is checked after the bricks change (a brick destroyed, a resize or a
+            // new match), and now and then otherwise: a test of every brick is slow.
+            if (sim.bricks != NULL && (bricks_changed || ticks % BRICK_CHECK_PERIOD == 0))
+                check_bricks(&sim);
+            bricks_changed = FALSE;
+
+            // (Starting a new match resets the scores.)
+            for (guint j = 0; j < sim.paddle_count; j++)
+                scores[j] = sim.paddles[j].score;
+        }
+    }
+
+    sim_free(&sim);
+    script_free(config.script);
+    return ticks;
+}
+
+// Entry point of libFuzzer.
+int LLVMFuzzerTestOneInput(const guint8 *data, gsize size)
+{
+    fuzz_one(data, size);
+    return 0;
+}
+
+#ifndef PONG_LIBFUZZER
+
+// Work of a thread of the standalone mode.
+typedef struct Worker
+{
+    guint64 seed;                   // Seed of the random inputs
+    gint64 end;                     // End of the run in microseconds
+    guint64 inputs;                 // Number of inputs run
+    guint64 ticks;                  // Number of ticks run
+} Worker;
+
+// Runs random inputs until the end of the run.
+static gpointer run_worker(gpointer data)
+{
+    Worker *worker = data;
+    guint8 input[INPUT_SIZE];
+    guint64 x = worker->seed | 1;
+
+    while (g_get_monotonic_time() < worker->end)
+    {
+        // Xorshift: the inputs of a seed can be generated again.
+        for (guint i = 0; i < INPUT_SIZE; i += 8)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            for (guint j = 0; j < 8; j++)
+                input[i + j] = x >> (8 * j);
+        }
+
+        worker->ticks += fuzz_one(input, INPUT_SIZE);
+        worker->inputs++;
+    }
+
+    return NULL;
+}
+
+// Runs random inputs on all the cores (or the inputs given as files, as libFuzzer does).
+// Usage: pong_fuzz [--threads=N] [--seconds=S] [--seed=N] [inputs...]
+int main(int argc, char *argv[])
+{
+    gint threads = g_get_num_processors();
+    gint seconds = 10;
+    gint64 seed = 1;
+
+    GOptionEntry entries[] =
+            {
+                    { "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads", "N" },
+                    { "seconds", 0, 0, G_OPTION_ARG_INT, &seconds, "Duration of the run", "S" },
+                    { "seed", 0, 0, G_OPTION_ARG_INT64, &seed, "Seed of the random inputs", "N" },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("[inputs...]");
+    g_option_context_add_main_entries(context, entries, NULL);
+    gboolean ok = g_option_context_parse(context, &argc, &argv, &error);
+    g_option_context_free(context);
+
+    if (!ok || threads < 1)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "no thread");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Runs the inputs given as files.
+    if (argc > 1)
+    {
+        for (gint i = 1; i < argc; i++)
+        {
+            gchar *data;
+            gsize size;
+            if (!g_file_get_contents(argv[i], &data, &size, NULL))
+            {
+                g_printerr("Error reading input: %s\n", argv[i]);
+                return 1;
+            }
+
+            printf("%s: %" G_GUINT64_FORMAT " ticks\n", argv[i], fuzz_one((const guint8*) data, size));
+            g_free(data);
+        }
+        return 0;
+    }
+
+    // Runs random inputs on all the threads.
+    gint64 start = g_get_monotonic_time();
+    Worker workers[threads];
+    GThread *handles[threads];
+    for (gint i = 0; i < threads; i++)
+    {
+        workers[i] = (Worker) { (guint64) seed * 0x9e3779b97f4a7c15ULL + i, start + seconds * G_USEC_PER_SEC, 0, 0 };
+        handles[i] = g_thread_new("fuzz", run_worker, &workers[i]);
+    }
+
+    guint64 inputs = 0;
+    guint64 ticks = 0;
+    for (gint i = 0; i < threads; i++)
+    {
+        g_thread_join(handles[i]);
+        inputs += workers[i].inputs;
+        ticks += workers[i].ticks;
+    }
+
+    gdouble elapsed = (g_get_monotonic_time() - start) / (gdouble) G_USEC_PER_SEC;
+    printf("threads %d  inputs %" G_GUINT64_FORMAT "  ticks %" G_GUINT64_FORMAT "  ticks/s %.0f\n",
+           threads, inputs, ticks, ticks / elapsed);
+
+    return 0;
+}
+
+#endif
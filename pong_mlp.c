@@ -0,0 +1,333 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "config.h"
+#include "mlp.h"
+#include "sim.h"
+
+#define BATCH 64                    // Number of samples of a step of the gradient descent
+#define HELD_OUT 10                 // Percentage of the samples kept to evaluate the network
+#define CALIBRATION 4096            // Largest number of samples used to quantize the network
+#define MOMENTUM 0.9f               // Momentum of the gradient descent
+#define WANDER_TICKS 200            // Mean number of ticks between the changes of behaviour of a recorded paddle
+
+// Observations of paddles and the moves of the predicting controller for them.
+typedef struct Samples
+{
+    gfloat *observations;           // Observations (MLP_OBSERVATIONS each)
+    gint *labels;                   // Move of the predicting controller (-1, 0 or 1)
+    guint count;                    // Number of samples
+} Samples;
+
+// Gradients or velocities of a network (laid out as its weights).
+typedef struct Deltas
+{
+    gfloat *weights[MLP_MAX_LAYERS]; // Of the weights of each layer
+    gfloat *bias[MLP_MAX_LAYERS];   // Of the bias of each layer
+} Deltas;
+
+// Gets the next number of a random number generator (xorshift), between 0 and 1.
+static gfloat random_unit(guint32 *rng)
+{
+    guint32 x = *rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *rng = x;
+    return (x >> 8) / (gfloat) (1 << 24);
+}
+
+// Records the observations of the paddles of matches, with the moves that predicting paddles would make.
+// (The paddles follow the disc with errors, or wander on random keys for a while: the network
+// also sees paddles far from their targets, as its own paddle is when it starts to miss.)
+static void record(const Config *config, Samples *samples, guint count, guint32 *rng)
+{
+    Config noisy = *config;
+    noisy.p1_control = CONTROL_NOISY;
+    noisy.p2_control = CONTROL_NOISY;
+    noisy.others_control = CONTROL_NOISY;
+
+    Sim sim;
+    sim_init(&sim, &noisy);
+    sim_set_state(&sim, PLAY);
+
+    samples->observations = g_new(gfloat, count * MLP_OBSERVATIONS);
+    samples->labels = g_new(gint, count);
+    samples->count = 0;
+
+    guint keys = 0;
+    while (samples->count < count)
+    {
+        for (guint i = 0; i < sim.paddle_count && samples->count < count; i++)
+        {
+            sim_observe(&sim, &sim.paddles[i], samples->observations + samples->count * MLP_OBSERVATIONS);
+            samples->labels[samples->count++] = sim_decide(&sim, &sim.paddles[i]);
+        }
+
+        // Changes now and then whether each paddle wanders, and the key it holds.
+        for (guint i = 0; i < MIN(sim.paddle_count, KEY_PADDLES); i++)
+        {
+            guint bits = KEY_UP(i) | KEY_DOWN(i);
+            if (random_unit(rng) < 1.0f / WANDER_TICKS)
+                sim.remote_keys ^= bits;
+            if (random_unit(rng) < 4.0f / WANDER_TICKS)
+                keys = (keys & ~bits) | (guint) (random_unit(rng) * 3) << (2 * i);
+        }
+
+        // Resumes the match after each goal.
+        sim_step(&sim, keys & sim.remote_keys);
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+    }
+
+    sim_free(&sim);
+}
+
+// Shuffles the samples (Fisher-Yates).
+static void shuffle(Samples *samples, guint32 *rng)
+{
+    for (guint i = samples->count; i > 1; i--)
+    {
+        guint j = MIN((guint) (random_unit(rng) * i), i - 1);
+        gfloat observation[MLP_OBSERVATIONS];
+        gint label = samples->labels[i - 1];
+
+        memcpy(observation, samples->observations + (i - 1) * MLP_OBSERVATIONS, sizeof(observation));
+        memcpy(samples->observations + (i - 1) * MLP_OBSERVATIONS, samples->observations + j * MLP_OBSERVATIONS,
+               sizeof(observation));
+        memcpy(samples->observations + j * MLP_OBSERVATIONS, observation, sizeof(observation));
+        samples->labels[i - 1] = samples->labels[j];
+        samples->labels[j] = label;
+    }
+}
+
+// Allocates deltas of zeros for a network.
+static void deltas_init(Deltas *deltas, const Mlp *mlp)
+{
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        deltas->weights[i] = g_new0(gfloat, mlp->layers[i].outputs * mlp->layers[i].stride);
+        deltas->bias[i] = g_new0(gfloat, mlp->layers[i].outputs);
+    }
+}
+
+// Frees deltas.
+static void deltas_free(Deltas *deltas, const Mlp *mlp)
+{
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        g_free(deltas->weights[i]);
+        g_free(deltas->bias[i]);
+    }
+}
+
+// Sets random weights (He initialization: uniform, scaled by the number of inputs).
+static void randomize(Mlp *mlp, guint32 *rng)
+{
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        MlpLayer *layer = &mlp->layers[i];
+        gfloat limit = sqrtf(6.0f / layer->inputs);
+
+        for (guint row = 0; row < layer->outputs; row++)
+        {
+            for (guint j = 0; j < layer->inputs; j++)
+                layer->weights[row * layer->stride + j] = (2 * random_unit(rng) - 1) * limit;
+        }
+    }
+}
+
+// Adds the gradients of the loss of one sample (softmax cross-entropy).
+// (Returns the loss.)
+static gfloat backpropagate(const Mlp *mlp, const gfloat *observation, gint label, Deltas *gradients)
+{
+    // Keeps the inputs of every layer.
+    gfloat activations[MLP_MAX_LAYERS + 1][MLP_MAX_WIDTH] = { { 0 } };
+    memcpy(activations[0], observation, MLP_OBSERVATIONS * sizeof(gfloat));
+
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        const MlpLayer *layer = &mlp->layers[i];
+        for (guint row = 0; row < layer->outputs; row++)
+        {
+            gfloat sum = layer->bias[row];
+            for (guint j = 0; j < layer->inputs; j++)
+                sum += layer->weights[row * layer->stride + j] * activations[i][j];
+            activations[i + 1][row] = i == mlp->layer_count - 1 || sum > 0 ? sum : 0;
+        }
+    }
+
+    // Gradient of the loss with respect to the outputs: softmax minus the expected action.
+    const gfloat *outputs = activations[mlp->layer_count];
+    gfloat max = MAX(MAX(outputs[0], outputs[1]), outputs[2]);
+    gfloat total = 0;
+    gfloat delta[MLP_MAX_WIDTH];
+    for (guint i = 0; i < MLP_ACTIONS; i++)
+    {
+        delta[i] = expf(outputs[i] - max);
+        total += delta[i];
+    }
+    for (guint i = 0; i < MLP_ACTIONS; i++)
+        delta[i] /= total;
+    gfloat loss = -logf(MAX(delta[label + 1], 1e-12f));
+    delta[label + 1] -= 1;
+
+    for (guint i = mlp->layer_count; i-- > 0; )
+    {
+        const MlpLayer *layer = &mlp->layers[i];
+        gfloat previous[MLP_MAX_WIDTH] = { 0 };
+
+        for (guint row = 0; row < layer->outputs; row++)
+        {
+            for (guint j = 0; j < layer->inputs; j++)
+            {
+                gradients->weights[i][row * layer->stride + j] += delta[row] * activations[i][j];
+                previous[j] += layer->weights[row * layer->stride + j] * delta[row];
+            }
+            gradients->bias[i][row] += delta[row];
+        }
+
+        // Goes back through the ReLU of the layer before.
+        for (guint j = 0; j < layer->inputs; j++)
+            delta[j] = activations[i][j] > 0 ? previous[j] : 0;
+    }
+
+    return loss;
+}
+
+// Takes a step of the gradient descent and clears the gradients.
+static void descend(Mlp *mlp, Deltas *gradients, Deltas *velocities, gfloat rate)
+{
+    for (guint i = 0; i < mlp->layer_count; i++)
+    {
+        MlpLayer *layer = &mlp->layers[i];
+        for (guint k = 0; k < layer->outputs * layer->stride; k++)
+        {
+            velocities->weights[i][k] = MOMENTUM * velocities->weights[i][k] - rate * gradients->weights[i][k] / BATCH;
+            layer->weights[k] += velocities->weights[i][k];
+            gradients->weights[i][k] = 0;
+        }
+        for (guint row = 0; row < layer->outputs; row++)
+        {
+            velocities->bias[i][row] = MOMENTUM * velocities->bias[i][row] - rate * gradients->bias[i][row] / BATCH;
+            layer->bias[row] += velocities->bias[i][row];
+            gradients->bias[i][row] = 0;
+        }
+    }
+}
+
+// Gets the percentage of samples whose move is the one of the predicting controller.
+static gdouble accuracy(const Mlp *mlp, const gfloat *observations, const gint *labels, guint count)
+{
+    guint correct = 0;
+    for (guint i = 0; i < count; i++)
+        correct += mlp_decide(mlp, observations + i * MLP_OBSERVATIONS) == labels[i];
+    return 100.0 * correct / MAX(count, 1);
+}
+
+// Trains the network of the neural paddles to imitate the predicting ones and writes it to a file.
+// (Records the observations of the paddles of matches, with the moves of the predicting controller,
+// trains a float network on them by stochastic gradient descent, then quantizes it to int8.)
+// Usage: pong_mlp [--samples=N] [--epochs=N] [--hidden=N] [--float] [--OPTION=VALUE...] OUTPUT
+int main(int argc, char *argv[])
+{
+    gint sample_count = 200000;
+    gint epochs = 10;
+    gint hidden = 32;
+    gboolean keep_float = FALSE;
+
+    Config config;
+    config_defaults(&config);
+
+    GOptionEntry entries[] =
+            {
+                    { "samples", 0, 0, G_OPTION_ARG_INT, &sample_count, "Number of samples recorded", "N" },
+                    { "epochs", 0, 0, G_OPTION_ARG_INT, &epochs, "Number of passes over the samples", "N" },
+                    { "hidden", 0, 0, G_OPTION_ARG_INT, &hidden, "Width of the two hidden layers", "N" },
+                    { "float", 0, 0, G_OPTION_ARG_NONE, &keep_float, "Keep the float weights (no int8 quantization)", NULL },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    if (!config_parse(&config, entries, FALSE, &argc, &argv, &error) || argc != 2
+        || sample_count < 100 || epochs < 1 || hidden < 1 || hidden > MLP_MAX_WIDTH)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "usage: pong_mlp [OPTION...] OUTPUT");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    guint32 rng = (guint32) config.seed | 1;
+    Samples samples;
+    record(&config, &samples, sample_count, &rng);
+    shuffle(&samples, &rng);
+
+    // Keeps the last samples to evaluate the network.
+    guint test_count = samples.count * HELD_OUT / 100;
+    guint train_count = samples.count - test_count;
+    const gfloat *test_observations = samples.observations + train_count * MLP_OBSERVATIONS;
+    const gint *test_labels = samples.labels + train_count;
+
+    guint widths[] = { MLP_OBSERVATIONS, hidden, hidden, MLP_ACTIONS };
+    Mlp *mlp = mlp_new(widths, G_N_ELEMENTS(widths) - 1);
+    randomize(mlp, &rng);
+
+    Deltas gradients, velocities;
+    deltas_init(&gradients, mlp);
+    deltas_init(&velocities, mlp);
+
+    // Trains the network, with a rate that decreases on each pass.
+    for (gint epoch = 0; epoch < epochs; epoch++)
+    {
+        gfloat rate = 0.05f / (1 + epoch);
+        gdouble loss = 0;
+
+        for (guint i = 0; i < train_count; i++)
+        {
+            loss += backpropagate(mlp, samples.observations + i * MLP_OBSERVATIONS, samples.labels[i], &gradients);
+            if ((i + 1) % BATCH == 0)
+                descend(mlp, &gradients, &velocities, rate);
+        }
+
+        printf("epoch %2d  loss %.4f  accuracy %.2f%%\n", epoch + 1, loss / train_count,
+               accuracy(mlp, test_observations, test_labels, test_count));
+    }
+
+    // Quantizes the network with the ranges of the first samples.
+    if (!keep_float)
+    {
+        mlp_quantize(mlp, samples.observations, MIN(train_count, CALIBRATION));
+        printf("int8      accuracy %.2f%%\n", accuracy(mlp, test_observations, test_labels, test_count));
+    }
+
+    // Checks that the batched path decides as the single one.
+    gint *directions = g_new(gint, test_count);
+    mlp_decide_batch(mlp, test_observations, test_count, directions);
+    guint mismatches = 0;
+    for (guint i = 0; i < test_count; i++)
+        mismatches += directions[i] != mlp_decide(mlp, test_observations + i * MLP_OBSERVATIONS);
+    printf("kernels %s  batch mismatches %u\n", mlp->kernels->name, mismatches);
+
+    gboolean ok = mlp_save(mlp, argv[1]);
+    if (!ok)
+        g_printerr("Error writing file: %s\n", argv[1]);
+
+    g_free(directions);
+    deltas_free(&gradients, mlp);
+    deltas_free(&velocities, mlp);
+    mlp_free(mlp);
+    g_free(samples.observations);
+    g_free(samples.labels);
+    g_free(config.file);
+    mlp_free(config.model);
+    script_free(config.script);
+
+    return ok && mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <glib.h>
+
+#include "config.h"
+#include "replay.h"
+#include "sim.h"
+
+// Runs matches without a user interface.
+// (Player 1 follows the disc by default; player 2 plays the keys of the replays given as arguments,
+// or is controlled as configured. The match is resumed after each goal.)
+// Usage: pong_sim [--config=FILE] [--ticks=N] [--OPTION=VALUE...] [replays...]
+int main(int argc, char *argv[])
+{
+    guint goals = 0;
+    guint hits = 0;
+    guint matches = 0;
+    guint current = 0;
+    guint position = 0;
+
+    Config config;
+    config_defaults(&config);
+    config.p1_control = CONTROL_FOLLOW;
+    config.p2_control = CONTROL_NOISY;
+
+    GError *error = NULL;
+    if (!config_parse(&config, NULL, FALSE, &argc, &argv, &error))
+    {
+        g_printerr("Error in the options: %s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Loads the replays.
+    guint replay_count = argc - 1;
+    Replay replays[MAX(replay_count, 1)];
+    for (guint i = 0; i < replay_count; i++)
+    {
+        if (!replay_load(&replays[i], argv[i + 1]))
+        {
+            g_printerr("Error loading replay: %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
+
+    Sim sim;
+    sim_init(&sim, &config);
+    if (replay_count != 0)
+        sim.paddles[1].control = CONTROL_KEYS;
+    sim_set_state(&sim, PLAY);
+
+    guint64 ticks = config.ticks;
+    gint64 start = g_get_monotonic_time();
+
+    for (guint64 tick = 0; tick < ticks; tick++)
+    {
+        guint keys = 0;
+        if (replay_count != 0)
+        {
+            // Plays the replays one after the other, in a loop.
+            keys = replays[current].keys[position++];
+            if (position == replays[current].length)
+            {
+                position = 0;
+                current = (current + 1) % replay_count;
+            }
+        }
+
+        sim_step(&sim, keys);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (event.type == EVENT_PADDLE_HIT)
+                hits++;
+            else if (event.type == EVENT_GOAL)
+                goals++;
+            else if (event.type == EVENT_STATE && event.value == STOP)
+                matches++;
+
+            if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+    }
+
+    gint64 elapsed = g_get_monotonic_time() - start;
+
+    printf("ticks %" G_GUINT64_FORMAT "  matches %u  goals %u  hits %u  ns/tick %.1f\n",
+           ticks, matches, goals, hits, ticks == 0 ? 0.0 : elapsed * 1000.0 / ticks);
+    if (sim.script_overruns > 0)
+        printf("script overruns %u\n", sim.script_overruns);
+
+    sim_free(&sim);
+    for (guint i = 0; i < replay_count; i++)
+        replay_free(&replays[i]);
+    g_free(config.file);
+    mlp_free(config.model);
+    script_free(config.script);
+
+    return 0;
+}
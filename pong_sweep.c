@@ -0,0 +1,469 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "config.h"
+#include "sim.h"
+
+#define MAX_AXES 8                  // Largest number of swept tunables
+#define MAX_VALUES 1024             // Largest number of values of a swept tunable
+#define MAX_POINTS 1000000          // Largest number of points of the grid
+#define Z_95 1.96                   // Half-width of a 95% interval in standard deviations
+#define MATCH_BATCH 4               // Number of matches of a point handed out to a worker at once
+
+// Tunable swept over a list of values.
+typedef struct Axis
+{
+    gchar *name;                    // Name of the tunable (as on the command line)
+    guint count;                    // Number of values
+    gdouble values[MAX_VALUES];     // Values
+} Axis;
+
+// Mean of a measure over the matches, with its interval.
+typedef struct Measure
+{
+    guint count;                    // Number of samples
+    gdouble sum;                    // Sum of the samples
+    gdouble squares;                // Sum of the squares of the samples
+} Measure;
+
+// Measures of a match.
+typedef struct MatchResult
+{
+    gdouble win;                    // Win of player 1 (1/2 for a draw)
+    guint goals;                    // Number of goals
+    guint hits;                     // Number of bounces on the paddles
+    guint64 ticks;                  // Number of ticks played
+} MatchResult;
+
+// Point of the grid and the measures of its matches.
+typedef struct GridPoint
+{
+    Config config;                  // Tunables of the matches
+    gboolean valid;                 // The tunables are in range (no match is played otherwise)
+    gboolean converged;             // The intervals have converged before the largest number of matches
+    guint matches;                  // Number of matches played
+    gdouble wins;                   // Wins of player 1 (1/2 per draw)
+    guint goals;                    // Number of goals
+    guint hits;                     // Number of bounces on the paddles
+    guint64 ticks;                  // Number of ticks played
+    Measure points_per_minute;      // Goals per minute of play of each match
+    MatchResult *wave;              // Measures of the matches of the wave being played (NULL if none)
+    guint wave_start;               // First match of the wave
+    guint wave_count;               // Number of matches of the wave
+    guint pending;                  // Number of batches of the wave not played yet
+} GridPoint;
+
+// Matches of a point handed out to a worker.
+typedef struct Batch
+{
+    GridPoint *point;               // Point of the matches
+    guint first;                    // First match
+    guint count;                    // Number of matches
+} Batch;
+
+// Sweep of the grid, shared by the workers.
+// (The fields after 'precision' are protected by the lock.)
+typedef struct Sweep
+{
+    GridPoint *points;              // Points of the grid (the last axis varies fastest)
+    guint point_count;              // Number of points
+    guint min_matches;              // Number of matches played before testing the intervals
+    guint max_matches;              // Largest number of matches of a point
+    gdouble precision;              // Half-width of the intervals that stops a point
+    guint next;                     // Next point whose matches are started
+    GQueue batches;                 // Batches waiting for a worker
+    guint busy;                     // Number of workers playing a batch
+    GMutex lock;                    // Lock of the queue and of the waves
+    GCond changed;                  // Signalled when a batch is queued or played
+} Sweep;
+
+// Adds a sample to a measure.
+static void measure_add(Measure *measure, gdouble sample)
+{
+    measure->count++;
+    measure->sum += sample;
+    measure->squares += sample * sample;
+}
+
+// Gets the mean of a measure.
+static gdouble measure_mean(const Measure *measure)
+{
+    return measure->count == 0 ? 0 : measure->sum / measure->count;
+}
+
+// Gets the half-width of the 95% interval of the mean of a measure.
+static gdouble measure_interval(const Measure *measure)
+{
+    if (measure->count < 2)
+        return INFINITY;
+
+    gdouble mean = measure_mean(measure);
+    gdouble variance = MAX(measure->squares / measure->count - mean * mean, 0) * measure->count / (measure->count - 1);
+    return Z_95 * sqrt(variance / measure->count);
+}
+
+// Gets the half-width of the 95% interval of the win rate of player 1.
+// (Agresti-Coull: two wins and two losses are added, so that the interval of a player
+// that always wins is not empty.)
+static gdouble win_interval(const GridPoint *point)
+{
+    gdouble rate = (point->wins + 2) / (point->matches + 4);
+    return Z_95 * sqrt(rate * (1 - rate) / (point->matches + 4));
+}
+
+// Parses a swept tunable: "name=v1,v2,..." or "name=first:last:step".
+static gboolean parse_axis(const gchar *text, Axis *axis, const Config *config, GError **error)
+{
+    gchar **parts = g_strsplit(text, "=", 2);
+    gboolean ok = g_strv_length(parts) == 2;
+    gchar **values = ok ? g_strsplit(parts[1], strchr(parts[1], ':') != NULL ? ":" : ",", -1) : NULL;
+    gdouble numbers[MAX_VALUES];
+    guint count = values != NULL ? g_strv_length(values) : 0;
+
+    ok &= count > 0 && count <= MAX_VALUES;
+    for (guint i = 0; ok && i < count; i++)
+    {
+        gchar *end;
+        numbers[i] = g_ascii_strtod(values[i], &end);
+        ok = end != values[i] && *end == '\0' && isfinite(numbers[i]);
+    }
+
+    *axis = (Axis) { .name = ok ? g_strdup(parts[0]) : NULL };
+    if (ok && strchr(parts[1], ':') != NULL)
+    {
+        // Counts from the first value to the last one (included).
+        ok = count == 3 && numbers[2] > 0 && numbers[1] >= numbers[0]
+             && (numbers[1] - numbers[0]) / numbers[2] < MAX_VALUES;
+        // (The last value is kept despite the rounding of the steps, whatever its sign.)
+        for (guint i = 0; ok && numbers[0] + i * numbers[2] <= numbers[1] + 1e-9 * numbers[2]; i++)
+            axis->values[axis->count++] = numbers[0] + i * numbers[2];
+    }
+    else if (ok)
+    {
+        memcpy(axis->values, numbers, count * sizeof(gdouble));
+        axis->count = count;
+    }
+
+    g_strfreev(values);
+    g_strfreev(parts);
+    if (!ok)
+    {
+        g_free(axis->name);
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Not a sweep: %s", text);
+        return FALSE;
+    }
+
+    // Checks that the tunable can be set (its values are checked at each point).
+    Config checked = *config;
+    GError *set_error = NULL;
+    if (!config_set_number(&checked, axis->name, axis->values[0], &set_error)
+        && g_error_matches(set_error, G_OPTION_ERROR, G_OPTION_ERROR_UNKNOWN_OPTION))
+    {
+        g_propagate_error(error, set_error);
+        g_free(axis->name);
+        return FALSE;
+    }
+
+    g_clear_error(&set_error);
+    return TRUE;
+}
+
+// Plays a match of a point and gets its measures.
+// (The match ends at the end-game score, or after the ticks tunable. The score of a paddle
+// counts the goals on its wall: player 1 wins with the lower score.)
+static void play_match(const GridPoint *point, guint match, MatchResult *result)
+{
+    Config config = point->config;
+    config.seed += match;
+
+    Sim sim;
+    sim_init(&sim, &config);
+    sim_set_state(&sim, PLAY);
+
+    guint goals = 0;
+    guint hits = 0;
+    gboolean over = FALSE;
+    guint64 ticks;
+    for (ticks = 0; !over && ticks < (guint64) config.ticks; ticks++)
+    {
+        sim_step(&sim, 0);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            if (event.type == EVENT_PADDLE_HIT)
+                hits++;
+            else if (event.type == EVENT_GOAL)
+                goals++;
+            else if (event.type == EVENT_STATE && event.value == STOP)
+                over = TRUE;
+            else if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+    }
+
+    guint first = sim.paddles[0].score;
+    guint second = sim.paddles[1].score;
+    sim_free(&sim);
+
+    *result = (MatchResult) { first < second ? 1 : first > second ? 0 : 0.5, goals, hits, ticks };
+}
+
+// Hands out the next matches of a point as batches (called with the lock held).
+static void start_wave(Sweep *sweep, GridPoint *point, guint count)
+{
+    point->wave = g_new(MatchResult, count);
+    point->wave_start = point->matches;
+    point->wave_count = count;
+    point->pending = 0;
+
+    for (guint first = 0; first < count; first += MATCH_BATCH)
+    {
+        Batch *batch = g_new(Batch, 1);
+        *batch = (Batch) { point, point->wave_start + first, MIN(MATCH_BATCH, count - first) };
+        g_queue_push_tail(&sweep->batches, batch);
+        point->pending++;
+    }
+}
+
+// Adds the measures of a played wave in the order of its matches, then starts the next wave
+// unless the point has converged (called with the lock held).
+// (The intervals are tested after each match as if they were played one at a time: the matches
+// of the wave after the convergence are dropped. The first wave has the matches played before
+// testing the intervals; each next one a quarter of the matches played, at least a batch.)
+static void finish_wave(Sweep *sweep, GridPoint *point)
+{
+    for (guint i = 0; i < point->wave_count && !point->converged; i++)
+    {
+        const MatchResult *result = &point->wave[i];
+        point->matches++;
+        point->wins += result->win;
+        point->goals += result->goals;
+        point->hits += result->hits;
+        point->ticks += result->ticks;
+        measure_add(&point->points_per_minute,
+                    result->goals / (result->ticks * point->config.tick_period / 60000.0));
+
+        // Stops when the win rate and the points per minute are both known well enough.
+        point->converged = point->matches >= sweep->min_matches && point->matches < sweep->max_matches
+                           && win_interval(point) <= sweep->precision
+                           && measure_interval(&point->points_per_minute)
+                              <= sweep->precision * measure_mean(&point->points_per_minute);
+    }
+
+    g_free(point->wave);
+    point->wave = NULL;
+    if (!point->converged && point->matches < sweep->max_matches)
+        start_wave(sweep, point, MIN(MAX(point->matches / 4, MATCH_BATCH), sweep->max_matches - point->matches));
+}
+
+// Plays the matches of the points, in batches, until their intervals are narrow enough.
+// (A worker of the thread pool: all the workers share the queue of batches, so that they stay
+// busy until the last points. A point is started when no batch is waiting, and the measures of
+// its matches are added in order, so the results do not depend on the number of threads.)
+static gpointer run_worker(gpointer data)
+{
+    Sweep *sweep = data;
+
+    g_mutex_lock(&sweep->lock);
+    for (;;)
+    {
+        while (g_queue_is_empty(&sweep->batches) && sweep->next < sweep->point_count)
+        {
+            GridPoint *point = &sweep->points[sweep->next++];
+            if (point->valid)
+                start_wave(sweep, point, sweep->min_matches);
+        }
+
+        // Waits for the batches being played, which may start the next waves of their points.
+        Batch *batch = g_queue_pop_head(&sweep->batches);
+        if (batch == NULL)
+        {
+            if (sweep->busy == 0)
+                break;
+            g_cond_wait(&sweep->changed, &sweep->lock);
+            continue;
+        }
+
+        sweep->busy++;
+        g_mutex_unlock(&sweep->lock);
+
+        GridPoint *point = batch->point;
+        for (guint match = batch->first; match < batch->first + batch->count; match++)
+            play_match(point, match, &point->wave[match - point->wave_start]);
+        g_free(batch);
+
+        g_mutex_lock(&sweep->lock);
+        if (--point->pending == 0)
+            finish_wave(sweep, point);
+        sweep->busy--;
+        g_cond_broadcast(&sweep->changed);
+    }
+
+    g_cond_broadcast(&sweep->changed);
+    g_mutex_unlock(&sweep->lock);
+    return NULL;
+}
+
+// Writes the measures of the points as CSV, a row per point.
+static void write_csv(FILE *file, const Sweep *sweep, const Axis *axes, guint axis_count)
+{
+    for (guint i = 0; i < axis_count; i++)
+        fprintf(file, "%s,", axes[i].name);
+    fprintf(file, "matches,win_rate,win_rate_ci,rally_hits,rally_seconds,points_per_minute,points_per_minute_ci,converged\n");
+
+    for (guint p = 0; p < sweep->point_count; p++)
+    {
+        const GridPoint *point = &sweep->points[p];
+        gdouble seconds = point->ticks * point->config.tick_period / 1000.0;
+
+        for (guint i = 0, rest = p, stride = sweep->point_count; i < axis_count; i++)
+        {
+            stride /= axes[i].count;
+            fprintf(file, "%g,", axes[i].values[rest / stride]);
+            rest %= stride;
+        }
+        if (point->matches == 0)
+        {
+            fprintf(file, "0,,,,,,,0\n");
+            continue;
+        }
+
+        fprintf(file, "%u,%.4f,%.4f,%.2f,%.3f,%.3f,%.3f,%d\n", point->matches, point->wins / point->matches,
+                win_interval(point), point->goals == 0 ? 0.0 : (gdouble) point->hits / point->goals,
+                point->goals == 0 ? seconds : seconds / point->goals,
+                measure_mean(&point->points_per_minute), measure_interval(&point->points_per_minute),
+                point->converged);
+    }
+}
+
+// Plays bot-against-bot matches on every point of a grid of tunables on all the cores and
+// writes their measures: win rate of player 1, rally length and points per minute.
+// (Each --sweep gives a tunable and its values, as a list or a range, e.g. --sweep=paddle-step=3,5,7
+// --sweep=disc-speed=1:3:0.5. A point stops early once the 95% intervals of its win rate and
+// points per minute are narrower than the precision.)
+// Usage: pong_sweep [--sweep=NAME=VALUES...] [--min-matches=N] [--max-matches=N] [--precision=X]
+//                   [--threads=N] [--output=FILE] [--OPTION=VALUE...]
+int main(int argc, char *argv[])
+{
+    gchar **sweeps = NULL;
+    gint min_matches = 20;
+    gint max_matches = 500;
+    gdouble precision = 0.05;
+    gint threads = g_get_num_processors();
+    gchar *output = NULL;
+
+    Config config;
+    config_defaults(&config);
+    config.ticks = 200000;
+    config.p1_control = CONTROL_FOLLOW;
+    config.p2_control = CONTROL_NOISY;
+
+    GOptionEntry entries[] =
+            {
+                    { "sweep", 0, 0, G_OPTION_ARG_STRING_ARRAY, &sweeps, "Tunable and its values (list or first:last:step)", "NAME=VALUES" },
+                    { "min-matches", 0, 0, G_OPTION_ARG_INT, &min_matches, "Number of matches of a point before stopping early", "N" },
+                    { "max-matches", 0, 0, G_OPTION_ARG_INT, &max_matches, "Largest number of matches of a point", "N" },
+                    { "precision", 0, 0, G_OPTION_ARG_DOUBLE, &precision, "Half-width of the intervals that stops a point (win rate, relative points per minute)", "X" },
+                    { "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads", "N" },
+                    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "CSV file of the measures (standard output otherwise)", "FILE" },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    if (!config_parse(&config, entries, FALSE, &argc, &argv, &error) || threads < 1 || min_matches < 1
+        || max_matches < min_matches || precision <= 0)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "no thread or match");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Reads the axes of the grid.
+    Axis *axes = g_new0(Axis, MAX_AXES);
+    guint axis_count = sweeps != NULL ? g_strv_length(sweeps) : 0;
+    guint point_count = 1;
+    for (guint i = 0; i < axis_count; i++)
+    {
+        if (i == MAX_AXES || !parse_axis(sweeps[i], &axes[i], &config, &error))
+        {
+            g_printerr("Error in the options: %s\n", error != NULL ? error->message : "too many sweeps");
+            g_clear_error(&error);
+            return 1;
+        }
+        point_count *= axes[i].count;
+        if (point_count > MAX_POINTS)
+        {
+            g_printerr("Error in the options: more than %d points\n", MAX_POINTS);
+            return 1;
+        }
+    }
+
+    // Sets the tunables of each point (the last axis varies fastest).
+    Sweep sweep =
+            {
+                    .points = g_new0(GridPoint, point_count),
+                    .point_count = point_count,
+                    .min_matches = min_matches,
+                    .max_matches = max_matches,
+                    .precision = precision,
+                    .batches = G_QUEUE_INIT,
+            };
+    g_mutex_init(&sweep.lock);
+    g_cond_init(&sweep.changed);
+    for (guint p = 0; p < point_count; p++)
+    {
+        GridPoint *point = &sweep.points[p];
+        point->config = config;
+        point->valid = TRUE;
+        for (guint i = axis_count, rest = p; i-- > 0; rest /= axes[i].count)
+            point->valid &= config_set_number(&point->config, axes[i].name, axes[i].values[rest % axes[i].count], NULL);
+    }
+
+    // Plays the points on all the threads at once.
+    gint64 start = g_get_monotonic_time();
+    GThread *workers[threads];
+    for (gint i = 0; i < threads; i++)
+        workers[i] = g_thread_new("sweep", run_worker, &sweep);
+    for (gint i = 0; i < threads; i++)
+        g_thread_join(workers[i]);
+    gdouble elapsed = (g_get_monotonic_time() - start) / 1e6;
+
+    FILE *file = output != NULL ? fopen(output, "w") : stdout;
+    if (file == NULL)
+    {
+        g_printerr("Error opening file: %s\n", output);
+        return 1;
+    }
+    write_csv(file, &sweep, axes, axis_count);
+    if (file != stdout)
+        fclose(file);
+
+    guint matches = 0;
+    guint converged = 0;
+    guint64 ticks = 0;
+    for (guint p = 0; p < point_count; p++)
+    {
+        matches += sweep.points[p].matches;
+        converged += sweep.points[p].converged;
+        ticks += sweep.points[p].ticks;
+    }
+    g_printerr("points %u  converged %u  matches %u  threads %d  ticks/s %.0f\n",
+               point_count, converged, matches, threads, elapsed > 0 ? ticks / elapsed : 0.0);
+
+    g_mutex_clear(&sweep.lock);
+    g_cond_clear(&sweep.changed);
+    g_free(sweep.points);
+    for (guint i = 0; i < axis_count; i++)
+        g_free(axes[i].name);
+    g_free(axes);
+    g_strfreev(sweeps);
+    g_free(output);
+    g_free(config.file);
+    mlp_free(config.model);
+    script_free(config.script);
+
+    return 0;
+}
@@ -0,0 +1,455 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "config.h"
+#include "sim.h"
+
+#define RESULTS_HEADER "pong-tournament 2" // First line of a file of results
+#define MAX_ENTRANTS 64             // Largest number of entrants
+#define RATING_BASE 1500.0          // Rating of an entrant before any game
+#define RATING_DEVIATION 350.0      // Deviation of the ratings before any game (as Glicko)
+#define RATING_SWEEPS 200           // Number of passes of the fit of the ratings
+#define ELO_SCALE (G_LN10 / 400)    // Elo points to natural log odds
+
+// Player of the tournament: a controller, with its network or its bot.
+typedef struct Entrant
+{
+    const gchar *name;              // Name (as given on the command line)
+    Control control;                // Controller of its paddle
+    Mlp *model;                     // Network of a neural entrant (NULL otherwise)
+    Script *script;                 // Bot of a scripted entrant (NULL otherwise)
+} Entrant;
+
+// Entrants of a pairing.
+typedef struct Pair
+{
+    guint first;                    // First entrant (on the left in the even rounds)
+    guint second;                   // Second entrant
+} Pair;
+
+// Outcome of a game, for the first entrant of its pairing.
+typedef enum Outcome
+{
+    OUTCOME_NONE,                   // Not played yet
+    OUTCOME_WIN,                    // The first entrant has let in fewer goals
+    OUTCOME_LOSS,                   // The second entrant has let in fewer goals
+    OUTCOME_DRAW,                   // Same scores
+} Outcome;
+
+// Letters of the outcomes in the results file.
+static const gchar outcome_letters[] = "-WLD";
+
+// Games of the tournament and their results.
+// (Game k is the pairing k % pair_count in round k / pair_count: each round plays every pairing once.)
+typedef struct Tournament
+{
+    const Config *config;           // Tunables of the games
+    const Entrant *entrants;        // Entrants
+    guint entrant_count;            // Number of entrants
+    Pair *pairs;                    // Pairings
+    guint pair_count;               // Number of pairings
+    guint game_count;               // Number of games (pairings times rounds)
+    guint8 *outcomes;               // Outcome of each game
+    gint next;                      // Next game to be played by a worker (atomic)
+    GMutex lock;                    // Guards the results file and the counts below
+    FILE *results;                  // Results file, appended after each game (NULL if none)
+    guint played;                   // Number of games played by this run
+    guint64 ticks;                  // Number of ticks of these games
+} Tournament;
+
+// Rating of an entrant.
+typedef struct Rating
+{
+    guint entrant;                  // Entrant
+    gdouble rating;                 // Rating in Elo points
+    gdouble deviation;              // Standard deviation of the rating (as the Glicko RD)
+    guint games;                    // Number of games played
+    gdouble points;                 // Points (1 per win, 1/2 per draw)
+} Rating;
+
+// Gets the entrant of a command-line argument: a bot file (.bot), a controller or a network file.
+// (The neural entrant plays with the network of the model tunable.)
+static gboolean load_entrant(Entrant *entrant, const gchar *name, const Config *config, GError **error)
+{
+    *entrant = (Entrant) { .name = name };
+    if (g_str_has_suffix(name, ".bot"))
+    {
+        entrant->control = CONTROL_SCRIPT;
+        entrant->script = script_load(name, error);
+        return entrant->script != NULL;
+    }
+    if (!config_parse_control(name, &entrant->control, NULL))
+    {
+        entrant->control = CONTROL_NEURAL;
+        entrant->model = mlp_load(name, error);
+        return entrant->model != NULL;
+    }
+
+    if (entrant->control == CONTROL_KEYS || entrant->control == CONTROL_SCRIPT
+        || (entrant->control == CONTROL_NEURAL && config->model == NULL))
+    {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Entrant cannot play alone: %s", name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Plays a game and gets its outcome.
+// (The game is a match of the seed of its round, the entrants swapping sides every round;
+// it ends at the end-game score, or after the ticks tunable, the scores as they stand. The score
+// of a paddle counts the goals on its wall: the winner is the entrant with the lower score.)
+static Outcome play_game(Tournament *tournament, guint game, guint64 *ticks)
+{
+    guint round = game / tournament->pair_count;
+    const Pair *pair = &tournament->pairs[game % tournament->pair_count];
+    const Entrant *first = &tournament->entrants[pair->first];
+    const Entrant *second = &tournament->entrants[pair->second];
+    const Entrant *players[2] = { round % 2 == 0 ? first : second, round % 2 == 0 ? second : first };
+
+    Config config = *tournament->config;
+    config.seed += round;
+
+    Sim sim;
+    sim_init(&sim, &config);
+    for (guint i = 0; i < 2; i++)
+    {
+        Paddle *paddle = &sim.paddles[i];
+        paddle->control = players[i]->control;
+        paddle->model = players[i]->model != NULL ? players[i]->model : config.model;
+        paddle->script = players[i]->script;
+    }
+    sim_set_state(&sim, PLAY);
+
+    gboolean over = FALSE;
+    for (*ticks = 0; !over && *ticks < (guint64) config.ticks; (*ticks)++)
+    {
+        sim_step(&sim, 0);
+
+        Event event;
+        while (sim_poll_event(&sim, &event))
+        {
+            // Resumes the match after a goal (the scores are kept until the next one).
+            if (event.type == EVENT_STATE && event.value == STOP)
+                over = TRUE;
+            else if (event.type == EVENT_STATE && event.value != PLAY)
+                sim_set_state(&sim, PLAY);
+        }
+    }
+
+    guint first_score = sim.paddles[round % 2].score;
+    guint second_score = sim.paddles[1 - round % 2].score;
+    sim_free(&sim);
+
+    return first_score < second_score ? OUTCOME_WIN : first_score > second_score ? OUTCOME_LOSS : OUTCOME_DRAW;
+}
+
+// Plays the games not played yet, taking them in order, and appends their results to the file.
+// (A worker of the thread pool: all the workers share the counter of the next game.)
+static gpointer run_worker(gpointer data)
+{
+    Tournament *tournament = data;
+
+    for (;;)
+    {
+        guint game = g_atomic_int_add(&tournament->next, 1);
+        if (game >= tournament->game_count)
+            return NULL;
+        if (tournament->outcomes[game] != OUTCOME_NONE)
+            continue;
+
+        guint64 ticks;
+        Outcome outcome = play_game(tournament, game, &ticks);
+
+        g_mutex_lock(&tournament->lock);
+        tournament->outcomes[game] = outcome;
+        tournament->played++;
+        tournament->ticks += ticks;
+        if (tournament->results != NULL)
+        {
+            // (A line per game, written at once: an interrupted run loses the games being played only.)
+            fprintf(tournament->results, "game %u %c\n", game, outcome_letters[outcome]);
+            fflush(tournament->results);
+        }
+        g_mutex_unlock(&tournament->lock);
+    }
+}
+
+// Reads the games of an earlier run from a results file, or creates it.
+// (The tunables and the entrants must be the same, in the same order; an unfinished last line is ignored.
+// The file is then opened to append the next results.)
+static gboolean open_results(Tournament *tournament, const gchar *path, GError **error)
+{
+    gchar *contents = NULL;
+    gsize length = 0;
+    if (!g_file_get_contents(path, &contents, &length, NULL))
+    {
+        tournament->results = fopen(path, "w");
+        if (tournament->results == NULL)
+        {
+            g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Error creating file: %s", path);
+            return FALSE;
+        }
+
+        fprintf(tournament->results, "%s\n", RESULTS_HEADER);
+        config_write(tournament->config, tournament->results, "set ");
+        for (guint i = 0; i < tournament->entrant_count; i++)
+            fprintf(tournament->results, "entrant %s\n", tournament->entrants[i].name);
+        fflush(tournament->results);
+        return TRUE;
+    }
+
+    gchar *end = strrchr(contents, '\n');
+    gsize complete = end != NULL ? end + 1 - contents : 0;
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    guint line_count = g_strv_length(lines) - 1;
+    guint entrants = 0;
+    gboolean ok = line_count > 0 && strcmp(lines[0], RESULTS_HEADER) == 0;
+
+    // The games must have been played with the same tunables, in the same order.
+    gchar *text = config_format(tournament->config, "set ");
+    gchar **settings = g_strsplit(text, "\n", -1);
+    guint setting_count = g_strv_length(settings) - 1;
+    guint set = 0;
+    g_free(text);
+
+    for (guint i = 1; ok && i < line_count; i++)
+    {
+        guint game;
+        gchar outcome;
+        if (g_str_has_prefix(lines[i], "set "))
+            ok = set < setting_count && strcmp(lines[i], settings[set++]) == 0;
+        else if (g_str_has_prefix(lines[i], "entrant "))
+        {
+            ok = entrants < tournament->entrant_count
+                 && strcmp(lines[i] + strlen("entrant "), tournament->entrants[entrants++].name) == 0;
+        }
+        else if (sscanf(lines[i], "game %u %c", &game, &outcome) == 2
+                 && outcome != '\0' && strchr(outcome_letters + 1, outcome) != NULL)
+        {
+            // (The games of later rounds are kept, for a run with fewer rounds.)
+            if (game < tournament->game_count)
+                tournament->outcomes[game] = strchr(outcome_letters, outcome) - outcome_letters;
+        }
+        else
+            ok = FALSE;
+    }
+    ok &= entrants == tournament->entrant_count && set == setting_count;
+
+    g_strfreev(settings);
+    g_strfreev(lines);
+    if (!ok)
+    {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Not the results of this tournament: %s", path);
+        g_free(contents);
+        return FALSE;
+    }
+
+    // Drops the unfinished line.
+    ok = complete == length || g_file_set_contents(path, contents, complete, error);
+    g_free(contents);
+    if (!ok)
+        return FALSE;
+
+    tournament->results = fopen(path, "a");
+    if (tournament->results == NULL)
+    {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Error opening file: %s", path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Fits the ratings to the outcomes of the games played.
+// (The ratings maximize the likelihood of the outcomes under the Elo model, with a prior
+// of RATING_DEVIATION around RATING_BASE so that an entrant that never lost has a finite
+// rating, as Glicko gives for a single rating period. The deviations come from the
+// curvature of the likelihood at the fit: their intervals are wide while few games are played.)
+static void fit_ratings(const Tournament *tournament, Rating *ratings)
+{
+    guint n = tournament->entrant_count;
+    guint *games = g_new0(guint, n * n);
+    gdouble *points = g_new0(gdouble, n * n);
+
+    for (guint i = 0; i < n; i++)
+        ratings[i] = (Rating) { .entrant = i };
+
+    // Counts the games and the points of each entrant against each other one.
+    for (guint game = 0; game < tournament->game_count; game++)
+    {
+        Outcome outcome = tournament->outcomes[game];
+        if (outcome == OUTCOME_NONE)
+            continue;
+
+        const Pair *pair = &tournament->pairs[game % tournament->pair_count];
+        gdouble score = outcome == OUTCOME_WIN ? 1 : outcome == OUTCOME_LOSS ? 0 : 0.5;
+        games[pair->first * n + pair->second]++;
+        games[pair->second * n + pair->first]++;
+        points[pair->first * n + pair->second] += score;
+        points[pair->second * n + pair->first] += 1 - score;
+    }
+
+    // Newton steps on each rating in turn (in Elo points from RATING_BASE).
+    gdouble prior = 1 / (RATING_DEVIATION * RATING_DEVIATION);
+    for (guint sweep = 0; sweep < RATING_SWEEPS; sweep++)
+    {
+        for (guint i = 0; i < n; i++)
+        {
+            gdouble slope = -ratings[i].rating * prior;
+            gdouble curvature = prior;
+            for (guint j = 0; j < n; j++)
+            {
+                gdouble expected = 1 / (1 + exp(-ELO_SCALE * (ratings[i].rating - ratings[j].rating)));
+                slope += ELO_SCALE * (points[i * n + j] - games[i * n + j] * expected);
+                curvature += ELO_SCALE * ELO_SCALE * games[i * n + j] * expected * (1 - expected);
+            }
+            ratings[i].rating += slope / curvature;
+        }
+    }
+
+    for (guint i = 0; i < n; i++)
+    {
+        gdouble curvature = prior;
+        for (guint j = 0; j < n; j++)
+        {
+            gdouble expected = 1 / (1 + exp(-ELO_SCALE * (ratings[i].rating - ratings[j].rating)));
+            curvature += ELO_SCALE * ELO_SCALE * games[i * n + j] * expected * (1 - expected);
+            ratings[i].games += games[i * n + j];
+            ratings[i].points += points[i * n + j];
+        }
+        ratings[i].deviation = 1 / sqrt(curvature);
+    }
+    for (guint i = 0; i < n; i++)
+        ratings[i].rating += RATING_BASE;
+
+    g_free(games);
+    g_free(points);
+}
+
+// Orders the ratings from the best.
+static gint compare_ratings(gconstpointer a, gconstpointer b)
+{
+    const Rating *first = a;
+    const Rating *second = b;
+    return (first->rating < second->rating) - (first->rating > second->rating);
+}
+
+// Prints the ratings, from the best, with their 95% intervals.
+static void print_ratings(const Tournament *tournament)
+{
+    Rating ratings[MAX_ENTRANTS];
+    fit_ratings(tournament, ratings);
+    qsort(ratings, tournament->entrant_count, sizeof(Rating), compare_ratings);
+
+    printf("%-4s  %-24s  %7s  %7s  %6s  %6s\n", "rank", "entrant", "rating", "95%", "games", "score");
+    for (guint i = 0; i < tournament->entrant_count; i++)
+    {
+        const Rating *rating = &ratings[i];
+        printf("%-4u  %-24s  %7.1f  %7.1f  %6u  %5.1f%%\n", i + 1, tournament->entrants[rating->entrant].name,
+               rating->rating, 1.96 * rating->deviation, rating->games,
+               rating->games == 0 ? 0.0 : 100 * rating->points / rating->games);
+    }
+}
+
+// Plays every pairing of the entrants over several seeds on all the cores and rates the entrants.
+// (The entrants are controllers, bot files or network files, on the first two paddles. The results
+// are appended to the results file after each game: an interrupted tournament started again with
+// the same file, entrants and tunables plays the missing games only.)
+// Usage: pong_tournament [--rounds=N] [--threads=N] [--results=FILE] [--OPTION=VALUE...] entrants...
+int main(int argc, char *argv[])
+{
+    gint rounds = 10;
+    gint threads = g_get_num_processors();
+    gchar *results = NULL;
+
+    Config config;
+    config_defaults(&config);
+    config.ticks = 200000;
+
+    GOptionEntry entries[] =
+            {
+                    { "rounds", 0, 0, G_OPTION_ARG_INT, &rounds, "Number of games of each pairing (with a seed each)", "N" },
+                    { "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads", "N" },
+                    { "results", 'o', 0, G_OPTION_ARG_FILENAME, &results, "File of the results (resumed if it exists)", "FILE" },
+                    { NULL },
+            };
+
+    GError *error = NULL;
+    if (!config_parse(&config, entries, FALSE, &argc, &argv, &error) || threads < 1 || rounds < 1
+        || argc < 3 || argc - 1 > MAX_ENTRANTS)
+    {
+        g_printerr("Error in the options: %s\n", error != NULL ? error->message : "no thread, round or pairing");
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Loads the entrants.
+    guint entrant_count = argc - 1;
+    Entrant entrants[MAX_ENTRANTS];
+    for (guint i = 0; i < entrant_count; i++)
+    {
+        if (!load_entrant(&entrants[i], argv[i + 1], &config, &error))
+        {
+            g_printerr("Error loading entrant: %s\n", error->message);
+            g_clear_error(&error);
+            return 1;
+        }
+    }
+
+    Tournament tournament =
+            {
+                    .config = &config,
+                    .entrants = entrants,
+                    .entrant_count = entrant_count,
+                    .pairs = g_new(Pair, entrant_count * (entrant_count - 1) / 2),
+            };
+    for (guint i = 0; i < entrant_count; i++)
+    {
+        for (guint j = i + 1; j < entrant_count; j++)
+        {
+            tournament.pairs[tournament.pair_count++] = (Pair) { i, j };
+        }
+    }
+    tournament.game_count = tournament.pair_count * rounds;
+    tournament.outcomes = g_new0(guint8, tournament.game_count);
+    g_mutex_init(&tournament.lock);
+
+    if (results != NULL && !open_results(&tournament, results, &error))
+    {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
+
+    // Plays the games on all the threads at once.
+    gint64 start = g_get_monotonic_time();
+    GThread *workers[threads];
+    for (gint i = 0; i < threads; i++)
+        workers[i] = g_thread_new("tournament", run_worker, &tournament);
+    for (gint i = 0; i < threads; i++)
+        g_thread_join(workers[i]);
+    gdouble elapsed = (g_get_monotonic_time() - start) / 1e6;
+
+    print_ratings(&tournament);
+    printf("games %u  played %u  threads %d  ticks/s %.0f\n", tournament.game_count, tournament.played,
+           threads, elapsed > 0 ? tournament.ticks / elapsed : 0.0);
+
+    if (tournament.results != NULL)
+        fclose(tournament.results);
+    g_mutex_clear(&tournament.lock);
+    g_free(tournament.outcomes);
+    g_free(tournament.pairs);
+    for (guint i = 0; i < entrant_count; i++)
+    {
+        script_free(entrants[i].script);
+        mlp_free(entrants[i].model);
+    }
+    g_free(results);
+    g_free(config.file);
+    mlp_free(config.model);
+    script_free(config.script);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "render.h"
+#include "bricks.h"
+
+// Draws a rectangle with the current source.
+static void render_rect(cairo_t *cr, const Rect *rect)
+{
+    cairo_rectangle(cr, rect->x, rect->y, rect->width, rect->height);
+    cairo_fill(cr);
+}
+
+void render_sim(cairo_t *cr, const Sim *sim)
+{
+    // Sets the background to white.
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_paint(cr);
+
+    // Draws the standing bricks in grey, in a single fill.
+    if (sim->bricks != NULL)
+    {
+        const Bricks *bricks = sim->bricks;
+        cairo_set_source_rgb(cr, 0.6, 0.6, 0.6);
+        for (guint slot = 0; slot < bricks->count; slot++)
+        {
+            if (bricks->standing[slot])
+                cairo_rectangle(cr, bricks->rects[slot].x, bricks->rects[slot].y,
+                                bricks->rects[slot].width, bricks->rects[slot].height);
+        }
+        cairo_fill(cr);
+    }
+
+    //Draw the paddles in black
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    for (guint i = 0; i < sim->paddle_count; i++)
+        render_rect(cr, &sim->paddles[i].rect);
+
+    // Draws the disc in red.
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    render_rect(cr, &sim->disc.rect);
+}
+
+// Adds a rectangle of the arena of a tile to the current path.
+static void add_tile_rect(cairo_t *cr, const Tiles *tiles, const Tile *tile, const Rect *rect)
+{
+    Rect mapped = tiles_map(tiles, tile, rect);
+    cairo_rectangle(cr, mapped.x, mapped.y, mapped.width, mapped.height);
+}
+
+void render_tiles(cairo_t *cr, const Tiles *tiles, const Rect *parts, guint part_count)
+{
+    // Finds the tiles to draw.
+    // (The other ones have not changed: their pixels are kept.)
+    const Tile *shown[MAX(tiles->count, 1)];
+    guint count = 0;
+    for (guint i = 0; i < tiles->count; i++)
+    {
+        for (guint j = 0; j < part_count; j++)
+        {
+            if (rect_intersect(&tiles->tiles[i].arena, &parts[j]))
+            {
+                shown[count++] = &tiles->tiles[i];
+                break;
+            }
+        }
+    }
+
+    // Sets the gaps between the tiles to grey.
+    cairo_set_source_rgb(cr, 0.3, 0.3, 0.3);
+    cairo_paint(cr);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+
+    // Sets the arenas to white.
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    for (guint i = 0; i < count; i++)
+        cairo_rectangle(cr, shown[i]->arena.x, shown[i]->arena.y, shown[i]->arena.width, shown[i]->arena.height);
+    cairo_fill(cr);
+
+    // Draws the standing bricks in grey: each of them, or the bounds of the standing bricks
+    // of each leaf of their tree (the gaps are too thin to be seen), or none at all.
+    cairo_set_source_rgb(cr, 0.6, 0.6, 0.6);
+    for (guint i = 0; i < count && tiles->detail != DETAIL_MINIMAL; i++)
+    {
+        const Bricks *bricks = shown[i]->sim.bricks;
+        if (bricks == NULL)
+            continue;
+
+        if (tiles->detail == DETAIL_FULL)
+        {
+            for (guint slot = 0; slot < bricks->count; slot++)
+            {
+                if (bricks->standing[slot])
+                    add_tile_rect(cr, tiles, shown[i], &bricks->rects[slot]);
+            }
+        }
+        else
+        {
+            for (guint node = 0; node < bricks->node_count; node++)
+            {
+                if (bricks->nodes[node].count != 0 && bricks->nodes[node].bounds.width != 0)
+                    add_tile_rect(cr, tiles, shown[i], &bricks->nodes[node].bounds);
+            }
+        }
+    }
+    cairo_fill(cr);
+
+    // Draws the paddles in black.
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    for (guint i = 0; i < count; i++)
+    {
+        for (guint j = 0; j < shown[i]->sim.paddle_count; j++)
+            add_tile_rect(cr, tiles, shown[i], &shown[i]->sim.paddles[j].rect);
+    }
+    cairo_fill(cr);
+
+    // Draws the discs in red.
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    for (guint i = 0; i < count; i++)
+        add_tile_rect(cr, tiles, shown[i], &shown[i]->sim.disc.rect);
+    cairo_fill(cr);
+
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_DEFAULT);
+}
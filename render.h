@@ -0,0 +1,17 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <cairo.h>
+
+#include "sim.h"
+#include "tiles.h"
+
+// Draws the arena of a simulation (background, bricks, paddles and disc).
+void render_sim(cairo_t *cr, const Sim *sim);
+
+// Draws the arenas of the tiles that meet the parts of the drawing area to redraw.
+// (In a single pass over the tiles: a fill for the backgrounds, the bricks, the paddles and
+// the discs of all of them, at the level of detail of the layout.)
+void render_tiles(cairo_t *cr, const Tiles *tiles, const Rect *parts, guint part_count);
+
+#endif
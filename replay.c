@@ -0,0 +1,321 @@
+#include "replay.h"
+
+#include <string.h>
+
+#define REPLAY_VERSION 2            // Version of the replays recorded
+#define MAX_REPLAY_TICKS (1u << 28) // Largest number of ticks of a replay (12 days of 4 ms ticks, 1 GiB of keys)
+#define MAX_REPLAY_MARKS (1u << 20) // Largest number of changes between the ticks of a replay
+#define REPLAY_LINE (2 * SNAPSHOT_MAX_SIZE + 32) // Longest line of a replay file (a snapshot)
+
+// Appends the keys of a run of ticks.
+// (Returns FALSE if the replay would be longer than the largest one.)
+static gboolean add_run(Replay *replay, guint *capacity, guint count, guint keys)
+{
+    if (count > MAX_REPLAY_TICKS - replay->length)
+        return FALSE;
+
+    while (replay->length + count > *capacity)
+    {
+        *capacity *= 2;
+        replay->keys = g_renew(guint, replay->keys, *capacity);
+    }
+
+    for (guint i = 0; i < count; i++)
+        replay->keys[replay->length++] = keys;
+    return TRUE;
+}
+
+// Appends a change before the next tick.
+// (Returns NULL if there are too many of them.)
+static Mark *add_mark(Replay *replay, guint *capacity, MarkType type)
+{
+    if (replay->mark_count == MAX_REPLAY_MARKS)
+        return NULL;
+
+    if (replay->mark_count == *capacity)
+    {
+        *capacity = MAX(*capacity * 2, 16);
+        replay->marks = g_renew(Mark, replay->marks, *capacity);
+    }
+
+    Mark *mark = &replay->marks[replay->mark_count++];
+    *mark = (Mark) { replay->length, type };
+    return mark;
+}
+
+// Converts the hexadecimal bytes of a snapshot line.
+// (Returns FALSE if they are not valid.)
+static gboolean parse_snapshot(const gchar *line, Snapshot *snapshot)
+{
+    guint size;
+    gint start = 0;
+
+    if (sscanf(line, "snapshot %u %n", &size, &start) != 1 || start == 0 || size > SNAPSHOT_MAX_SIZE)
+        return FALSE;
+
+    const gchar *hex = line + start;
+    for (guint i = 0; i < size; i++)
+    {
+        gint high = g_ascii_xdigit_value(hex[2 * i]);
+        gint low = high < 0 ? -1 : g_ascii_xdigit_value(hex[2 * i + 1]);
+        if (low < 0)
+            return FALSE;
+        snapshot->bytes[i] = high << 4 | low;
+    }
+
+    snapshot->size = size;
+    return hex[2 * size] == '\n' || hex[2 * size] == '\0';
+}
+
+// Sets a tunable of a "set <tunable> <value>" line.
+// (Returns FALSE if it is not valid.)
+static gboolean parse_set(gchar *line, Config *config)
+{
+    gchar **words = g_strsplit(g_strchomp(line), " ", 3);
+    gboolean ok = g_strv_length(words) == 3 && config_set(config, words[1], words[2], NULL);
+    g_strfreev(words);
+    return ok;
+}
+
+gboolean replay_load(Replay *replay, const gchar *path)
+{
+    gchar line[REPLAY_LINE];
+    guint count, keys;
+
+    *replay = (Replay) { 0 };
+    config_defaults(&replay->config);
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return FALSE;
+
+    if (fgets(line, sizeof(line), file) == NULL || sscanf(line, "pong-replay %u", &replay->version) != 1
+        || replay->version == 0 || replay->version > REPLAY_VERSION)
+    {
+        fclose(file);
+        return FALSE;
+    }
+
+    // Expands the runs into one entry per tick.
+    // (The "set" lines before the first tick or change are the tunables of the match; the
+    // following ones are gathered until their "reload" line.)
+    guint capacity = 1024;
+    guint mark_capacity = 0;
+    replay->keys = g_new(guint, capacity);
+    Config latest = replay->config;
+    Config *reload = NULL;
+    gboolean header = TRUE;
+    gboolean ok = TRUE;
+
+    while (ok && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (header && !g_str_has_prefix(line, "set "))
+        {
+            latest = replay->config;
+            header = FALSE;
+        }
+
+        if (sscanf(line, "%u %u", &count, &keys) == 2)
+            ok = add_run(replay, &capacity, count, keys);
+        else if (replay->version == 1)
+            ok = FALSE;
+        else if (g_str_has_prefix(line, "set ") && header)
+            ok = parse_set(line, &replay->config);
+        else if (g_str_has_prefix(line, "set "))
+        {
+            if (reload == NULL)
+            {
+                reload = g_new(Config, 1);
+                *reload = latest;
+            }
+            ok = parse_set(line, reload);
+        }
+        else if (strcmp(line, "reload\n") == 0 && reload != NULL)
+        {
+            Mark *mark = add_mark(replay, &mark_capacity, MARK_CONFIG);
+            ok = mark != NULL;
+            if (ok)
+            {
+                mark->config = reload;
+                latest = *reload;
+                reload = NULL;
+            }
+        }
+        else if (sscanf(line, "remote %u", &keys) == 1)
+        {
+            Mark *mark = add_mark(replay, &mark_capacity, MARK_REMOTE);
+            ok = mark != NULL;
+            if (ok)
+                mark->remote_keys = keys;
+        }
+        else if (g_str_has_prefix(line, "snapshot "))
+        {
+            Snapshot *snapshot = g_new(Snapshot, 1);
+            Mark *mark = parse_snapshot(line, snapshot) ? add_mark(replay, &mark_capacity, MARK_SNAPSHOT) : NULL;
+            ok = mark != NULL;
+            if (ok)
+                mark->snapshot = snapshot;
+            else
+                g_free(snapshot);
+        }
+        else
+            ok = FALSE;
+    }
+
+    fclose(file);
+    g_free(reload);
+    if (!ok || replay->length == 0)
+    {
+        replay_free(replay);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void replay_free(Replay *replay)
+{
+    for (guint i = 0; i < replay->mark_count; i++)
+    {
+        g_free(replay->marks[i].snapshot);
+        g_free(replay->marks[i].config);
+    }
+    g_free(replay->marks);
+    g_free(replay->keys);
+    replay->marks = NULL;
+    replay->mark_count = 0;
+    replay->keys = NULL;
+    replay->length = 0;
+}
+
+// Writes the current run of identical ticks.
+static void recorder_flush(Recorder *recorder)
+{
+    if (recorder->count != 0)
+        fprintf(recorder->file, "%u %u\n", recorder->count, recorder->keys);
+    recorder->count = 0;
+}
+
+gboolean recorder_open(Recorder *recorder, const gchar *path, const Config *config, const Sim *sim)
+{
+    recorder->file = fopen(path, "w");
+    if (recorder->file == NULL)
+        return FALSE;
+
+    fprintf(recorder->file, "pong-replay %d\n", REPLAY_VERSION);
+    config_write(config, recorder->file, "set ");
+    recorder->keys = 0;
+    recorder->count = 0;
+    recorder->remote_keys = 0;
+
+    // (The simulation may have left its initial state already.)
+    recorder_snapshot(recorder, sim);
+    recorder_remote(recorder, sim->remote_keys);
+    return TRUE;
+}
+
+void recorder_add(Recorder *recorder, guint keys)
+{
+    if (recorder->file == NULL)
+        return;
+
+    if (keys != recorder->keys)
+    {
+        recorder_flush(recorder);
+        recorder->keys = keys;
+    }
+    recorder->count++;
+}
+
+void recorder_snapshot(Recorder *recorder, const Sim *sim)
+{
+    if (recorder->file == NULL)
+        return;
+
+    Snapshot snapshot;
+    snapshot_save(sim, &snapshot);
+
+    recorder_flush(recorder);
+    fprintf(recorder->file, "snapshot %" G_GSIZE_FORMAT " ", snapshot.size);
+    for (gsize i = 0; i < snapshot.size; i++)
+        fprintf(recorder->file, "%02x", snapshot.bytes[i]);
+    fputc('\n', recorder->file);
+}
+
+void recorder_remote(Recorder *recorder, guint remote_keys)
+{
+    if (recorder->file == NULL || remote_keys == recorder->remote_keys)
+        return;
+
+    recorder_flush(recorder);
+    fprintf(recorder->file, "remote %u\n", remote_keys);
+    recorder->remote_keys = remote_keys;
+}
+
+void recorder_config(Recorder *recorder, const Config *config)
+{
+    if (recorder->file == NULL)
+        return;
+
+    recorder_flush(recorder);
+    config_write(config, recorder->file, "set ");
+    fputs("reload\n", recorder->file);
+}
+
+void recorder_close(Recorder *recorder)
+{
+    if (recorder->file == NULL)
+        return;
+
+    recorder_flush(recorder);
+    fclose(recorder->file);
+    recorder->file = NULL;
+}
+
+void playback_start(Playback *playback, const Replay *replay, Sim *sim)
+{
+    *playback = (Playback)
+            {
+                    .replay = replay,
+                    .config = replay->config,
+            };
+
+    sim_init(sim, &playback->config);
+}
+
+gboolean playback_step(Playback *playback, Sim *sim)
+{
+    const Replay *replay = playback->replay;
+
+    if (playback->broken || playback->tick == replay->length)
+        return FALSE;
+
+    for (; playback->mark < replay->mark_count && replay->marks[playback->mark].tick == playback->tick; playback->mark++)
+    {
+        const Mark *mark = &replay->marks[playback->mark];
+        if (mark->type == MARK_SNAPSHOT)
+        {
+            playback->broken = !snapshot_restore(sim, mark->snapshot);
+            if (playback->broken)
+                return FALSE;
+            continue;
+        }
+
+        if (mark->type == MARK_REMOTE)
+        {
+            sim->remote_keys = mark->remote_keys;
+            continue;
+        }
+
+        // (The network and the script are kept, as by a reload of the config file.)
+        Mlp *model = playback->config.model;
+        Script *script = playback->config.script;
+        playback->config = *mark->config;
+        playback->config.model = model;
+        playback->config.script = script;
+        sim_apply_config(sim, &playback->config);
+    }
+
+    sim_step(sim, replay->keys[playback->tick++]);
+    return TRUE;
+}
@@ -0,0 +1,102 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "config.h"
+#include "sim.h"
+#include "snapshot.h"
+
+// Type of a change of the simulation made between two ticks.
+typedef enum MarkType
+{
+    MARK_SNAPSHOT,                  // The state is set by the user interface (buttons, rewind, speed, resize...)
+    MARK_CONFIG,                    // The tunables are reloaded
+    MARK_REMOTE,                    // The paddles moved by the keys whatever their controllers change (the bots)
+} MarkType;
+
+// Change of the simulation made between two ticks.
+typedef struct Mark
+{
+    guint tick;                     // Index of the tick it comes before
+    MarkType type;                  // Type
+    Snapshot *snapshot;             // State set (MARK_SNAPSHOT)
+    Config *config;                 // Tunables reloaded (MARK_CONFIG)
+    guint remote_keys;              // Key bits of the paddles moved by the keys (MARK_REMOTE)
+} Mark;
+
+// Replay of a match: the tunables, the key-state mask applied by each tick and the changes
+// made between the ticks.
+// (Text file: a header line, one "set <tunable> <value>" line per tunable, then in order one
+// "<ticks> <keys>" line per run of identical ticks, a "snapshot <size> <hex>" line for each state
+// set from outside the ticks, "set" lines followed by a "reload" line for each reload of the
+// config file, and a "remote <keys>" line when the paddles moved by their bots change. The
+// network and the script are not recorded. A replay of version 1 only has the
+// runs of the ticks played, and the default tunables.)
+typedef struct Replay
+{
+    guint version;                  // Version of the file
+    Config config;                  // Tunables of the match
+    guint *keys;                    // Keys of each tick
+    guint length;                   // Number of ticks
+    Mark *marks;                    // Changes between the ticks, in order
+    guint mark_count;               // Number of changes
+} Replay;
+
+// Recorder of a replay.
+typedef struct Recorder
+{
+    FILE *file;                     // Output file (NULL if not recording)
+    guint keys;                     // Keys of the current run
+    guint count;                    // Number of ticks of the current run
+    guint remote_keys;              // Key bits of the paddles moved by the keys
+} Recorder;
+
+// Playback of a replay: plays its ticks and its changes on a simulation.
+typedef struct Playback
+{
+    const Replay *replay;           // Replay
+    Config config;                  // Current tunables (with the network and the script of the replay)
+    guint tick;                     // Next tick
+    guint mark;                     // Next change
+    gboolean broken;                // A snapshot does not fit the simulation of the tunables
+} Playback;
+
+// Loads a replay from a file.
+// (Returns FALSE if the file cannot be read, is not a replay or is longer than the largest one.)
+gboolean replay_load(Replay *replay, const gchar *path);
+
+// Frees a replay.
+void replay_free(Replay *replay);
+
+// Starts recording a replay of a simulation to a file.
+// (The simulation runs with the tunables. Returns FALSE if the file cannot be created.)
+gboolean recorder_open(Recorder *recorder, const gchar *path, const Config *config, const Sim *sim);
+
+// Records the keys of one tick.
+void recorder_add(Recorder *recorder, guint keys);
+
+// Records a state of the simulation set from outside its ticks.
+void recorder_snapshot(Recorder *recorder, const Sim *sim);
+
+// Records the paddles moved by the keys whatever their controllers (by their bots) for the next ticks.
+// (Nothing is written if they have not changed.)
+void recorder_remote(Recorder *recorder, guint remote_keys);
+
+// Records a reload of the tunables.
+// (The changes it makes to the simulation are recorded by a snapshot.)
+void recorder_config(Recorder *recorder, const Config *config);
+
+// Stops recording and closes the file.
+void recorder_close(Recorder *recorder);
+
+// Initializes a simulation with the tunables of a replay to play it.
+// (The network and the script, if needed, are taken from the tunables of the replay: the caller sets them.)
+void playback_start(Playback *playback, const Replay *replay, Sim *sim);
+
+// Plays the next tick of a replay, after the changes that come before it.
+// (Returns FALSE at the end of the replay, or if it is broken.)
+gboolean playback_step(Playback *playback, Sim *sim);
+
+#endif
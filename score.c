@@ -0,0 +1,15 @@
+#include "score.h"
+
+// Texts of the scores from 0 to SCORE_MAX.
+static gchar score_texts[SCORE_MAX + 1][4];
+
+void score_init(void)
+{
+    for (guint score = 0; score <= SCORE_MAX; score++)
+        g_snprintf(score_texts[score], sizeof(score_texts[score]), "%u", score);
+}
+
+const gchar *score_text(guint score)
+{
+    return score_texts[MIN(score, SCORE_MAX)];
+}
@@ -0,0 +1,15 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <glib.h>
+
+#define SCORE_MAX 999               // Largest score that can be displayed
+
+// Formats the texts of all the scores once.
+void score_init(void);
+
+// Gets the text of a score (scores above SCORE_MAX are displayed as SCORE_MAX).
+// (The text is preformatted: getting it never allocates.)
+const gchar *score_text(guint score);
+
+#endif
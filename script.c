@@ -0,0 +1,491 @@
+#include "script.h"
+
+#include <string.h>
+
+// Operation of an instruction.
+// (The second operand of the operations is a register plus an immediate: see 'Instruction'.)
+typedef enum Op
+{
+    OP_ADD,                         // a = b + value
+    OP_SUB,                         // a = b - value
+    OP_MUL,                         // a = b * value
+    OP_DIV,                         // a = b / value (0 if the value is 0)
+    OP_MOD,                         // a = b % value (0 if the value is 0)
+    OP_AND,                         // a = b & value
+    OP_OR,                          // a = b | value
+    OP_XOR,                         // a = b ^ value
+    OP_SHL,                         // a = b << value
+    OP_SHR,                         // a = b >> value (keeps the sign)
+    OP_MIN,                         // a = min(b, value)
+    OP_MAX,                         // a = max(b, value)
+    OP_ABS,                         // a = |value|
+    OP_IN,                          // a = input number imm
+    OP_JMP,                         // Jumps to the target
+    OP_JEQ,                         // Jumps to the target if a == value
+    OP_JNE,                         // Jumps to the target if a != value
+    OP_JLT,                         // Jumps to the target if a < value
+    OP_JLE,                         // Jumps to the target if a <= value
+    OP_JGT,                         // Jumps to the target if a > value
+    OP_JGE,                         // Jumps to the target if a >= value
+    OP_MOVE,                        // Moves the paddle by the sign of the value and stops
+} Op;
+
+// Instruction of a script.
+typedef struct Instruction
+{
+    guint8 op;                      // Operation
+    guint8 a;                       // Register written, or compared by a jump
+    guint8 b;                       // Register of the first operand
+    guint8 c;                       // Register of the second operand
+    gint32 imm;                     // Immediate added to the second operand (the input of 'in')
+    guint32 target;                 // Instruction a jump goes to
+} Instruction;
+
+struct Script
+{
+    guint length;                   // Number of instructions (without the final 'stay')
+    Instruction *code;              // Instructions, followed by a 'stay'
+};
+
+// Form of the operands of an instruction in the source.
+typedef enum Form
+{
+    FORM_BINARY,                    // rd, rs, value
+    FORM_UNARY,                     // rd, value
+    FORM_INPUT,                     // rd, input
+    FORM_JUMP,                      // label
+    FORM_BRANCH,                    // rs, value, label
+    FORM_MOVE,                      // value
+    FORM_FIXED,                     // (nothing: moves by a fixed value)
+} Form;
+
+// Instruction of the language of the scripts.
+typedef struct Mnemonic
+{
+    const gchar *name;              // Name in the source
+    Op op;                          // Operation it is assembled to
+    Form form;                      // Form of its operands
+    gint32 imm;                     // Immediate of the fixed moves
+} Mnemonic;
+
+// Language of the scripts: one instruction per line, with optional labels ("name:") and
+// comments (from ';' or '#'). A value is a register (r0 to r15, r0 always zero), an integer,
+// or a register plus or minus an integer. Running off the last line is a 'stay'.
+// (The arithmetic is on 32 bits and wraps around; the shifts take the low 5 bits of their count.
+// 'mov' and 'neg' are additions to and subtractions from r0.)
+static const Mnemonic mnemonics[] =
+        {
+                { "add", OP_ADD, FORM_BINARY },
+                { "sub", OP_SUB, FORM_BINARY },
+                { "mul", OP_MUL, FORM_BINARY },
+                { "div", OP_DIV, FORM_BINARY },
+                { "mod", OP_MOD, FORM_BINARY },
+                { "and", OP_AND, FORM_BINARY },
+                { "or", OP_OR, FORM_BINARY },
+                { "xor", OP_XOR, FORM_BINARY },
+                { "shl", OP_SHL, FORM_BINARY },
+                { "shr", OP_SHR, FORM_BINARY },
+                { "min", OP_MIN, FORM_BINARY },
+                { "max", OP_MAX, FORM_BINARY },
+                { "mov", OP_ADD, FORM_UNARY },
+                { "neg", OP_SUB, FORM_UNARY },
+                { "abs", OP_ABS, FORM_UNARY },
+                { "in", OP_IN, FORM_INPUT },
+                { "jmp", OP_JMP, FORM_JUMP },
+                { "jeq", OP_JEQ, FORM_BRANCH },
+                { "jne", OP_JNE, FORM_BRANCH },
+                { "jlt", OP_JLT, FORM_BRANCH },
+                { "jle", OP_JLE, FORM_BRANCH },
+                { "jgt", OP_JGT, FORM_BRANCH },
+                { "jge", OP_JGE, FORM_BRANCH },
+                { "move", OP_MOVE, FORM_MOVE },
+                { "up", OP_MOVE, FORM_FIXED, -1 },
+                { "down", OP_MOVE, FORM_FIXED, 1 },
+                { "stay", OP_MOVE, FORM_FIXED, 0 },
+        };
+
+// Number of operands of each form.
+static const guint form_operands[] =
+        {
+                [FORM_BINARY] = 3,
+                [FORM_UNARY] = 2,
+                [FORM_INPUT] = 2,
+                [FORM_JUMP] = 1,
+                [FORM_BRANCH] = 3,
+                [FORM_MOVE] = 1,
+                [FORM_FIXED] = 0,
+        };
+
+// Names of the inputs in the source, in the order of 'ScriptInput'.
+static const gchar *input_names[SCRIPT_INPUTS] =
+        {
+                "disc_along", "disc_distance", "disc_step_along", "disc_step_towards", "disc_size",
+                "paddle_along", "paddle_length", "paddle_step", "arena_length", "arena_depth", "score", "tick",
+        };
+
+// Label of the source.
+typedef struct Label
+{
+    const gchar *name;              // Name (in the lines of the source)
+    guint index;                    // Instruction that follows it
+} Label;
+
+// State of the assembly of a source.
+typedef struct Assembler
+{
+    const gchar *name;              // Name of the source (for the errors)
+    guint line;                     // Line being assembled (from 1)
+    Label *labels;                  // Labels found
+    guint label_count;              // Number of labels
+    GError **error;                 // Error of the assembly
+} Assembler;
+
+// Reports an error on the current line.
+// (Returns FALSE.)
+static gboolean syntax_error(Assembler *assembler, const gchar *message, const gchar *text)
+{
+    g_set_error(assembler->error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s:%u: %s: %s",
+                assembler->name, assembler->line, message, text);
+    return FALSE;
+}
+
+// Gets whether a text is a name (a letter or '_', then letters, digits or '_').
+static gboolean is_name(const gchar *text)
+{
+    if (!g_ascii_isalpha(*text) && *text != '_')
+        return FALSE;
+
+    for (; *text != '\0'; text++)
+    {
+        if (!g_ascii_isalnum(*text) && *text != '_')
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Parses an integer of 32 bits (decimal, or hexadecimal with 0x).
+static gboolean parse_integer(const gchar *text, gint32 *value)
+{
+    const gchar *digits = text + (*text == '-' || *text == '+');
+    guint base = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X') ? 16 : 10;
+    gchar *end;
+    gint64 parsed = g_ascii_strtoll(text, &end, base);
+
+    if (*text == '\0' || *end != '\0' || parsed < G_MININT32 || parsed > G_MAXINT32)
+        return FALSE;
+
+    *value = (gint32) parsed;
+    return TRUE;
+}
+
+// Parses a register (r0 to r15), followed by the rest of the text.
+static gboolean parse_register_prefix(const gchar *text, guint8 *reg, const gchar **rest)
+{
+    if (text[0] != 'r' || !g_ascii_isdigit(text[1]))
+        return FALSE;
+
+    guint number = 0;
+    for (text++; g_ascii_isdigit(*text) && number < SCRIPT_REGISTERS; text++)
+        number = number * 10 + (*text - '0');
+
+    if (number >= SCRIPT_REGISTERS)
+        return FALSE;
+
+    *reg = number;
+    *rest = text;
+    return TRUE;
+}
+
+// Parses a register operand.
+static gboolean parse_register(Assembler *assembler, const gchar *text, guint8 *reg)
+{
+    const gchar *rest;
+    if (!parse_register_prefix(text, reg, &rest) || *rest != '\0')
+        return syntax_error(assembler, "not a register", text);
+    return TRUE;
+}
+
+// Parses a register that is written.
+static gboolean parse_destination(Assembler *assembler, const gchar *text, guint8 *reg)
+{
+    if (!parse_register(assembler, text, reg))
+        return FALSE;
+    if (*reg == 0)
+        return syntax_error(assembler, "r0 cannot be written", text);
+    return TRUE;
+}
+
+// Parses a value operand: a register, an integer, or a register plus or minus an integer.
+static gboolean parse_value(Assembler *assembler, const gchar *text, guint8 *reg, gint32 *imm)
+{
+    const gchar *rest;
+    *reg = 0;
+    *imm = 0;
+
+    if (!parse_register_prefix(text, reg, &rest))
+        rest = text;
+    else if (*rest == '\0')
+        return TRUE;
+    else if (*rest != '+' && *rest != '-')
+        return syntax_error(assembler, "not a value", text);
+
+    // (The sign of a register offset is kept: "r1-4" is r1 plus -4.)
+    if (!parse_integer(*rest == '+' && rest != text ? rest + 1 : rest, imm))
+        return syntax_error(assembler, "not a value", text);
+    return TRUE;
+}
+
+// Parses the name of an input.
+static gboolean parse_input(Assembler *assembler, const gchar *text, gint32 *input)
+{
+    for (guint i = 0; i < SCRIPT_INPUTS; i++)
+    {
+        if (strcmp(text, input_names[i]) == 0)
+        {
+            *input = i;
+            return TRUE;
+        }
+    }
+    return syntax_error(assembler, "unknown input", text);
+}
+
+// Parses a label operand.
+static gboolean parse_label(Assembler *assembler, const gchar *text, guint32 *target)
+{
+    for (guint i = 0; i < assembler->label_count; i++)
+    {
+        if (strcmp(text, assembler->labels[i].name) == 0)
+        {
+            *target = assembler->labels[i].index;
+            return TRUE;
+        }
+    }
+    return syntax_error(assembler, "unknown label", text);
+}
+
+// Assembles the instruction of a line (without its label and comment).
+static gboolean assemble_line(Assembler *assembler, gchar *text, Instruction *instruction)
+{
+    // Splits the name from the operands.
+    gchar *operands_text = text + strcspn(text, " \t");
+    if (*operands_text != '\0')
+        *operands_text++ = '\0';
+
+    const Mnemonic *mnemonic = NULL;
+    for (guint i = 0; i < G_N_ELEMENTS(mnemonics); i++)
+    {
+        if (strcmp(text, mnemonics[i].name) == 0)
+            mnemonic = &mnemonics[i];
+    }
+    if (mnemonic == NULL)
+        return syntax_error(assembler, "unknown instruction", text);
+
+    gchar **operands = g_strsplit(g_strstrip(operands_text), ",", -1);
+    guint count = g_strv_length(operands);
+    for (guint i = 0; i < count; i++)
+        g_strstrip(operands[i]);
+    if (count == 1 && operands[0][0] == '\0')
+        count = 0;
+
+    *instruction = (Instruction) { .op = mnemonic->op, .imm = mnemonic->imm };
+    gboolean ok;
+    if (count != form_operands[mnemonic->form])
+        ok = syntax_error(assembler, "wrong number of operands", mnemonic->name);
+    else
+    {
+        switch (mnemonic->form)
+        {
+            case FORM_BINARY:
+                ok = parse_destination(assembler, operands[0], &instruction->a)
+                     && parse_register(assembler, operands[1], &instruction->b)
+                     && parse_value(assembler, operands[2], &instruction->c, &instruction->imm);
+                break;
+
+            case FORM_UNARY:
+                ok = parse_destination(assembler, operands[0], &instruction->a)
+                     && parse_value(assembler, operands[1], &instruction->c, &instruction->imm);
+                break;
+
+            case FORM_INPUT:
+                ok = parse_destination(assembler, operands[0], &instruction->a)
+                     && parse_input(assembler, operands[1], &instruction->imm);
+                break;
+
+            case FORM_JUMP:
+                ok = parse_label(assembler, operands[0], &instruction->target);
+                break;
+
+            case FORM_BRANCH:
+                ok = parse_register(assembler, operands[0], &instruction->a)
+                     && parse_value(assembler, operands[1], &instruction->c, &instruction->imm)
+                     && parse_label(assembler, operands[2], &instruction->target);
+                break;
+
+            case FORM_MOVE:
+                ok = parse_value(assembler, operands[0], &instruction->c, &instruction->imm);
+                break;
+
+            default:
+                ok = TRUE;
+                break;
+        }
+    }
+
+    g_strfreev(operands);
+    return ok;
+}
+
+Script *script_assemble(const gchar *source, const gchar *name, GError **error)
+{
+    gchar **lines = g_strsplit(source, "\n", -1);
+    guint line_count = g_strv_length(lines);
+    gchar **texts = g_new(gchar*, line_count);
+    Assembler assembler = { .name = name, .labels = g_new(Label, line_count), .error = error };
+    guint length = 0;
+    gboolean ok = TRUE;
+
+    // Strips the comments, finds the labels and counts the instructions.
+    // (The labels and the texts of the instructions point into the lines.)
+    for (guint i = 0; ok && i < line_count; i++)
+    {
+        gchar *text = lines[i];
+        assembler.line = i + 1;
+        text[strcspn(text, ";#")] = '\0';
+
+        gchar *colon = strchr(text, ':');
+        if (colon != NULL)
+        {
+            *colon = '\0';
+            const gchar *label = g_strstrip(text);
+            for (guint j = 0; ok && j < assembler.label_count; j++)
+                ok = strcmp(label, assembler.labels[j].name) != 0 || syntax_error(&assembler, "label defined twice", label);
+            if (ok && !is_name(label))
+                ok = syntax_error(&assembler, "not a label", label);
+
+            assembler.labels[assembler.label_count++] = (Label) { label, length };
+            text = colon + 1;
+        }
+
+        texts[i] = g_strstrip(text);
+        if (ok && *texts[i] != '\0')
+        {
+            if (length == SCRIPT_MAX_LENGTH)
+                ok = syntax_error(&assembler, "too many instructions", texts[i]);
+            length++;
+        }
+    }
+
+    // Assembles the instructions, followed by a 'stay'.
+    Instruction *code = g_new0(Instruction, length + 1);
+    for (guint i = 0, index = 0; ok && i < line_count; i++)
+    {
+        assembler.line = i + 1;
+        if (*texts[i] != '\0')
+            ok = assemble_line(&assembler, texts[i], &code[index++]);
+    }
+    code[length] = (Instruction) { .op = OP_MOVE };
+
+    g_free(assembler.labels);
+    g_free(texts);
+    g_strfreev(lines);
+
+    if (!ok)
+    {
+        g_free(code);
+        return NULL;
+    }
+
+    Script *script = g_new(Script, 1);
+    *script = (Script) { length, code };
+    return script;
+}
+
+Script *script_load(const gchar *path, GError **error)
+{
+    gchar *source;
+    if (!g_file_get_contents(path, &source, NULL, error))
+        return NULL;
+
+    Script *script = script_assemble(source, path, error);
+    g_free(source);
+    return script;
+}
+
+void script_free(Script *script)
+{
+    if (script == NULL)
+        return;
+
+    g_free(script->code);
+    g_free(script);
+}
+
+gboolean script_run(const Script *script, const gint inputs[SCRIPT_INPUTS], guint budget, gint *direction)
+{
+    // Code of each operation: each one jumps straight to the code of the next instruction
+    // (computed goto), rather than back to a switch, and counts it against the budget.
+    static const void *const operations[] =
+            {
+                    [OP_ADD] = &&op_add, [OP_SUB] = &&op_sub, [OP_MUL] = &&op_mul, [OP_DIV] = &&op_div,
+                    [OP_MOD] = &&op_mod, [OP_AND] = &&op_and, [OP_OR] = &&op_or, [OP_XOR] = &&op_xor,
+                    [OP_SHL] = &&op_shl, [OP_SHR] = &&op_shr, [OP_MIN] = &&op_min, [OP_MAX] = &&op_max,
+                    [OP_ABS] = &&op_abs, [OP_IN] = &&op_in, [OP_JMP] = &&op_jmp, [OP_JEQ] = &&op_jeq,
+                    [OP_JNE] = &&op_jne, [OP_JLT] = &&op_jlt, [OP_JLE] = &&op_jle, [OP_JGT] = &&op_jgt,
+                    [OP_JGE] = &&op_jge, [OP_MOVE] = &&op_move,
+            };
+
+    // The registers wrap around on overflow (unsigned), and are compared signed.
+    guint32 r[SCRIPT_REGISTERS] = { 0 };
+    const Instruction *code = script->code;
+    const Instruction *pc = code;
+
+#define VALUE (r[pc->c] + (guint32) pc->imm)
+#define SIGNED(x) ((gint32) (x))
+#define DISPATCH() do { if (budget-- == 0) return FALSE; goto *operations[pc->op]; } while (0)
+#define NEXT() do { pc++; DISPATCH(); } while (0)
+#define BRANCH(condition) do { pc = (condition) ? code + pc->target : pc + 1; DISPATCH(); } while (0)
+
+    DISPATCH();
+
+op_add: r[pc->a] = r[pc->b] + VALUE; NEXT();
+op_sub: r[pc->a] = r[pc->b] - VALUE; NEXT();
+op_mul: r[pc->a] = r[pc->b] * VALUE; NEXT();
+op_div:
+    {
+        // (The quotient of the smallest integer by -1 wraps around as a negation.)
+        gint32 value = SIGNED(VALUE);
+        r[pc->a] = value == 0 ? 0 : value == -1 ? 0u - r[pc->b] : (guint32) (SIGNED(r[pc->b]) / value);
+        NEXT();
+    }
+op_mod:
+    {
+        gint32 value = SIGNED(VALUE);
+        r[pc->a] = value == 0 || value == -1 ? 0 : (guint32) (SIGNED(r[pc->b]) % value);
+        NEXT();
+    }
+op_and: r[pc->a] = r[pc->b] & VALUE; NEXT();
+op_or: r[pc->a] = r[pc->b] | VALUE; NEXT();
+op_xor: r[pc->a] = r[pc->b] ^ VALUE; NEXT();
+op_shl: r[pc->a] = r[pc->b] << (VALUE & 31); NEXT();
+op_shr: r[pc->a] = (guint32) (SIGNED(r[pc->b]) >> (VALUE & 31)); NEXT();
+op_min: r[pc->a] = MIN(SIGNED(r[pc->b]), SIGNED(VALUE)); NEXT();
+op_max: r[pc->a] = MAX(SIGNED(r[pc->b]), SIGNED(VALUE)); NEXT();
+op_abs: r[pc->a] = SIGNED(VALUE) < 0 ? 0u - VALUE : VALUE; NEXT();
+op_in: r[pc->a] = (guint32) inputs[pc->imm]; NEXT();
+op_jmp: pc = code + pc->target; DISPATCH();
+op_jeq: BRANCH(r[pc->a] == VALUE);
+op_jne: BRANCH(r[pc->a] != VALUE);
+op_jlt: BRANCH(SIGNED(r[pc->a]) < SIGNED(VALUE));
+op_jle: BRANCH(SIGNED(r[pc->a]) <= SIGNED(VALUE));
+op_jgt: BRANCH(SIGNED(r[pc->a]) > SIGNED(VALUE));
+op_jge: BRANCH(SIGNED(r[pc->a]) >= SIGNED(VALUE));
+op_move:
+    *direction = (SIGNED(VALUE) > 0) - (SIGNED(VALUE) < 0);
+    return TRUE;
+
+#undef VALUE
+#undef SIGNED
+#undef DISPATCH
+#undef NEXT
+#undef BRANCH
+}
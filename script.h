@@ -0,0 +1,47 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <glib.h>
+
+#define SCRIPT_REGISTERS 16         // Number of registers of a script (r0 is always zero)
+#define SCRIPT_MAX_LENGTH 4096      // Largest number of instructions of a script
+
+// Inputs of a script: the state seen by its paddle, along and across its wall.
+// (Along the wall is from its top or left end; the steps are in fixed-point pixels per tick.)
+typedef enum ScriptInput
+{
+    INPUT_DISC_ALONG,               // Centre of the disc along the wall in pixels ('disc_along')
+    INPUT_DISC_DISTANCE,            // Distance from the front of the paddle to the disc in pixels ('disc_distance')
+    INPUT_DISC_STEP_ALONG,          // Step of the disc along the wall ('disc_step_along')
+    INPUT_DISC_STEP_TOWARDS,        // Step of the disc towards the paddle, negative away from it ('disc_step_towards')
+    INPUT_DISC_SIZE,                // Size of the disc along the wall in pixels ('disc_size')
+    INPUT_PADDLE_ALONG,             // Centre of the paddle along the wall in pixels ('paddle_along')
+    INPUT_PADDLE_LENGTH,            // Length of the paddle along the wall in pixels ('paddle_length')
+    INPUT_PADDLE_STEP,              // Largest move of the paddle in a tick in pixels, rounded up ('paddle_step')
+    INPUT_ARENA_LENGTH,             // Length of the wall in pixels ('arena_length')
+    INPUT_ARENA_DEPTH,              // Distance to the opposite wall in pixels ('arena_depth')
+    INPUT_SCORE,                    // Score of the player ('score')
+    INPUT_TICK,                     // Number of ticks since the start ('tick')
+    SCRIPT_INPUTS,                  // Number of inputs
+} ScriptInput;
+
+// Bot program assembled from a script (see script.c for its language).
+typedef struct Script Script;
+
+// Loads and assembles a script file.
+// (Returns NULL on error; the error gives the line of the script.)
+Script *script_load(const gchar *path, GError **error);
+
+// Assembles the source of a script (named in the errors).
+// (Returns NULL on error.)
+Script *script_assemble(const gchar *source, const gchar *name, GError **error);
+
+// Frees a script.
+void script_free(Script *script);
+
+// Runs a script on the inputs of a paddle and gets its move (-1 upwards or leftwards, 0 still,
+// 1 downwards or rightwards).
+// (Returns FALSE if the script runs more instructions than its budget: it is stopped.)
+gboolean script_run(const Script *script, const gint inputs[SCRIPT_INPUTS], guint budget, gint *direction);
+
+#endif
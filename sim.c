@@ -0,0 +1,696 @@
+#include "sim.h"
+#include "bricks.h"
+#include "trace.h"
+
+gboolean rect_intersect(const Rect *a, const Rect *b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width
+           && a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+Rect rect_union(const Rect *a, const Rect *b)
+{
+    gint x = MIN(a->x, b->x);
+    gint y = MIN(a->y, b->y);
+
+    return (Rect) { x, y, MAX(a->x + a->width, b->x + b->width) - x,
+                    MAX(a->y + a->height, b->y + b->height) - y };
+}
+
+// Appends an event to the queue.
+static void sim_emit(Sim *sim, EventType type, gint value)
+{
+    EventQueue *queue = &sim->events;
+
+    if (queue->tail - queue->head == SIM_EVENTS)
+    {
+        queue->dropped++;
+        return;
+    }
+
+    queue->events[queue->tail % SIM_EVENTS] = (Event) { type, sim->tick, value };
+    queue->tail++;
+}
+
+gboolean sim_poll_event(Sim *sim, Event *event)
+{
+    EventQueue *queue = &sim->events;
+
+    if (queue->head == queue->tail)
+        return FALSE;
+
+    *event = queue->events[queue->head % SIM_EVENTS];
+    queue->head++;
+    return TRUE;
+}
+
+gboolean sim_has_events(const Sim *sim)
+{
+    return sim->events.head != sim->events.tail;
+}
+
+// Gets the step of a paddle per tick in fixed-point pixels.
+static gint paddle_step(const Config *config)
+{
+    return (gint) ((gint64) config->paddle_step * FIXED_ONE * config->tick_period / config->paddle_period);
+}
+
+// Gets the controller of a paddle from the tunables.
+static Control paddle_control(const Config *config, guint index)
+{
+    return index == 0 ? config->p1_control : index == 1 ? config->p2_control : config->others_control;
+}
+
+// Gets whether a paddle moves horizontally (along the top or bottom wall).
+static gboolean is_horizontal(const Paddle *paddle)
+{
+    return paddle->side == SIDE_TOP || paddle->side == SIDE_BOTTOM;
+}
+
+// Gets the position of a paddle along its wall in fixed-point pixels.
+static gint64 paddle_position(const Paddle *paddle)
+{
+    return (gint64) (is_horizontal(paddle) ? paddle->rect.x : paddle->rect.y) * FIXED_ONE + paddle->fraction;
+}
+
+// Puts a paddle at a position along its wall in fixed-point pixels, inside the arena.
+// (As the disc, it is shown at the integer part of its position.)
+static void place_paddle(const Sim *sim, Paddle *paddle, gint64 position)
+{
+    gint length = is_horizontal(paddle) ? paddle->rect.width : paddle->rect.height;
+    gint arena = is_horizontal(paddle) ? sim->width : sim->height;
+    position = CLAMP(position, 0, (gint64) MAX(arena - length, 0) * FIXED_ONE);
+
+    if (is_horizontal(paddle))
+        paddle->rect.x = (gint) (position >> FIXED_SHIFT);
+    else
+        paddle->rect.y = (gint) (position >> FIXED_SHIFT);
+    paddle->fraction = (gint) (position & (FIXED_ONE - 1));
+}
+
+// Sets the size, the step and the controller of a paddle from the tunables.
+// (The height of the tunables is the length of the paddle along its wall.)
+static void configure_paddle(Paddle *paddle, const Config *config, guint index)
+{
+    gboolean horizontal = is_horizontal(paddle);
+
+    paddle->rect.width = horizontal ? config->paddle_height : config->paddle_width;
+    paddle->rect.height = horizontal ? config->paddle_width : config->paddle_height;
+    paddle->step = paddle_step(config);
+    paddle->control = paddle_control(config, index);
+    paddle->model = config->model;
+    paddle->script = config->script;
+}
+
+void sim_init(Sim *sim, const Config *config)
+{
+    gint disc_step = (gint) (config->disc_speed * FIXED_ONE);
+
+    *sim = (Sim)
+            {
+                    .state = STOP,
+                    .width = config->width,
+                    .height = config->height,
+                    .paddle_count = config->lineup.count,
+
+                    .disc =
+                            {
+                                    .rect = { 100, 100, config->disc_size, config->disc_size },
+                                    .position = { 100 * FIXED_ONE, 100 * FIXED_ONE },
+                                    .step = { disc_step, disc_step },
+                            },
+
+                    .bricks = bricks_new(config),
+                    .script_budget = config->script_budget,
+                    .scale = FIXED_ONE,
+                    .end_game_score = config->end_game_score,
+
+                    // Xorshift never leaves zero, so the seed is forced to be odd.
+                    .rng = (guint32) config->seed | 1,
+            };
+
+    // Only the first paddles can be moved by the keys.
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        Paddle *paddle = &sim->paddles[i];
+        paddle->side = config->lineup.sides[i];
+        paddle->up = i < KEY_PADDLES ? KEY_UP(i) : 0;
+        paddle->down = i < KEY_PADDLES ? KEY_DOWN(i) : 0;
+        configure_paddle(paddle, config, i);
+    }
+
+    sim_resize(sim, config->width, config->height);
+}
+
+void sim_free(Sim *sim)
+{
+    bricks_free(sim->bricks);
+    sim->bricks = NULL;
+}
+
+void sim_apply_config(Sim *sim, const Config *config)
+{
+    gint disc_step = (gint) (config->disc_speed * FIXED_ONE);
+
+    for (guint i = 0; i < sim->paddle_count; i++)
+        configure_paddle(&sim->paddles[i], config, i);
+    sim->script_budget = config->script_budget;
+
+    // Keeps the direction of the disc.
+    sim->disc.rect.width = config->disc_size;
+    sim->disc.rect.height = config->disc_size;
+    sim->disc.step.x = sim->disc.step.x < 0 ? -disc_step : disc_step;
+    sim->disc.step.y = sim->disc.step.y < 0 ? -disc_step : disc_step;
+
+    sim->end_game_score = config->end_game_score;
+
+    sim_resize(sim, sim->width, sim->height);
+}
+
+void sim_resize(Sim *sim, gint width, gint height)
+{
+    sim->width = width;
+    sim->height = height;
+
+    // Counts the paddles of each side.
+    guint counts[SIDE_BOTTOM + 1] = { 0 };
+    guint ranks[SIDE_BOTTOM + 1] = { 0 };
+    for (guint i = 0; i < sim->paddle_count; i++)
+        counts[sim->paddles[i].side]++;
+
+    // Puts the paddles of a side at even distances from their wall, up to the middle of the arena.
+    // (The paddles are also kept inside a smaller arena.)
+    sim->goal_walls = 0;
+    sim->substep = DISC_SUBSTEP;
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        Paddle *paddle = &sim->paddles[i];
+        Rect *rect = &paddle->rect;
+        guint rank = ranks[paddle->side]++;
+        gint depth = is_horizontal(paddle) ? height : width;
+        gint offset = (gint) (rank * depth / (2 * counts[paddle->side]));
+
+        switch (paddle->side)
+        {
+            case SIDE_LEFT:
+                rect->x = offset;
+                break;
+
+            case SIDE_RIGHT:
+                rect->x = width - rect->width - offset;
+                break;
+
+            case SIDE_TOP:
+                rect->y = offset;
+                break;
+
+            case SIDE_BOTTOM:
+                rect->y = height - rect->height - offset;
+                break;
+        }
+
+        place_paddle(sim, paddle, paddle_position(paddle));
+
+        // A disc clamped against a wall always meets the paddle of the wall,
+        // but a longer substep could go through a paddle in front of it.
+        sim->goal_walls |= 1u << paddle->side;
+        if (offset > 0)
+        {
+            gint thickness = is_horizontal(paddle) ? rect->height + sim->disc.rect.height
+                                                   : rect->width + sim->disc.rect.width;
+            sim->substep = MAX(MIN(sim->substep, thickness - 1), 1);
+        }
+    }
+
+    if (sim->bricks != NULL)
+        bricks_layout(sim->bricks, width, height);
+
+    // Adjust the position of the disc based on the new dimensions.
+    gint x_max = MAX(width - sim->disc.rect.width, 0);
+    gint y_max = MAX(height - sim->disc.rect.height, 0);
+    sim->disc.rect.x = CLAMP(sim->disc.rect.x, 0, x_max);
+    sim->disc.rect.y = CLAMP(sim->disc.rect.y, 0, y_max);
+    sim->disc.position.x = MIN(sim->disc.position.x, x_max * FIXED_ONE);
+    sim->disc.position.y = MIN(sim->disc.position.y, y_max * FIXED_ONE);
+}
+
+void sim_set_state(Sim *sim, State state)
+{
+    static const gchar *names[] = { "set_stop", "set_play", "set_pause" };
+
+    if (sim->state == state)
+        return;
+
+    TRACE_INSTANT(names[state]);
+
+    //Reset the scores
+    if (state == STOP || sim->state == STOP)
+    {
+        for (guint i = 0; i < sim->paddle_count; i++)
+            sim->paddles[i].score = 0;
+
+        if (sim->bricks != NULL)
+            bricks_reset(sim->bricks);
+    }
+
+    sim->state = state;
+    sim_emit(sim, EVENT_STATE, state);
+}
+
+// Scales a fixed-point step by the time scale and divides it into substeps.
+static gint scale_step(gint step, gint scale, gint substeps)
+{
+    return (gint) ((gint64) step * scale / ((gint64) substeps << FIXED_SHIFT));
+}
+
+// Moves a paddle by one step in a direction (-1 upwards or leftwards, 1 downwards or rightwards, 0 still).
+static void move_paddle(Sim *sim, Paddle *paddle, gint direction)
+{
+    gint step = scale_step(paddle->step, sim->scale, 1);
+    place_paddle(sim, paddle, paddle_position(paddle) + direction * step);
+}
+
+// Moves a paddle so that it follows the disc.
+static void follow_rectangle(Sim *sim, Paddle *paddle)
+{
+    gint position = is_horizontal(paddle)
+                    ? sim->disc.rect.x - paddle->rect.width / 2
+                    : sim->disc.rect.y - paddle->rect.height / 2;
+    place_paddle(sim, paddle, (gint64) position * FIXED_ONE);
+}
+
+// Gets the largest move of a paddle in a tick in whole pixels.
+static gint paddle_pixels(const Sim *sim, const Paddle *paddle)
+{
+    return (scale_step(paddle->step, sim->scale, 1) + FIXED_ONE - 1) >> FIXED_SHIFT;
+}
+
+// Gets the next number of the random number generator.
+static guint32 sim_random(Sim *sim)
+{
+    guint32 x = sim->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return sim->rng = x;
+}
+
+// Moves a paddle towards the disc at its own speed, with random aiming errors.
+static void follow_noisy(Sim *sim, Paddle *paddle)
+{
+    // Waits for the match to be played (the paddle would wander otherwise).
+    if (sim->state != PLAY)
+        return;
+
+    gint error = (gint) (sim_random(sim) % 257) - 128;
+    gint delta = is_horizontal(paddle)
+                 ? sim->disc.rect.x + error - (paddle->rect.x + paddle->rect.width / 2)
+                 : sim->disc.rect.y + error - (paddle->rect.y + paddle->rect.height / 2);
+
+    // Stays still near the target, so that the paddle does not jitter.
+    move_paddle(sim, paddle, delta > 10 ? 1 : delta < -10 ? -1 : 0);
+}
+
+// Gets the move of a paddle towards a position along its wall (-1, 0 or 1).
+// (Stays still within a step of it, so that the paddle does not jitter.)
+static gint steer(const Sim *sim, const Paddle *paddle, gint target)
+{
+    gint step = MAX(paddle_pixels(sim, paddle), 1);
+    gint delta = is_horizontal(paddle)
+                 ? target - (paddle->rect.x + paddle->rect.width / 2)
+                 : target - (paddle->rect.y + paddle->rect.height / 2);
+
+    return delta >= step ? 1 : delta <= -step ? -1 : 0;
+}
+
+// Gets where the centre of the disc will cross the front of a paddle, along its wall.
+// (Follows the disc tick by tick, bouncing on the walls along the paddle; the other
+// paddles and the bricks are ignored. Returns -1 if the disc moves away from the paddle
+// or does not reach it within PREDICT_TICKS ticks.)
+static gint predict_disc(const Sim *sim, const Paddle *paddle)
+{
+    const Disc *disc = &sim->disc;
+    gboolean horizontal = is_horizontal(paddle);
+    gboolean far = paddle->side == SIDE_RIGHT || paddle->side == SIDE_BOTTOM;
+
+    // Works in the coordinates across and along the wall of the paddle.
+    gint across = horizontal ? disc->position.y : disc->position.x;
+    gint along = horizontal ? disc->position.x : disc->position.y;
+    gint across_step = scale_step(horizontal ? disc->step.y : disc->step.x, sim->scale, 1);
+    gint along_step = scale_step(horizontal ? disc->step.x : disc->step.y, sim->scale, 1);
+    gint size = horizontal ? disc->rect.width : disc->rect.height;
+    gint along_max = ((horizontal ? sim->width : sim->height) - size) * FIXED_ONE;
+    gint front = horizontal
+                 ? (far ? paddle->rect.y - disc->rect.height : paddle->rect.y + paddle->rect.height)
+                 : (far ? paddle->rect.x - disc->rect.width : paddle->rect.x + paddle->rect.width);
+    front *= FIXED_ONE;
+
+    if (far ? across_step <= 0 : across_step >= 0)
+        return -1;
+
+    for (guint tick = 0; tick < PREDICT_TICKS; tick++)
+    {
+        if (far ? across >= front : across <= front)
+            return (along >> FIXED_SHIFT) + size / 2;
+
+        across += across_step;
+        along += along_step;
+        if (along <= 0 || along >= along_max)
+        {
+            along = CLAMP(along, 0, along_max);
+            along_step = -along_step;
+        }
+    }
+
+    return -1;
+}
+
+gint sim_decide(const Sim *sim, const Paddle *paddle)
+{
+    // Waits for the match to be played (the paddle would wander otherwise).
+    if (sim->state != PLAY)
+        return 0;
+
+    // Waits in the middle of the wall while the disc moves away.
+    gint target = predict_disc(sim, paddle);
+    if (target < 0)
+        target = (is_horizontal(paddle) ? sim->width : sim->height) / 2;
+
+    return steer(sim, paddle, target);
+}
+
+void sim_observe(const Sim *sim, const Paddle *paddle, gfloat observation[MLP_OBSERVATIONS])
+{
+    const Disc *disc = &sim->disc;
+    gboolean horizontal = is_horizontal(paddle);
+    gboolean far = paddle->side == SIDE_RIGHT || paddle->side == SIDE_BOTTOM;
+
+    // Works in the coordinates across and along the wall of the paddle.
+    gfloat length = horizontal ? sim->width : sim->height;
+    gfloat depth = horizontal ? sim->height : sim->width;
+    gfloat disc_along = horizontal ? disc->rect.x + disc->rect.width / 2 : disc->rect.y + disc->rect.height / 2;
+    gfloat paddle_along = horizontal ? paddle->rect.x + paddle->rect.width / 2 : paddle->rect.y + paddle->rect.height / 2;
+    gfloat distance = horizontal
+                      ? (far ? paddle->rect.y - disc->rect.y - disc->rect.height : disc->rect.y - paddle->rect.y - paddle->rect.height)
+                      : (far ? paddle->rect.x - disc->rect.x - disc->rect.width : disc->rect.x - paddle->rect.x - paddle->rect.width);
+    gfloat speed = MAX(MAX(ABS(disc->step.x), ABS(disc->step.y)), 1);
+    gfloat along_step = horizontal ? disc->step.x : disc->step.y;
+    gfloat across_step = horizontal ? disc->step.y : disc->step.x;
+
+    observation[0] = 2 * disc_along / length - 1;
+    observation[1] = 2 * paddle_along / length - 1;
+    observation[2] = 2 * (disc_along - paddle_along) / length;
+    observation[3] = distance / depth;
+    observation[4] = along_step / speed;
+    observation[5] = (far ? across_step : -across_step) / speed;
+    observation[6] = (horizontal ? disc->rect.width : disc->rect.height) / length;
+    observation[7] = (horizontal ? paddle->rect.width : paddle->rect.height) / length;
+}
+
+// Gets the move of a paddle decided by the network.
+static gint decide_neural(const Sim *sim, const Paddle *paddle)
+{
+    // Waits for the match to be played, as the other controllers.
+    if (sim->state != PLAY || paddle->model == NULL)
+        return 0;
+
+    gfloat observation[MLP_OBSERVATIONS];
+    sim_observe(sim, paddle, observation);
+    return mlp_decide(paddle->model, observation);
+}
+
+// Gets the inputs of the bot of a paddle (see 'ScriptInput').
+static void script_inputs(const Sim *sim, const Paddle *paddle, gint inputs[SCRIPT_INPUTS])
+{
+    const Disc *disc = &sim->disc;
+    gboolean horizontal = is_horizontal(paddle);
+    gboolean far = paddle->side == SIDE_RIGHT || paddle->side == SIDE_BOTTOM;
+    gint across_step = scale_step(horizontal ? disc->step.y : disc->step.x, sim->scale, 1);
+
+    // Works in the coordinates across and along the wall of the paddle.
+    inputs[INPUT_DISC_ALONG] = horizontal ? disc->rect.x + disc->rect.width / 2 : disc->rect.y + disc->rect.height / 2;
+    inputs[INPUT_DISC_DISTANCE] = horizontal
+                                  ? (far ? paddle->rect.y - disc->rect.y - disc->rect.height : disc->rect.y - paddle->rect.y - paddle->rect.height)
+                                  : (far ? paddle->rect.x - disc->rect.x - disc->rect.width : disc->rect.x - paddle->rect.x - paddle->rect.width);
+    inputs[INPUT_DISC_STEP_ALONG] = scale_step(horizontal ? disc->step.x : disc->step.y, sim->scale, 1);
+    inputs[INPUT_DISC_STEP_TOWARDS] = far ? across_step : -across_step;
+    inputs[INPUT_DISC_SIZE] = horizontal ? disc->rect.width : disc->rect.height;
+    inputs[INPUT_PADDLE_ALONG] = horizontal ? paddle->rect.x + paddle->rect.width / 2 : paddle->rect.y + paddle->rect.height / 2;
+    inputs[INPUT_PADDLE_LENGTH] = horizontal ? paddle->rect.width : paddle->rect.height;
+    inputs[INPUT_PADDLE_STEP] = paddle_pixels(sim, paddle);
+    inputs[INPUT_ARENA_LENGTH] = horizontal ? sim->width : sim->height;
+    inputs[INPUT_ARENA_DEPTH] = horizontal ? sim->height : sim->width;
+    inputs[INPUT_SCORE] = paddle->score;
+    inputs[INPUT_TICK] = sim->tick;
+}
+
+// Gets the move of a paddle decided by the bot.
+// (A bot stopped by its budget leaves the paddle still for the tick.)
+static gint decide_script(Sim *sim, const Paddle *paddle)
+{
+    // Waits for the match to be played, as the other controllers.
+    if (sim->state != PLAY || paddle->script == NULL)
+        return 0;
+
+    gint inputs[SCRIPT_INPUTS];
+    gint direction;
+    script_inputs(sim, paddle, inputs);
+    if (script_run(paddle->script, inputs, sim->script_budget, &direction))
+        return direction;
+
+    sim->script_overruns++;
+    return 0;
+}
+
+gint sim_chase(const Sim *sim, const Paddle *paddle)
+{
+    if (sim->state != PLAY)
+        return 0;
+
+    return is_horizontal(paddle)
+           ? steer(sim, paddle, sim->disc.rect.x + sim->disc.rect.width / 2)
+           : steer(sim, paddle, sim->disc.rect.y + sim->disc.rect.height / 2);
+}
+
+void sim_control_paddle(Sim *sim, Paddle *paddle, guint keys)
+{
+    // The paddles decided outside the simulation (e.g. by the bots of duel) are moved by their keys.
+    Control control = (paddle->up & sim->remote_keys) != 0 ? CONTROL_KEYS : paddle->control;
+
+    switch (control)
+    {
+        case CONTROL_KEYS:
+            // Both keys held at once cancel each other out.
+            move_paddle(sim, paddle, ((keys & paddle->down) != 0) - ((keys & paddle->up) != 0));
+            break;
+
+        case CONTROL_FOLLOW:
+            follow_rectangle(sim, paddle);
+            break;
+
+        case CONTROL_NOISY:
+            follow_noisy(sim, paddle);
+            break;
+
+        case CONTROL_PREDICT:
+            move_paddle(sim, paddle, sim_decide(sim, paddle));
+            break;
+
+        case CONTROL_NEURAL:
+            move_paddle(sim, paddle, decide_neural(sim, paddle));
+            break;
+
+        case CONTROL_SCRIPT:
+            move_paddle(sim, paddle, decide_script(sim, paddle));
+            break;
+    }
+}
+
+// Gets the sides whose walls the disc moves towards (a bit per side).
+static guint towards_walls(const Disc *disc)
+{
+    return (disc->step.x < 0) << SIDE_LEFT | (disc->step.x > 0) << SIDE_RIGHT
+           | (disc->step.y < 0) << SIDE_TOP | (disc->step.y > 0) << SIDE_BOTTOM;
+}
+
+// Gets the sides whose walls the disc touches (a bit per side).
+static guint touched_walls(const Disc *disc, gint x_max, gint y_max)
+{
+    return (disc->rect.x == 0) << SIDE_LEFT | (disc->rect.x == x_max) << SIDE_RIGHT
+           | (disc->rect.y == 0) << SIDE_TOP | (disc->rect.y == y_max) << SIDE_BOTTOM;
+}
+
+// Reverses the step of the disc across the wall of a side.
+static void bounce(Disc *disc, Side side)
+{
+    if (side == SIDE_TOP || side == SIDE_BOTTOM)
+        disc->step.y = -disc->step.y;
+    else
+        disc->step.x = -disc->step.x;
+}
+
+// Scores a goal on the wall of a side: each paddle of the side counts it.
+// (With two players, the goals on the left wall are the points of player 1.)
+static void score_goal(Sim *sim, Side side)
+{
+    gboolean over = FALSE;
+
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        Paddle *paddle = &sim->paddles[i];
+        if (paddle->side == side)
+        {
+            paddle->score += 1;
+            over |= paddle->score >= sim->end_game_score;
+        }
+    }
+    sim_emit(sim, EVENT_GOAL, side);
+
+    // Ends the match, keeping the scores shown.
+    if (over)
+    {
+        TRACE_INSTANT("game_over");
+        sim->state = STOP;
+        sim_emit(sim, EVENT_STATE, STOP);
+    }
+    else
+        sim_set_state(sim, PAUSE);
+}
+
+// Makes the disc bounce on the bricks and the paddles it meets after a move from a position.
+// (Sets the sides whose walls the disc then moves towards; returns TRUE if it has bounced.)
+static gboolean collide(Sim *sim, const Rect *from, guint *towards)
+{
+    Disc *disc = &sim->disc;
+    gboolean hit = FALSE;
+
+    // Bounces on the first brick met on the way (and destroys it).
+    // (Before the paddles, which have the last word on a disc sent back against them.)
+    BrickHit brick;
+    if (sim->bricks != NULL && bricks_sweep(sim->bricks, from, &disc->rect, &brick))
+    {
+        if (brick.x)
+            disc->step.x = -disc->step.x;
+        if (brick.y)
+            disc->step.y = -disc->step.y;
+        sim_emit(sim, EVENT_BRICK_HIT, brick.id);
+
+        if (sim->bricks->destructible)
+            bricks_destroy(sim->bricks, brick.id);
+        hit = TRUE;
+    }
+
+    // Bounces only towards the opposite side, so that the disc cannot
+    // reflect again on the following substeps while still inside the paddle.
+    // (Tested before the goals: a disc clamped against a wall across its paddle,
+    // which is thinner than a substep, must still bounce on it. In a corner,
+    // the disc bounces on the paddles of both walls.)
+    *towards = towards_walls(disc);
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        const Paddle *paddle = &sim->paddles[i];
+        if ((*towards & 1u << paddle->side) && rect_intersect(&paddle->rect, &disc->rect))
+        {
+            bounce(disc, paddle->side);
+            sim_emit(sim, EVENT_PADDLE_HIT, i + 1);
+            *towards = towards_walls(disc);
+            hit = TRUE;
+        }
+    }
+
+    return hit;
+}
+
+// Moves the disc by one substep and makes it bounce.
+// ('goals' has a bit per side whose wall has paddles; returns FALSE if a point has been scored.)
+static gboolean move_disc_substep(Sim *sim, gint x_max, gint y_max, gint substeps, guint goals)
+{
+    Disc *disc = &sim->disc;
+    Rect from = disc->rect;
+
+    // Works out the new position of the disc.
+    disc->position.x = CLAMP(disc->position.x + scale_step(disc->step.x, sim->scale, substeps),
+                             0, x_max * FIXED_ONE);
+    disc->position.y = CLAMP(disc->position.y + scale_step(disc->step.y, sim->scale, substeps),
+                             0, y_max * FIXED_ONE);
+    disc->rect.x = disc->position.x >> FIXED_SHIFT;
+    disc->rect.y = disc->position.y >> FIXED_SHIFT;
+
+    gboolean hit;
+    guint towards;
+    TRACE_SCOPE("collision", hit = collide(sim, &from, &towards));
+
+    //Bounce the disk against the wall, add the score and pause the game
+    // (Only when moving towards the wall: a slow disc may still touch it after a goal.)
+    guint touched = touched_walls(disc, x_max, y_max);
+    guint goal = touched & towards & goals;
+    if (goal != 0 && !hit)
+    {
+        Side side = g_bit_nth_lsf(goal, -1);
+        score_goal(sim, side);
+        bounce(disc, side);
+        return FALSE;
+    }
+
+    // Bounces on the walls without paddles.
+    touched &= ~goals;
+    if (touched & towards & (1u << SIDE_LEFT | 1u << SIDE_RIGHT))
+    {
+        disc->step.x = -disc->step.x;
+        sim_emit(sim, EVENT_WALL_HIT, 0);
+    }
+
+    if (touched & (1u << SIDE_TOP | 1u << SIDE_BOTTOM))
+    {
+        disc->step.y = -disc->step.y;
+        sim_emit(sim, EVENT_WALL_HIT, 0);
+    }
+
+    return TRUE;
+}
+
+// Moves the disc by one tick.
+static void move_disc(Sim *sim)
+{
+    // Gets the largest coordinate for the disc.
+    gint x_max = sim->width - sim->disc.rect.width;
+    gint y_max = sim->height - sim->disc.rect.height;
+
+    // Divides the move of the tick into substeps,
+    // so that a fast disc cannot go through a paddle between two collision tests.
+    gint distance = scale_step(MAX(ABS(sim->disc.step.x), ABS(sim->disc.step.y)), sim->scale, 1);
+    gint substeps = 1 + distance / (sim->substep * FIXED_ONE);
+
+    for (gint i = 0; i < substeps; i++)
+    {
+        if (!move_disc_substep(sim, x_max, y_max, substeps, sim->goal_walls))
+            break;
+    }
+}
+
+gboolean sim_step(Sim *sim, guint keys)
+{
+    gboolean moved = FALSE;
+
+    // Moves the paddles.
+    for (guint i = 0; i < sim->paddle_count; i++)
+    {
+        Paddle *paddle = &sim->paddles[i];
+        gint x = paddle->rect.x;
+        gint y = paddle->rect.y;
+
+        sim_control_paddle(sim, paddle, keys);
+        moved |= paddle->rect.x != x || paddle->rect.y != y;
+    }
+
+    // Moves the disc.
+    if (sim->state == PLAY)
+    {
+        move_disc(sim);
+        moved = TRUE;
+    }
+
+    sim->tick++;
+    return moved;
+}
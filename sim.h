@@ -0,0 +1,180 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <glib.h>
+
+#include "config.h"
+
+#define FIXED_SHIFT 16              // Number of fractional bits of the fixed-point values
+#define FIXED_ONE (1 << FIXED_SHIFT) // One in fixed point
+#define DISC_SUBSTEP 9              // Largest move of the disc between two collision tests in pixels
+#define SIM_EVENTS 64               // Capacity of the event queue
+#define KEY_PADDLES 16              // Number of paddles that can be moved by the keys (two bits each)
+#define PREDICT_TICKS 4096          // Largest number of ticks followed by a prediction of the disc
+#define MAX_SCALE 64                // Largest time scale (the speed scale goes up to 20)
+
+// Key bits that move a paddle upwards (or leftwards) and downwards (or rightwards).
+#define KEY_UP(paddle) (1u << (2 * (paddle)))
+#define KEY_DOWN(paddle) (2u << (2 * (paddle)))
+
+// State of the game.
+typedef enum State
+{
+    STOP,                           // Stop state
+    PLAY,                           // Play state
+    PAUSE,                          // Pause state
+} State;
+
+// Bits of the key-state mask of the first two paddles.
+// (The bits of the paddle i are KEY_UP(i) and KEY_DOWN(i).)
+typedef enum Key
+{
+    KEY_P1_UP = KEY_UP(0),          // 'f' key
+    KEY_P1_DOWN = KEY_DOWN(0),      // 'v' key
+    KEY_P2_UP = KEY_UP(1),          // 'Up Arrow' key
+    KEY_P2_DOWN = KEY_DOWN(1),      // 'Down Arrow' key
+} Key;
+
+// Rectangle in pixels.
+typedef struct Rect
+{
+    gint x, y;                      // Position
+    gint width, height;             // Size
+} Rect;
+
+// Point or vector.
+typedef struct Point
+{
+    gint x, y;                      // Coordinates
+} Point;
+
+// Structure of a paddle.
+typedef struct Paddle
+{
+    Rect rect;                      // Position and size of the paddle
+    gint fraction;                  // Fraction of a pixel of its position along its wall in fixed point (moves below a pixel add up)
+    gint step;                      // Step of the paddle along its wall in fixed-point pixels per tick
+    guint score;                    // Score of the player
+    Control control;                // Controller of the paddle
+    Side side;                      // Side of the arena of the paddle
+    guint up;                       // Key bit that moves the paddle upwards (or leftwards)
+    guint down;                     // Key bit that moves the paddle downwards (or rightwards)
+    const Mlp *model;               // Network of the paddle if neural (NULL if none; shared with the tunables)
+    const Script *script;           // Bot of the paddle if scripted (NULL if none; shared with the tunables)
+} Paddle;
+
+// Structure of the disc.
+typedef struct Disc
+{
+    Rect rect;                      // Position and size in pixels
+    Point position;                 // Position in fixed-point pixels
+    Point step;                     // Horizontal and verical steps in fixed-point pixels per tick
+} Disc;
+
+// Type of a simulation event.
+typedef enum EventType
+{
+    EVENT_GOAL,                     // A goal has been scored (value: side of the wall)
+    EVENT_PADDLE_HIT,               // The disc has bounced on a paddle (value: paddle index + 1)
+    EVENT_WALL_HIT,                 // The disc has bounced on a wall without paddles
+    EVENT_STATE,                    // The state has changed (value: new state)
+    EVENT_BRICK_HIT,                // The disc has bounced on a brick (value: brick id)
+} EventType;
+
+// Structure of a simulation event.
+typedef struct Event
+{
+    EventType type;                 // Type
+    guint tick;                     // Tick of the simulation when it occurred
+    gint value;                     // Value (depends on the type)
+} Event;
+
+// Queue of the simulation events.
+// (Fixed-capacity ring buffer: the simulation never waits for its reader.)
+typedef struct EventQueue
+{
+    Event events[SIM_EVENTS];       // Events
+    guint head;                     // Number of events read
+    guint tail;                     // Number of events written
+    guint dropped;                  // Number of events dropped because the queue was full
+} EventQueue;
+
+// Bricks of the arena (see bricks.h).
+typedef struct Bricks Bricks;
+
+// Structure of the simulation.
+// (It has no dependency on GTK: the user interface only reads it and sends it input.)
+typedef struct Sim
+{
+    State state;                    // State of the game
+    gint width;                     // Width of the arena in pixels
+    gint height;                    // Height of the arena in pixels
+    guint paddle_count;             // Number of paddles
+    Paddle paddles[MAX_PADDLES];    // Paddles (player 1 first, then player 2)
+    Disc disc;                      // Disc
+    Bricks *bricks;                 // Bricks (NULL if none; shared by the copies of the simulation)
+    guint script_budget;            // Largest number of instructions run by a bot in a tick
+    guint script_overruns;          // Number of runs of the bots stopped by their budget
+    guint goal_walls;               // Sides whose walls have paddles (a bit per side, set by 'sim_resize')
+    gint substep;                   // Longest move of the disc between two collision tests in pixels (idem)
+    guint remote_keys;              // Keys of the paddles moved by the keys whatever their controllers (decided elsewhere)
+    gint scale;                     // Time scale in fixed point
+    guint end_game_score;           // Score that ends a match
+    guint32 rng;                    // State of the random number generator (xorshift)
+    guint tick;                     // Number of ticks since the start
+    EventQueue events;              // Events for the user interface
+} Sim;
+
+// Initializes a simulation from the tunables.
+// (Allocates the bricks, if any.)
+void sim_init(Sim *sim, const Config *config);
+
+// Frees the bricks of a simulation.
+void sim_free(Sim *sim);
+
+// Applies new tunables to a running simulation.
+// (The arena size and the seed are kept.)
+void sim_apply_config(Sim *sim, const Config *config);
+
+// Adjusts the simulation to new dimensions of the arena.
+// (The paddles of a side stand one behind the other, the first one against the wall.)
+void sim_resize(Sim *sim, gint width, gint height);
+
+// Sets the state of the game.
+// (Entering and leaving the 'Stop' state reset the scores and stand the bricks again.)
+void sim_set_state(Sim *sim, State state);
+
+// Moves a paddle according to its controller.
+// (The paddles of the remote keys are moved by the keys.)
+void sim_control_paddle(Sim *sim, Paddle *paddle, guint keys);
+
+// Gets the move of a paddle towards where the disc will reach its wall (-1, 0 or 1).
+// (The decision of the 'predict' controller: it follows the disc up to PREDICT_TICKS ticks ahead.)
+gint sim_decide(const Sim *sim, const Paddle *paddle);
+
+// Gets the observations of a paddle given to the network of the neural controller.
+// (Positions along the wall, distance, direction and sizes, normalized to about [-1, 1].)
+void sim_observe(const Sim *sim, const Paddle *paddle, gfloat observation[MLP_OBSERVATIONS]);
+
+// Gets the move of a paddle towards the disc (-1, 0 or 1).
+// (A cheap decision, for a paddle whose costly one is late.)
+gint sim_chase(const Sim *sim, const Paddle *paddle);
+
+// Runs one tick of the simulation with a key-state mask.
+// (Returns FALSE if nothing has moved.)
+gboolean sim_step(Sim *sim, guint keys);
+
+// Gets the next event of the simulation.
+// (Returns FALSE if there is none.)
+gboolean sim_poll_event(Sim *sim, Event *event);
+
+// Gets whether the simulation has events that have not been read.
+gboolean sim_has_events(const Sim *sim);
+
+// Gets whether two rectangles intersect.
+gboolean rect_intersect(const Rect *a, const Rect *b);
+
+// Gets the union of two rectangles.
+Rect rect_union(const Rect *a, const Rect *b);
+
+#endif
@@ -0,0 +1,349 @@
+#include "snapshot.h"
+#include "bricks.h"
+
+#define SNAPSHOT_MAGIC 0x5350       // "PS": first bytes of a snapshot
+
+// Primes of XXH64.
+#define PRIME64_1 11400714785074694791ULL
+#define PRIME64_2 14029467366897019727ULL
+#define PRIME64_3 1609587929392839161ULL
+#define PRIME64_4 9650029242287828579ULL
+#define PRIME64_5 2870177450012600261ULL
+
+// Writes packed little-endian values.
+static guint8 *put_u8(guint8 *p, guint8 value)
+{
+    p[0] = value;
+    return p + 1;
+}
+
+static guint8 *put_u16(guint8 *p, guint16 value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    return p + 2;
+}
+
+static guint8 *put_u32(guint8 *p, guint32 value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+    return p + 4;
+}
+
+// Reads packed little-endian values.
+static const guint8 *get_u8(const guint8 *p, guint8 *value)
+{
+    *value = p[0];
+    return p + 1;
+}
+
+static const guint8 *get_u16(const guint8 *p, guint16 *value)
+{
+    *value = p[0] | p[1] << 8;
+    return p + 2;
+}
+
+static const guint8 *get_u32(const guint8 *p, guint32 *value)
+{
+    *value = p[0] | p[1] << 8 | p[2] << 16 | (guint32) p[3] << 24;
+    return p + 4;
+}
+
+// Packs a paddle (18 bytes: its key bits follow from its index).
+static guint8 *put_paddle(guint8 *p, const Paddle *paddle)
+{
+    p = put_u16(p, paddle->rect.x);
+    p = put_u16(p, paddle->rect.y);
+    p = put_u16(p, paddle->fraction);
+    p = put_u16(p, paddle->rect.width);
+    p = put_u16(p, paddle->rect.height);
+    p = put_u32(p, paddle->step);
+    p = put_u16(p, paddle->score);
+    p = put_u8(p, paddle->side);
+    return put_u8(p, paddle->control);
+}
+
+// Checks the enumerations of a packed paddle.
+static gboolean check_paddle(const guint8 *p)
+{
+    return p[16] <= SIDE_BOTTOM && p[17] <= CONTROL_SCRIPT;
+}
+
+// Unpacks a paddle.
+// (Its network and its bot are the ones shared by all the paddles.)
+static const guint8 *get_paddle(const guint8 *p, Paddle *paddle, guint index, const Mlp *model, const Script *script)
+{
+    guint16 x, y, fraction, width, height, score;
+    guint32 step;
+    guint8 side, control;
+
+    p = get_u16(p, &x);
+    p = get_u16(p, &y);
+    p = get_u16(p, &fraction);
+    p = get_u16(p, &width);
+    p = get_u16(p, &height);
+    p = get_u32(p, &step);
+    p = get_u16(p, &score);
+    p = get_u8(p, &side);
+    p = get_u8(p, &control);
+
+    paddle->rect = (Rect) { (gint16) x, (gint16) y, width, height };
+    paddle->fraction = fraction;
+    paddle->step = (gint32) step;
+    paddle->score = score;
+    paddle->side = side;
+    paddle->control = control;
+    paddle->model = model;
+    paddle->script = script;
+    paddle->up = index < KEY_PADDLES ? KEY_UP(index) : 0;
+    paddle->down = index < KEY_PADDLES ? KEY_DOWN(index) : 0;
+    return p;
+}
+
+void snapshot_save(const Sim *sim, Snapshot *snapshot)
+{
+    guint8 *p = snapshot->bytes;
+    guint brick_count = sim->bricks != NULL ? sim->bricks->count : 0;
+
+    // Header (8 bytes).
+    p = put_u16(p, SNAPSHOT_MAGIC);
+    p = put_u16(p, SNAPSHOT_VERSION);
+    p = put_u8(p, sim->state);
+    p = put_u8(p, sim->paddle_count);
+    p = put_u16(p, brick_count);
+
+    // Arena (4 bytes).
+    p = put_u16(p, sim->width);
+    p = put_u16(p, sim->height);
+
+    // Paddles (18 bytes each).
+    for (guint i = 0; i < sim->paddle_count; i++)
+        p = put_paddle(p, &sim->paddles[i]);
+
+    // Disc (20 bytes: its pixel position is the integer part of its fixed-point position).
+    p = put_u16(p, sim->disc.rect.width);
+    p = put_u16(p, sim->disc.rect.height);
+    p = put_u32(p, sim->disc.position.x);
+    p = put_u32(p, sim->disc.position.y);
+    p = put_u32(p, sim->disc.step.x);
+    p = put_u32(p, sim->disc.step.y);
+
+    // Clock, rules, random number generator and keys of the remote paddles (20 bytes).
+    p = put_u32(p, sim->scale);
+    p = put_u32(p, sim->end_game_score);
+    p = put_u32(p, sim->rng);
+    p = put_u32(p, sim->tick);
+    p = put_u32(p, sim->remote_keys);
+
+    // Bricks (a bit per brick, set if it is standing).
+    if (brick_count != 0)
+    {
+        bricks_pack(sim->bricks, p);
+        p += (brick_count + 7) / 8;
+    }
+
+    snapshot->size = SNAPSHOT_SIZE(sim->paddle_count, brick_count);
+    g_assert(p == snapshot->bytes + snapshot->size);
+}
+
+gboolean snapshot_restore(Sim *sim, const Snapshot *snapshot)
+{
+    const guint8 *p = snapshot->bytes;
+    guint16 magic, version, width, height, disc_width, disc_height;
+    guint16 brick_count;
+    guint8 state, paddle_count;
+
+    // Checks the header and the enumerations before changing anything.
+    p = get_u16(p, &magic);
+    p = get_u16(p, &version);
+    p = get_u8(p, &state);
+    p = get_u8(p, &paddle_count);
+    p = get_u16(p, &brick_count);
+    p = get_u16(p, &width);
+    p = get_u16(p, &height);
+
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION || state > PAUSE
+        || paddle_count == 0 || paddle_count > MAX_PADDLES
+        || brick_count != (sim->bricks != NULL ? sim->bricks->count : 0)
+        || snapshot->size != SNAPSHOT_SIZE(paddle_count, brick_count)
+        || width > MAX_ARENA || height > MAX_ARENA)
+        return FALSE;
+
+    for (guint i = 0; i < paddle_count; i++)
+    {
+        if (!check_paddle(p + SNAPSHOT_PADDLE_SIZE * i))
+            return FALSE;
+    }
+
+    // The paddles of the tunables all share the same network and bot, whatever their number.
+    const Mlp *model = sim->paddles[0].model;
+    const Script *script = sim->paddles[0].script;
+
+    sim->state = state;
+    sim->paddle_count = paddle_count;
+
+    sim->width = width;
+    sim->height = height;
+
+    for (guint i = 0; i < paddle_count; i++)
+        p = get_paddle(p, &sim->paddles[i], i, model, script);
+
+    guint32 x, y, step_x, step_y;
+    p = get_u16(p, &disc_width);
+    p = get_u16(p, &disc_height);
+    p = get_u32(p, &x);
+    p = get_u32(p, &y);
+    p = get_u32(p, &step_x);
+    p = get_u32(p, &step_y);
+    sim->disc.position = (Point) { (gint32) x, (gint32) y };
+    sim->disc.rect = (Rect) { (gint32) x >> FIXED_SHIFT, (gint32) y >> FIXED_SHIFT, disc_width, disc_height };
+    sim->disc.step = (Point) { (gint32) step_x, (gint32) step_y };
+
+    guint32 scale, end_game_score, rng, tick, remote_keys;
+    p = get_u32(p, &scale);
+    p = get_u32(p, &end_game_score);
+    p = get_u32(p, &rng);
+    p = get_u32(p, &tick);
+    p = get_u32(p, &remote_keys);
+    sim->scale = (gint32) scale;
+    sim->end_game_score = end_game_score;
+    sim->rng = rng;
+    sim->tick = tick;
+    sim->remote_keys = remote_keys;
+
+    if (brick_count != 0)
+        bricks_unpack(sim->bricks, p);
+
+    // Works out the walls with paddles and the substep again.
+    // (It puts the paddles back at their distances from their walls and keeps them and the disc
+    // inside the arena: the restored positions only change if the snapshot does not fit its arena.)
+    sim_resize(sim, sim->width, sim->height);
+
+    // Drops the pending events: the user interface only has to show the restored state.
+    sim->events.head = 0;
+    sim->events.dropped = 0;
+    sim->events.events[0] = (Event) { EVENT_STATE, sim->tick, sim->state };
+    sim->events.tail = 1;
+
+    return TRUE;
+}
+
+// Reads little-endian words for the hash.
+static guint64 read_u64(const guint8 *p)
+{
+    guint32 low, high;
+    get_u32(p, &low);
+    get_u32(p + 4, &high);
+    return (guint64) high << 32 | low;
+}
+
+static guint64 rotl64(guint64 x, gint r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// Mixes a word into an accumulator of XXH64.
+static guint64 xxh64_round(guint64 acc, guint64 input)
+{
+    acc += input * PRIME64_2;
+    return rotl64(acc, 31) * PRIME64_1;
+}
+
+// Merges an accumulator into the hash of XXH64.
+static guint64 xxh64_merge(guint64 hash, guint64 acc)
+{
+    hash ^= xxh64_round(0, acc);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+// Hashes bytes with XXH64.
+static guint64 xxh64(const guint8 *p, gsize length, guint64 seed)
+{
+    const guint8 *end = p + length;
+    guint64 hash;
+
+    if (length >= 32)
+    {
+        guint64 v1 = seed + PRIME64_1 + PRIME64_2;
+        guint64 v2 = seed + PRIME64_2;
+        guint64 v3 = seed;
+        guint64 v4 = seed - PRIME64_1;
+
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxh64_round(v1, read_u64(p));
+            v2 = xxh64_round(v2, read_u64(p + 8));
+            v3 = xxh64_round(v3, read_u64(p + 16));
+            v4 = xxh64_round(v4, read_u64(p + 24));
+        }
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxh64_merge(hash, v1);
+        hash = xxh64_merge(hash, v2);
+        hash = xxh64_merge(hash, v3);
+        hash = xxh64_merge(hash, v4);
+    }
+    else
+        hash = seed + PRIME64_5;
+
+    hash += length;
+
+    for (; p + 8 <= end; p += 8)
+        hash = rotl64(hash ^ xxh64_round(0, read_u64(p)), 27) * PRIME64_1 + PRIME64_4;
+
+    if (p + 4 <= end)
+    {
+        guint32 word;
+        get_u32(p, &word);
+        hash = rotl64(hash ^ word * PRIME64_1, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+        hash = rotl64(hash ^ *p * PRIME64_5, 11) * PRIME64_1;
+
+    // Avalanche.
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    return hash ^ (hash >> 32);
+}
+
+guint64 snapshot_hash(const Snapshot *snapshot)
+{
+    return xxh64(snapshot->bytes, snapshot->size, 0);
+}
+
+guint64 sim_hash(const Sim *sim)
+{
+    Snapshot snapshot;
+    snapshot_save(sim, &snapshot);
+    return snapshot_hash(&snapshot);
+}
+
+gboolean snapshot_write(const Snapshot *snapshot, const gchar *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return FALSE;
+
+    gboolean ok = fwrite(snapshot->bytes, snapshot->size, 1, file) == 1;
+    return fclose(file) == 0 && ok;
+}
+
+gboolean snapshot_read(Snapshot *snapshot, const gchar *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return FALSE;
+
+    // The size is checked against the numbers of paddles and bricks when the snapshot is restored.
+    snapshot->size = fread(snapshot->bytes, 1, SNAPSHOT_MAX_SIZE, file);
+    gboolean ok = !ferror(file) && fgetc(file) == EOF;
+    fclose(file);
+    return ok && snapshot->size >= SNAPSHOT_SIZE(0, 0);
+}
@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "sim.h"
+
+#define SNAPSHOT_VERSION 5          // Version of the layout of a snapshot
+#define SNAPSHOT_PADDLE_SIZE 18     // Size of a packed paddle in bytes
+
+// Size of the snapshot of a simulation with a number of paddles and bricks in bytes.
+// (88 bytes for two paddles and no brick.)
+#define SNAPSHOT_SIZE(paddles, bricks) (52 + SNAPSHOT_PADDLE_SIZE * (paddles) + ((bricks) + 7) / 8)
+#define SNAPSHOT_MAX_SIZE SNAPSHOT_SIZE(MAX_PADDLES, MAX_BRICKS)
+
+// Snapshot of the complete state of a simulation.
+// (Fixed layout, little-endian: the used bytes can be written to a file as they are.
+// The event queue is not saved: it only feeds the user interface.)
+typedef struct Snapshot
+{
+    guint8 bytes[SNAPSHOT_MAX_SIZE]; // Packed state
+    gsize size;                     // Number of bytes used
+} Snapshot;
+
+// Saves the state of a simulation.
+void snapshot_save(const Sim *sim, Snapshot *snapshot);
+
+// Restores the state of a simulation.
+// (Never allocates, unless the arena has another size and the bricks are laid out again.
+// Returns FALSE and leaves the simulation unchanged if the snapshot is not valid or has
+// another number of bricks; otherwise the event queue only holds a state event.)
+gboolean snapshot_restore(Sim *sim, const Snapshot *snapshot);
+
+// Gets the hash of a snapshot (XXH64 of its bytes).
+guint64 snapshot_hash(const Snapshot *snapshot);
+
+// Gets the hash of the state of a simulation.
+// (Equal states have equal hashes: used to check that the simulation is bit-exact.)
+guint64 sim_hash(const Sim *sim);
+
+// Writes a snapshot to a file.
+// (Returns FALSE if the file cannot be written.)
+gboolean snapshot_write(const Snapshot *snapshot, const gchar *path);
+
+// Reads a snapshot from a file.
+// (Returns FALSE if the file cannot be read or is not a snapshot.)
+gboolean snapshot_read(Snapshot *snapshot, const gchar *path);
+
+#endif
@@ -0,0 +1,84 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+guint stats_bucket(gint64 sample)
+{
+    guint bucket = 0;
+    while (sample > 0 && bucket < STATS_BUCKETS - 1)
+    {
+        sample >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void stats_add(Stats *stats, gint64 sample)
+{
+    stats->window[stats->next] = sample;
+    stats->next = (stats->next + 1) % STATS_WINDOW;
+    stats->count++;
+    stats->buckets[stats_bucket(sample)]++;
+    stats->max = MAX(stats->max, sample);
+}
+
+guint stats_size(const Stats *stats)
+{
+    return stats->count < STATS_WINDOW ? stats->count : STATS_WINDOW;
+}
+
+gint64 stats_recent(const Stats *stats, guint n)
+{
+    return stats->window[(stats->next + STATS_WINDOW - 1 - n) % STATS_WINDOW];
+}
+
+guint stats_histogram(const Stats *stats, guint counts[STATS_BUCKETS])
+{
+    guint size = stats_size(stats);
+
+    memset(counts, 0, STATS_BUCKETS * sizeof(guint));
+    for (guint i = 0; i < size; i++)
+        counts[stats_bucket(stats->window[i])]++;
+    return size;
+}
+
+// Compares two samples (for qsort()).
+static int stats_compare(const void *a, const void *b)
+{
+    gint64 x = *(const gint64*) a;
+    gint64 y = *(const gint64*) b;
+    return (x > y) - (x < y);
+}
+
+gint64 stats_percentile(const Stats *stats, guint percent)
+{
+    guint size = stats_size(stats);
+    if (size == 0)
+        return 0;
+
+    // Sorts a copy of the window (on the stack).
+    gint64 sorted[STATS_WINDOW];
+    memcpy(sorted, stats->window, size * sizeof(gint64));
+    qsort(sorted, size, sizeof(gint64), stats_compare);
+
+    return sorted[MIN(size - 1, size * percent / 100)];
+}
+
+void stats_dump(FILE *file, const gchar *name, const gchar *unit, const Stats *stats)
+{
+    fprintf(file, "%s: %" G_GUINT64_FORMAT " samples, p50 %" G_GINT64_FORMAT " %s,"
+            " p99 %" G_GINT64_FORMAT " %s, max %" G_GINT64_FORMAT " %s\n",
+            name, stats->count, stats_percentile(stats, 50), unit,
+            stats_percentile(stats, 99), unit, stats->max, unit);
+
+    for (guint i = 0; i < STATS_BUCKETS; i++)
+    {
+        if (stats->buckets[i] == 0)
+            continue;
+
+        gint64 low = i == 0 ? 0 : (gint64) 1 << (i - 1);
+        fprintf(file, "  >= %10" G_GINT64_FORMAT " %s: %" G_GUINT64_FORMAT "\n",
+                low, unit, stats->buckets[i]);
+    }
+}
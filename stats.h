@@ -0,0 +1,43 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#define STATS_WINDOW 256            // Number of recent samples kept by a 'Stats' structure
+#define STATS_BUCKETS 32            // Number of power-of-two buckets of the histogram
+
+// Rolling window and histogram of samples.
+// (Fixed size: adding a sample never allocates.)
+typedef struct Stats
+{
+    gint64 window[STATS_WINDOW];    // Most recent samples (ring buffer)
+    guint next;                     // Index of the next sample in the window
+    guint64 count;                  // Number of samples since the start
+    guint64 buckets[STATS_BUCKETS]; // Histogram since the start (bucket i: [2^(i-1), 2^i[)
+    gint64 max;                     // Largest sample since the start
+} Stats;
+
+// Adds a sample.
+void stats_add(Stats *stats, gint64 sample);
+
+// Gets the number of samples in the window.
+guint stats_size(const Stats *stats);
+
+// Gets the histogram bucket of a sample.
+guint stats_bucket(gint64 sample);
+
+// Counts the samples of the window in each histogram bucket.
+// (The rolling histogram, against the one since the start; returns the number of samples.)
+guint stats_histogram(const Stats *stats, guint counts[STATS_BUCKETS]);
+
+// Gets the n-th most recent sample (0 is the last one).
+gint64 stats_recent(const Stats *stats, guint n);
+
+// Gets a percentile (0 to 100) of the samples in the window (0 if there is none).
+gint64 stats_percentile(const Stats *stats, guint percent);
+
+// Writes the percentiles and the histogram of the samples to a file.
+void stats_dump(FILE *file, const gchar *name, const gchar *unit, const Stats *stats);
+
+#endif
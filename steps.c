@@ -0,0 +1,207 @@
+#include "steps.h"
+
+GtkBuilder *steps_load(const gchar *resource)
+{
+    // Constructs a GtkBuilder instance.
+    GtkBuilder* builder = gtk_builder_new ();
+
+    // Loads the UI description.
+    GError* error = NULL;
+    if (gtk_builder_add_from_resource(builder, resource, &error) == 0)
+    {
+        g_printerr("Error loading resource: %s\n", error->message);
+        g_clear_error(&error);
+        g_object_unref(builder);
+        return NULL;
+    }
+
+    return builder;
+}
+
+void steps_init(Game *game, GtkBuilder *builder)
+{
+    // Gets the widgets.
+    GtkWindow* window = GTK_WINDOW(gtk_builder_get_object(builder, "org.gtk.duel"));
+    GtkDrawingArea* area = GTK_DRAWING_AREA(gtk_builder_get_object(builder, "area"));
+    GtkButton* start_button = GTK_BUTTON(gtk_builder_get_object(builder, "start_button"));
+    GtkButton* stop_button = GTK_BUTTON(gtk_builder_get_object(builder, "stop_button"));
+    GtkLabel* p1_score_label = GTK_LABEL(gtk_builder_get_object(builder, "p1_score_label"));
+    GtkLabel* p2_score_label = GTK_LABEL(gtk_builder_get_object(builder, "p2_score_label"));
+    GtkScale* speed_scale = GTK_SCALE(gtk_builder_get_object(builder, "speed_scale"));
+    GtkCheckButton* training_cb = GTK_CHECK_BUTTON(gtk_builder_get_object(builder, "training_cb"));
+
+    // Creates the "Game" structure.
+    *game = (Game)
+            {
+                    .state = STOP,
+
+                    .p1 =
+                            {
+                                    .rect = { 0, 0, 10, 100 },
+                                    .step = PADDLE_STEP,
+                                    .score = 0,
+                                    .label = p1_score_label,
+                                    .event = 0,
+                            },
+
+                    .p2 =
+                            {
+                                    .rect = { 800 - 10, 0, 10, 100 },
+                                    .step = PADDLE_STEP,
+                                    .score = 0,
+                                    .label = p2_score_label,
+                                    .event = 0,
+                            },
+
+                    .disc =
+                            {
+                                    .rect = { 100, 100, 10, 10 },
+                                    .step = { 1, 1 },
+                                    .event = 0,
+                                    .period = DISC_PERIOD,
+                            },
+
+                    .ui =
+                            {
+                                    .window = window,
+                                    .area = area,
+                                    .start_button = start_button,
+                                    .stop_button = stop_button,
+                                    .speed_scale = speed_scale,
+                                    .training_cb = training_cb,
+                            },
+            };
+}
+
+void steps_draw(cairo_t *cr, const GdkRectangle *paddles, guint paddle_count, const GdkRectangle *disc)
+{
+    // Sets the background to white.
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_paint(cr);
+
+    //Draw the paddles in black
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    for (guint i = 0; i < paddle_count; i++)
+    {
+        cairo_rectangle(cr, paddles[i].x, paddles[i].y, paddles[i].width, paddles[i].height);
+        cairo_fill(cr);
+    }
+
+    // Draws the disc in red.
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    cairo_rectangle(cr, disc->x, disc->y, disc->width, disc->height);
+    cairo_fill(cr);
+}
+
+void steps_redraw_item(GtkDrawingArea *area, GdkRectangle *old, const GdkRectangle *new)
+{
+    // Determines the part of the area to redraw.
+    // (The union of the previous and new positions of the item.)
+    gdk_rectangle_union(old, new, old);
+
+    // Redraws the item.
+    gtk_widget_queue_draw_area(GTK_WIDGET(area),
+                               old->x, old->y, old->width, old->height);
+}
+
+gboolean steps_move_disc(gpointer user_data)
+{
+    // Gets the `Game` structure passed as parameter.
+    Game* game = user_data;
+
+    // Gets the largest coordinate for the disc.
+    gint x_max = gtk_widget_get_allocated_width(GTK_WIDGET(game->ui.area))
+                 - game->disc.rect.width;
+    gint y_max = gtk_widget_get_allocated_height(GTK_WIDGET(game->ui.area))
+                 - game->disc.rect.height;
+
+    // Gets the current position of the disc.
+    GdkRectangle old = game->disc.rect;
+
+    // Works out the new position of the disc.
+    game->disc.rect.x = CLAMP(game->disc.rect.x + game->disc.step.x, 0, x_max);
+    game->disc.rect.y = CLAMP(game->disc.rect.y + game->disc.step.y, 0, y_max);
+
+    //Bounce the disk against the wall
+    if (game->disc.rect.x  == 0 || game->disc.rect.x == x_max)
+    {
+        game->disc.step.x = - (game->disc.step.x);
+    }
+
+    if (game->disc.rect.y  == 0 || game->disc.rect.y == y_max)
+    {
+        game->disc.step.y = - (game->disc.step.y);
+    }
+
+    // Redraws the disc.
+    steps_redraw_item(game->ui.area, &old, &game->disc.rect);
+
+    // Enables the next call.
+    return TRUE;
+}
+
+// Sets the 'Play' state.
+static void set_play(Game* game)
+{
+    // - Set the state field to PLAY.
+    game->state = PLAY;
+
+    // - Set the label of the start button to "Pause".
+    gtk_button_set_label(game->ui.start_button, "Pause");
+
+    // - Disable the stop button.
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+
+    // - Set the steps_move_disc() function to be called at regular intervals.
+    game->disc.event = g_timeout_add(game->disc.period, steps_move_disc, game);
+
+}
+
+// Sets the 'Pause' state.
+static void set_pause(Game* game)
+{
+    // - Set the state field to PAUSE.
+    game->state = PAUSE;
+
+    // - Set the label of the start button to "Resume".
+    gtk_button_set_label(game->ui.start_button, "Resume");
+
+    // - Enable the stop button.
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), TRUE);
+
+    // - Stop the steps_move_disc() function.
+    g_source_remove(game->disc.event);
+    game->disc.event = 0;
+}
+
+// Sets the 'Stop' state.
+static void set_stop(Game *game)
+{
+    // - Set the state field to STOP.
+    game->state = STOP;
+
+    // - Set the label of the start button to "Start".
+    gtk_button_set_label(game->ui.start_button, "Start");
+
+    // - Disable the stop button.
+    gtk_widget_set_sensitive(GTK_WIDGET(game->ui.stop_button), FALSE);
+}
+
+void steps_on_start(GtkButton *button, gpointer user_data)
+{
+    // Gets the `Game` structure.
+    Game *game = user_data;
+
+    // Sets the next state according to the current state.
+    switch (game->state)
+    {
+        case STOP: set_play(game); break;
+        case PLAY: set_pause(game); break;
+        case PAUSE: set_play(game); break;
+    };
+}
+
+void steps_on_stop(GtkButton *button, gpointer user_data)
+{
+    set_stop(user_data);
+}
@@ -0,0 +1,88 @@
+#ifndef STEPS_H
+#define STEPS_H
+
+#include <gtk/gtk.h>
+
+// Code shared by the earlier steps of the game (plain, disc, state and paddles).
+// (Each step moves its items with its own timeouts, in pixels, straight from the handlers:
+// duel runs the simulation of sim.h instead.)
+
+#define PADDLE_STEP 5               // Step of a paddle in pixels
+#define PADDLE_PERIOD 5             // Period of a paddle in milliseconds
+#define DISC_PERIOD 4               // Period of the disc in milliseconds
+#define END_GAME_SCORE 5            // Maximum number of points for a player
+
+// State of the game.
+typedef enum State
+{
+    STOP,                           // Stop state
+    PLAY,                           // Play state
+    PAUSE,                          // Pause state
+} State;
+
+// Structure of a player.
+typedef struct Player
+{
+    GdkRectangle rect;              // Position and size of the player's paddle
+    gint step;                      // Vertical step of the player's paddle in pixels
+    guint score;                    // Score
+    GtkLabel* label;                // Label used to display the score
+    guint event;                    // Event ID used to move the paddle
+} Player;
+
+// Structure of the disc.
+typedef struct Disc
+{
+    GdkRectangle rect;              // Position and size
+    GdkPoint step;                  // Horizontal and verical steps in pixels
+    guint period;                   // Period in milliseconds
+    guint event;                    // Event ID used to move the disc
+} Disc;
+
+// Structure of the graphical user interface.
+typedef struct UserInterface
+{
+    GtkWindow* window;              // Main window
+    GtkDrawingArea* area;           // Drawing area
+    GtkButton* start_button;        // Start button
+    GtkButton* stop_button;         // Stop button
+    GtkScale* speed_scale;          // Speed scale
+    GtkCheckButton* training_cb;    // Training check box
+} UserInterface;
+
+// Structure of the game.
+typedef struct Game
+{
+    State state;                    // State of the game
+    Player p1;                      // Player 1
+    Player p2;                      // Player 2
+    Disc disc;                      // Disc
+    UserInterface ui;               // User interface
+} Game;
+
+// Loads a UI description compiled into the binary.
+// (Returns NULL, after printing the error, if it cannot be loaded.)
+GtkBuilder *steps_load(const gchar *resource);
+
+// Creates the game from the widgets of the UI description of duel.
+// (The players stand against the left and right walls of an arena of 800 pixels, the disc is stopped.)
+void steps_init(Game *game, GtkBuilder *builder);
+
+// Draws the arena: the background in white, the paddles in black and the disc in red.
+void steps_draw(cairo_t *cr, const GdkRectangle *paddles, guint paddle_count, const GdkRectangle *disc);
+
+// Redraws an item in the drawing area.
+// (The old rectangle becomes the union of the previous and new positions of the item.)
+void steps_redraw_item(GtkDrawingArea *area, GdkRectangle *old, const GdkRectangle *new);
+
+// Timeout function called at regular intervals to move the disc of a game.
+// (The disc bounces on the walls of the drawing area.)
+gboolean steps_move_disc(gpointer user_data);
+
+// Event handler for the "clicked" signal of the start button: plays, pauses or resumes the game.
+void steps_on_start(GtkButton *button, gpointer user_data);
+
+// Event handler for the "clicked" signal of the stop button: stops the game.
+void steps_on_stop(GtkButton *button, gpointer user_data);
+
+#endif
@@ -0,0 +1,52 @@
+#include "ticker.h"
+
+// Runs one tick and suspends the timeout source once the game is idle.
+static gboolean on_ticker(gpointer user_data)
+{
+    Ticker *ticker = user_data;
+
+    ticker->wakeups++;
+    if (ticker->func(ticker->user_data))
+        return G_SOURCE_CONTINUE;
+
+    ticker->suspends++;
+    ticker->source = 0;
+    return G_SOURCE_REMOVE;
+}
+
+void ticker_start(Ticker *ticker, guint period, GSourceFunc func, gpointer user_data)
+{
+    *ticker = (Ticker)
+            {
+                    .period = period,
+                    .func = func,
+                    .user_data = user_data,
+            };
+
+    ticker_wake(ticker);
+}
+
+void ticker_wake(Ticker *ticker)
+{
+    if (ticker->source == 0)
+        ticker->source = g_timeout_add(ticker->period, on_ticker, ticker);
+}
+
+void ticker_set_period(Ticker *ticker, guint period)
+{
+    if (ticker->period == period)
+        return;
+
+    ticker->period = period;
+    if (ticker->source != 0)
+    {
+        g_source_remove(ticker->source);
+        ticker->source = 0;
+        ticker_wake(ticker);
+    }
+}
+
+gboolean ticker_is_running(const Ticker *ticker)
+{
+    return ticker->source != 0;
+}
@@ -0,0 +1,32 @@
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <glib.h>
+
+// Game tick that suspends itself while the game is idle.
+// (No timeout source is installed while suspended: an idle game never wakes up.)
+typedef struct Ticker
+{
+    guint source;                   // ID of the timeout source (0 while suspended)
+    guint period;                   // Period in milliseconds
+    GSourceFunc func;               // Function of a tick (returns FALSE once the game is idle)
+    gpointer user_data;             // Data passed to the function
+    guint64 wakeups;                // Number of ticks run
+    guint64 suspends;               // Number of times the tick has been suspended
+} Ticker;
+
+// Starts a tick.
+void ticker_start(Ticker *ticker, guint period, GSourceFunc func, gpointer user_data);
+
+// Resumes a suspended tick.
+// (The next tick runs within one period; does nothing if it is running.)
+void ticker_wake(Ticker *ticker);
+
+// Changes the period of a tick.
+// (A running tick is reinstalled; a suspended one stays suspended.)
+void ticker_set_period(Ticker *ticker, guint period);
+
+// Gets whether a tick is running.
+gboolean ticker_is_running(const Ticker *ticker);
+
+#endif
@@ -0,0 +1,157 @@
+#include "tiles.h"
+
+#include <math.h>
+
+#include "bricks.h"
+
+void tiles_init(Tiles *tiles, const Config *config, guint count)
+{
+    *tiles = (Tiles) { .count = count, .columns = 1, .rows = 1, .scale = 1, .tiles = g_new0(Tile, count) };
+
+    Config tile_config = *config;
+    tile_config.p1_control = config->p1_control == CONTROL_KEYS ? CONTROL_FOLLOW : config->p1_control;
+    tile_config.p2_control = config->p2_control == CONTROL_KEYS ? CONTROL_FOLLOW : config->p2_control;
+    tile_config.others_control = config->others_control == CONTROL_KEYS ? CONTROL_FOLLOW : config->others_control;
+
+    for (guint i = 0; i < count; i++)
+    {
+        tile_config.seed = config->seed + i;
+        sim_init(&tiles->tiles[i].sim, &tile_config);
+        sim_set_state(&tiles->tiles[i].sim, PLAY);
+    }
+}
+
+void tiles_free(Tiles *tiles)
+{
+    for (guint i = 0; i < tiles->count; i++)
+        sim_free(&tiles->tiles[i].sim);
+    g_free(tiles->tiles);
+    tiles->tiles = NULL;
+    tiles->count = 0;
+}
+
+void tiles_layout(Tiles *tiles, gint width, gint height)
+{
+    if (tiles->count == 0)
+        return;
+
+    // All the arenas have the size of the tunables.
+    const Sim *first = &tiles->tiles[0].sim;
+    tiles->width = width;
+    tiles->height = height;
+    tiles->scale = 0;
+
+    // Tries every number of columns and keeps the one with the largest arenas.
+    for (guint columns = 1; columns <= tiles->count; columns++)
+    {
+        guint rows = (tiles->count + columns - 1) / columns;
+        gdouble cell_width = (gdouble) (width - (gint) (columns - 1) * TILE_GAP) / columns;
+        gdouble cell_height = (gdouble) (height - (gint) (rows - 1) * TILE_GAP) / rows;
+        gdouble scale = MIN(cell_width / first->width, cell_height / first->height);
+        if (scale > tiles->scale)
+        {
+            tiles->scale = scale;
+            tiles->columns = columns;
+            tiles->rows = rows;
+        }
+    }
+
+    tiles->scale = MAX(tiles->scale, 0.01);
+    tiles->detail = tiles->scale >= 0.5 ? DETAIL_FULL : tiles->scale >= 0.2 ? DETAIL_SIMPLE : DETAIL_MINIMAL;
+
+    // Centres each arena in its cell, on whole pixels.
+    gdouble cell_width = (gdouble) (width - (gint) (tiles->columns - 1) * TILE_GAP) / tiles->columns;
+    gdouble cell_height = (gdouble) (height - (gint) (tiles->rows - 1) * TILE_GAP) / tiles->rows;
+    gint arena_width = MAX((gint) (first->width * tiles->scale), 1);
+    gint arena_height = MAX((gint) (first->height * tiles->scale), 1);
+    for (guint i = 0; i < tiles->count; i++)
+    {
+        guint column = i % tiles->columns;
+        guint row = i / tiles->columns;
+        tiles->tiles[i].arena = (Rect)
+                {
+                        (gint) (column * (cell_width + TILE_GAP) + (cell_width - arena_width) / 2),
+                        (gint) (row * (cell_height + TILE_GAP) + (cell_height - arena_height) / 2),
+                        arena_width,
+                        arena_height,
+                };
+    }
+}
+
+Rect tiles_map(const Tiles *tiles, const Tile *tile, const Rect *rect)
+{
+    gint smallest = tiles->detail == DETAIL_MINIMAL ? 2 : 1;
+    gint x = tile->arena.x + (gint) floor(rect->x * tiles->scale);
+    gint y = tile->arena.y + (gint) floor(rect->y * tiles->scale);
+    gint right = tile->arena.x + (gint) ceil((rect->x + rect->width) * tiles->scale);
+    gint bottom = tile->arena.y + (gint) ceil((rect->y + rect->height) * tiles->scale);
+
+    // (The grown items stay in the arena.)
+    gint width = MAX(right - x, smallest);
+    gint height = MAX(bottom - y, smallest);
+    x = MIN(x, tile->arena.x + tile->arena.width - width);
+    y = MIN(y, tile->arena.y + tile->arena.height - height);
+    return (Rect) { x, y, width, height };
+}
+
+// Adds the part of a tile covered by an item before and after a tick to the changed part, if it has moved.
+static void add_move(const Tiles *tiles, const Tile *tile, const Rect *old, const Rect *new, Rect *changed)
+{
+    if (old->x == new->x && old->y == new->y)
+        return;
+
+    Rect before = tiles_map(tiles, tile, old);
+    Rect after = tiles_map(tiles, tile, new);
+    Rect moved = rect_union(&before, &after);
+    *changed = changed->width == 0 ? moved : rect_union(changed, &moved);
+}
+
+guint tiles_step(Tiles *tiles, void (*changed)(const Rect *rect, gpointer user_data), gpointer user_data)
+{
+    guint count = 0;
+
+    for (guint i = 0; i < tiles->count; i++)
+    {
+        Tile *tile = &tiles->tiles[i];
+        Sim *sim = &tile->sim;
+        Rect paddles[MAX_PADDLES];
+        for (guint j = 0; j < sim->paddle_count; j++)
+            paddles[j] = sim->paddles[j].rect;
+        Rect disc = sim->disc.rect;
+
+        sim_step(sim, 0);
+
+        // Resumes the match after a goal, or starts a new one.
+        gboolean whole = FALSE;
+        Event event;
+        while (sim_poll_event(sim, &event))
+        {
+            if (event.type == EVENT_STATE)
+            {
+                whole = TRUE;
+                if (event.value != PLAY)
+                    sim_set_state(sim, PLAY);
+            }
+            else if (event.type == EVENT_BRICK_HIT)
+                whole |= sim->bricks->destructible;
+        }
+
+        Rect part = { 0 };
+        if (whole)
+            part = tile->arena;
+        else
+        {
+            for (guint j = 0; j < sim->paddle_count; j++)
+                add_move(tiles, tile, &paddles[j], &sim->paddles[j].rect, &part);
+            add_move(tiles, tile, &disc, &sim->disc.rect, &part);
+        }
+
+        if (part.width != 0)
+        {
+            changed(&part, user_data);
+            count++;
+        }
+    }
+
+    return count;
+}
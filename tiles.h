@@ -0,0 +1,62 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <glib.h>
+
+#include "config.h"
+#include "sim.h"
+
+#define TILE_GAP 2                  // Space between two tiles in pixels
+
+// Level of detail of the arenas drawn in the tiles (from their scale).
+// (The tiles are drawn on whole pixels, without antialiasing.)
+typedef enum Detail
+{
+    DETAIL_FULL,                    // Every brick (scale of 1/2 or more)
+    DETAIL_SIMPLE,                  // A block per leaf of the tree of the bricks (scale of 1/5 or more)
+    DETAIL_MINIMAL,                 // No bricks, and paddles and disc at least 2 pixels wide
+} Detail;
+
+// Match shown in a tile.
+typedef struct Tile
+{
+    Sim sim;                        // Simulation
+    Rect arena;                     // Arena in the drawing area in pixels
+} Tile;
+
+// Grid of matches played by the bots and drawn together in the drawing area.
+// (The simulations are the shared state of the draw pass: it reads them, and the tick
+// reports the parts of the tiles that have changed, so that the other tiles are not drawn.)
+typedef struct Tiles
+{
+    guint count;                    // Number of tiles (0 if none: a single match is shown)
+    guint columns;                  // Number of columns of the grid
+    guint rows;                     // Number of rows of the grid
+    gint width, height;             // Size of the drawing area in pixels
+    gdouble scale;                  // Scale of the arenas in the tiles
+    Detail detail;                  // Level of detail of the arenas
+    Tile *tiles;                    // Tiles
+} Tiles;
+
+// Starts a number of matches, each with a seed of its own.
+// (The paddles moved by the keys follow the disc instead.)
+void tiles_init(Tiles *tiles, const Config *config, guint count);
+
+// Frees the matches.
+void tiles_free(Tiles *tiles);
+
+// Lays the tiles out in a grid that fills a drawing area of a size.
+// (The columns and rows are chosen so that the arenas are drawn as large as possible.)
+void tiles_layout(Tiles *tiles, gint width, gint height);
+
+// Gets a rectangle of the arena of a tile in the drawing area in pixels.
+// (Rounded outwards to whole pixels, and grown to the smallest size of the level of detail.)
+Rect tiles_map(const Tiles *tiles, const Tile *tile, const Rect *rect);
+
+// Runs a tick of all the matches and reports the parts of the drawing area that have changed.
+// (A match is started again once it is over. 'changed' is called once per changed tile with
+// the union of the moves of its paddles and disc, or its whole arena if bricks were destroyed
+// or the state has changed. Returns the number of changed tiles.)
+guint tiles_step(Tiles *tiles, void (*changed)(const Rect *rect, gpointer user_data), gpointer user_data);
+
+#endif
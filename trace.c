@@ -0,0 +1,122 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRACE_CAPACITY 65536        // Number of events of a buffer
+
+// Structure of a trace event.
+typedef struct TraceEvent
+{
+    const gchar *name;              // Name of the event
+    gint64 start;                   // Start time in microseconds
+    gint64 duration;                // Duration in microseconds (-1 for an instant event)
+} TraceEvent;
+
+// Structure of the trace buffer of a thread.
+// (Only its thread writes to it: recording an event takes no lock.)
+typedef struct TraceBuffer
+{
+    struct TraceBuffer *next;       // Next buffer of the list of all buffers
+    guint tid;                      // Thread number
+    guint size;                     // Number of events recorded
+    guint dropped;                  // Number of events dropped because the buffer was full
+    TraceEvent events[TRACE_CAPACITY];
+} TraceBuffer;
+
+gboolean trace_enabled = FALSE;
+
+static const gchar *trace_path;     // Output file
+static TraceBuffer *trace_buffers;  // List of the buffers of all threads
+static gint trace_threads;          // Number of threads that have recorded events
+static __thread TraceBuffer *trace_buffer; // Buffer of the current thread
+
+// Gets the buffer of the current thread (creates it on the first event).
+static TraceBuffer *trace_get_buffer(void)
+{
+    if (G_LIKELY(trace_buffer != NULL))
+        return trace_buffer;
+
+    TraceBuffer *buffer = g_malloc0(sizeof(TraceBuffer));
+    buffer->tid = g_atomic_int_add(&trace_threads, 1) + 1;
+
+    // Pushes the buffer onto the list without a lock.
+    do
+        buffer->next = g_atomic_pointer_get(&trace_buffers);
+    while (!g_atomic_pointer_compare_and_exchange(&trace_buffers, buffer->next, buffer));
+
+    trace_buffer = buffer;
+    return buffer;
+}
+
+// Appends an event to the buffer of the current thread.
+static void trace_record(const gchar *name, gint64 start, gint64 duration)
+{
+    TraceBuffer *buffer = trace_get_buffer();
+
+    if (buffer->size == TRACE_CAPACITY)
+    {
+        buffer->dropped++;
+        return;
+    }
+
+    buffer->events[buffer->size++] = (TraceEvent) { name, start, duration };
+}
+
+void trace_complete(const gchar *name, gint64 start, gint64 end)
+{
+    trace_record(name, start, end - start);
+}
+
+void trace_instant_record(const gchar *name)
+{
+    trace_record(name, g_get_monotonic_time(), -1);
+}
+
+// Writes the events of all the threads to the output file.
+static void trace_flush(void)
+{
+    trace_enabled = FALSE;
+
+    FILE *file = fopen(trace_path, "w");
+    if (file == NULL)
+    {
+        g_printerr("Error opening file: %s\n", trace_path);
+        return;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    gboolean first = TRUE;
+    for (TraceBuffer *buffer = g_atomic_pointer_get(&trace_buffers); buffer != NULL; buffer = buffer->next)
+    {
+        for (guint i = 0; i < buffer->size; i++)
+        {
+            TraceEvent *event = &buffer->events[i];
+
+            fprintf(file, "%s{\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT,
+                    first ? "" : ",\n", event->name, buffer->tid, event->start);
+            if (event->duration < 0)
+                fprintf(file, ",\"ph\":\"i\",\"s\":\"t\"}");
+            else
+                fprintf(file, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT "}", event->duration);
+            first = FALSE;
+        }
+
+        if (buffer->dropped != 0)
+            g_printerr("Trace: %u events dropped on thread %u\n", buffer->dropped, buffer->tid);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}
+
+void trace_init(void)
+{
+    trace_path = g_getenv("PONG_TRACE");
+    if (trace_path == NULL)
+        return;
+
+    trace_enabled = TRUE;
+    atexit(trace_flush);
+}
@@ -0,0 +1,43 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <glib.h>
+
+// Trace events are recorded only when tracing is enabled, so that the
+// cost of a disabled trace point is a single test of 'trace_enabled'.
+extern gboolean trace_enabled;
+
+// Enables tracing if the PONG_TRACE environment variable gives an output file.
+// (The events are written to it in the Chrome trace-event format at exit.)
+void trace_init(void);
+
+// Records an event with a duration (called by TRACE_SCOPE).
+void trace_complete(const gchar *name, gint64 start, gint64 end);
+
+// Records an instant event.
+void trace_instant_record(const gchar *name);
+
+// Runs a statement as a traced scope.
+// (The statement is compiled twice, with and without the clock reads, so that 'trace_enabled'
+// is tested once: a disabled scope costs a single predictable branch. The statement must not
+// leave the scope by 'return', 'break' or 'goto'.)
+#define TRACE_SCOPE(name, ...) \
+    do \
+    { \
+        if (G_UNLIKELY(trace_enabled)) \
+        { \
+            gint64 trace_start_ = g_get_monotonic_time(); \
+            __VA_ARGS__; \
+            trace_complete(name, trace_start_, g_get_monotonic_time()); \
+        } \
+        else \
+        { \
+            __VA_ARGS__; \
+        } \
+    } while (0)
+
+// Traces an instant event.
+#define TRACE_INSTANT(name) \
+    do { if (G_UNLIKELY(trace_enabled)) trace_instant_record(name); } while (0)
+
+#endif